@@ -23,6 +23,8 @@
  */
 
 // number of connected BLE clients
+// all the session manager callbacks are called from poll() in loop(),
+// so the counter and the UWB.begin()/UWB.end() decisions stay on one task
 uint16_t numConnected = 0;
 
 /**
@@ -75,14 +77,10 @@ void clientConnected(BLEDevice dev) {
  * @param dev 
  */
 void clientDisconnected(BLEDevice dev) {
-  //find the session related to the device and stop it
-  UWBSession sess = UWBNearbySessionManager.find(dev);
-  sess.stop();
+  //the session manager stops the UWB session of the device,
+  //sessionStopped() is called when it is done
   //decrease the number of connected clients
   numConnected--;
-  //deinit the UWB stack if no clients are connected
-  if(numConnected==0)
-    UWB.end();
 }
 
 /**
@@ -103,6 +101,9 @@ void sessionStarted(BLEDevice dev)
 void sessionStopped(BLEDevice dev)
 {
   Serial.println("Session stopped");
+  //deinit the UWB stack if no clients are connected
+  if(numConnected==0)
+    UWB.end();
 }
 
 void setup() {
@@ -140,4 +141,8 @@ void loop() {
   
   //poll the BLE stack
   UWBNearbySessionManager.poll();
+
+  //send 'l' on the serial monitor to print the session start latency
+  if (Serial.available() && Serial.read() == 'l')
+    UWBNearbySessionManager.latency().print(Serial);
 }
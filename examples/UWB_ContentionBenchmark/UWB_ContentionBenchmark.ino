@@ -0,0 +1,65 @@
+#include <PortentaUWBShield.h>
+
+
+/**
+ * this demo compares time scheduled and contention based one-to-many
+ * ranging for growing tag populations, without using the radio
+ * For each tag count it prints the round planned by UWBRangingPlanner and
+ * the ranging results per second given by a simulation of the rounds:
+ * - time scheduled: every tag has its own slots, up to the 12 tags a
+ *   controller can enumerate
+ * - contention: the tags pick a random CAP slot, any number of tags
+ * - contention with block striding: each tag ranges every other round
+ *
+ * The figures come from a model: simulate() draws the CAP slots of the
+ * tags and counts the slots picked by a single tag, as if every such
+ * attempt succeeded on air. Preamble capture, multipath and the clock
+ * drift of real tags are not modelled. extras/linux/tests/bench_contention
+ * runs a UWBContentionAnchor with the same rows on the simulated UWBS.
+ */
+
+const float updateRate = 10;           // Hz
+const uint32_t simulatedRounds = 1000;
+
+void printRow(const char* mode, uint16_t tags, const UWBRoundPlan& plan)
+{
+  Serial.print(mode);
+  Serial.print("\ttags ");
+  Serial.print(tags);
+  Serial.print("\tslots ");
+  Serial.print(plan.slotsPerRR);
+  Serial.print("\tcap ");
+  Serial.print(plan.capSize);
+  Serial.print("\tinterval ");
+  Serial.print(plan.rangingDuration);
+  Serial.print(" ms\texpected ");
+  Serial.print(plan.throughput);
+  Serial.print("/s\tsimulated ");
+  Serial.print(UWBRangingPlanner::simulate(tags, plan, simulatedRounds));
+  Serial.println("/s");
+}
+
+void setup() {
+
+  Serial.begin(115200);
+  while (!Serial)
+    ;
+
+  const uint16_t tagCounts[] = {1, 2, 4, 8, 12, 16, 24, 32, 48, 64};
+  UWBRoundPlan plan;
+
+  for (uint16_t tags : tagCounts)
+  {
+    if (tags <= uwb::MAX_RESPONDERS &&
+        UWBRangingPlanner::plan(tags, uwb::RangingMethod::DS_TWR_NO_DEFER, uwb::RfFrameConfig::SP3, updateRate, plan))
+      printRow("scheduled", tags, plan);
+    if (UWBRangingPlanner::planContention(tags, uwb::RangingMethod::DS_TWR_NO_DEFER, uwb::RfFrameConfig::SP3, updateRate, plan))
+      printRow("contention", tags, plan);
+    if (UWBRangingPlanner::planContention(tags, uwb::RangingMethod::DS_TWR_NO_DEFER, uwb::RfFrameConfig::SP3, updateRate, plan, 1))
+      printRow("stride 1", tags, plan);
+  }
+}
+
+void loop() {
+  delay(1000);
+}
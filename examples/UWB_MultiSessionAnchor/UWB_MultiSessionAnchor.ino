@@ -11,7 +11,8 @@
  * - Session 2 (0x222222): Tracks Tag2 (MAC 0x4444) using preamble code 11
  * 
  * Different preamble codes prevent interference between sessions, allowing
- * concurrent distance measurements to multiple tags.
+ * concurrent distance measurements to multiple tags. They are assigned by the
+ * session manager allocator, in the order the sessions are added.
  * 
  * It expects two counterpart Stella devices setup as Multi-Session Tags
  * 
@@ -54,9 +55,15 @@ void setup()
   UWB.begin(); //start the UWB stack, use Serial for the log output
   Serial.println("Starting UWB ...");
   
-  //wait until the stack is initialised
-  while(UWB.state()!=0)
-    delay(10);
+  //begin() returns once the stack is initialised
+  if (!UWB.ready())
+    Serial.println("UWB init failed");
+
+  //let the session manager pick the preamble codes: channel 9, codes 10 and 11
+  const uint8_t channels[] = {9};
+  const uint8_t codes[] = {10, 11};
+  UWBSessionManager.radioPlan(channels, sizeof(channels), codes, sizeof(codes));
+  UWBSessionManager.autoAllocate(true);
 
   // ============ SESSION 1 SETUP ============
   Serial.println("Starting session 1 ...");
@@ -67,15 +74,11 @@ void setup()
   UWBMacAddress anchor1Mac(UWBMacAddress::Size::SHORT, anchor1Addr);
   UWBMacAddress tag1Mac(UWBMacAddress::Size::SHORT, tag1Addr);
   
-  //setup session 1 with ID 0x111111, using preamble code 10
-  UWBMultiSessionAnchor session1(0x111111, anchor1Mac, tag1Mac, 10);
+  //setup session 1 with ID 0x111111, it gets preamble code 10
+  UWBMultiSessionAnchor session1(0x111111, anchor1Mac, tag1Mac);
   
   //add session 1 to the session manager
   UWBSessionManager.addSession(session1);
-  
-  //prepare and start session 1
-  session1.init();
-  session1.start();
 
   // ============ SESSION 2 SETUP ============
   Serial.println("Starting session 2 ...");
@@ -86,15 +89,15 @@ void setup()
   UWBMacAddress anchor2Mac(UWBMacAddress::Size::SHORT, anchor2Addr);
   UWBMacAddress tag2Mac(UWBMacAddress::Size::SHORT, tag2Addr);
   
-  //setup session 2 with ID 0x222222, using preamble code 11 (different from session 1!)
-  UWBMultiSessionAnchor session2(0x222222, anchor2Mac, tag2Mac, 11);
+  //setup session 2 with ID 0x222222, it gets preamble code 11 (different from session 1!)
+  UWBMultiSessionAnchor session2(0x222222, anchor2Mac, tag2Mac);
   
   //add session 2 to the session manager
   UWBSessionManager.addSession(session2);
   
-  //prepare and start session 2
-  session2.init();
-  session2.start();
+  //prepare and start both sessions owned by the session manager
+  UWBSessionManager.initSessions();
+  UWBSessionManager.startSessions();
   
   Serial.println("Multi-session anchor ready!");
 }
@@ -61,9 +61,9 @@ void setup()
   UWB.begin(); //start the UWB stack, use Serial for the log output
   Serial.println("Starting UWB ...");
   
-  //wait until the stack is initialised
-  while(UWB.state()!=0)
-    delay(10);
+  //begin() returns once the stack is initialised
+  if (!UWB.ready())
+    Serial.println("UWB init failed");
 
   Serial.println("Starting session ...");
   //setup a session with ID 0x111111, using preamble code 10
@@ -73,10 +73,10 @@ void setup()
   UWBSessionManager.addSession(myTag);
 
   //prepare the session applying the configured parameters
-  myTag.init();
+  UWBSessionManager.initSessions();
   
   //start the session
-  myTag.start();
+  UWBSessionManager.startSessions();
 }
 
 void loop()
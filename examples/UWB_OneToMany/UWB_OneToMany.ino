@@ -69,9 +69,9 @@ void setup() {
   UWB.begin(); //start the UWB stack, use Serial for the log output
   Serial.println("Starting UWB ...");
 
-  //wait until the stack is initialised
-  while(UWB.state()!=0)
-    delay(10);
+  //begin() returns once the stack is initialised
+  if (!UWB.ready())
+    Serial.println("UWB init failed");
 
   Serial.println("Starting multicast session ...");
   //setup a multicast session with ID 0x11223344
@@ -81,10 +81,10 @@ void setup() {
   UWBSessionManager.addSession(myController);
 
   //prepare the session applying the default parameters
-  myController.init();
+  UWBSessionManager.initSessions();
 
   //start the session
-  myController.start();
+  UWBSessionManager.startSessions();
 
 }
 
@@ -53,9 +53,9 @@ void setup() {
   UWB.begin(); //start the UWB stack, use Serial for the log output
   Serial.println("Starting UWB ...");
   
-  //wait until the stack is initialised
-  while(UWB.state()!=0)
-    delay(10);
+  //begin() returns once the stack is initialised
+  if (!UWB.ready())
+    Serial.println("UWB init failed");
 
   Serial.println("Starting session ...");
   //setup a session with ID 0x11223344
@@ -65,10 +65,10 @@ void setup() {
   UWBSessionManager.addSession(myControlee);
 
   //prepare the session applying the default parameters
-  myControlee.init();
+  UWBSessionManager.initSessions();
   
   //start the session
-  myControlee.start();
+  UWBSessionManager.startSessions();
 
 }
 
@@ -52,16 +52,16 @@ void setup()
   UWB.begin(); //start the UWB stack, use Serial for the log output
   Serial.println("Starting UWB ...");
   
-  //wait until the stack is initialised
-  while(UWB.state()!=0)
-    delay(10);
+  //begin() returns once the stack is initialised
+  if (!UWB.ready())
+    Serial.println("UWB init failed");
 
   Serial.println("Starting session ...");
   //setup a session with ID 0x11223344;
   UWBRangingController myController(0x11223344, srcAddr, dstAddr);
   UWBSessionManager.addSession(myController);
-  myController.init();
-  myController.start();
+  UWBSessionManager.initSessions();
+  UWBSessionManager.startSessions();
 }
 
 void loop()
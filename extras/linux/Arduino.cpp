@@ -0,0 +1,304 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "Arduino.h"
+#include <stdarg.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <poll.h>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <random>
+
+HardwareSerial Serial;
+
+static std::mt19937 rng(1);
+static std::mutex outputLock;
+
+// the HAL starts its thread during the static initialization, the clock must be ready first
+static std::chrono::steady_clock::time_point startTime()
+{
+    static const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    return start;
+}
+
+static std::string toBase(unsigned long long v, int base)
+{
+    static const char digits[] = "0123456789ABCDEF";
+    char buf[65];
+    int i = sizeof(buf) - 1;
+
+    if (base < 2 || base > 16)
+        base = DEC;
+    buf[i] = 0;
+    do
+    {
+        buf[--i] = digits[v % base];
+        v /= base;
+    } while (v > 0);
+    return std::string(&buf[i]);
+}
+
+String::String(int v, unsigned char base) : String((long)v, base) {}
+String::String(unsigned int v, unsigned char base) : String((unsigned long)v, base) {}
+
+String::String(long v, unsigned char base)
+{
+    if (v < 0 && base == DEC)
+        str = "-" + toBase(-(unsigned long long)v, base);
+    else
+        str = toBase((unsigned long)v, base);
+}
+
+String::String(unsigned long v, unsigned char base) : str(toBase(v, base)) {}
+
+String::String(double v, unsigned int decimals)
+{
+    char buf[64];
+
+    snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+    str = buf;
+}
+
+int String::indexOf(char c) const
+{
+    size_t i = str.find(c);
+
+    return i == std::string::npos ? -1 : (int)i;
+}
+
+String String::substring(unsigned int from, unsigned int to) const
+{
+    if (from > to)
+    {
+        unsigned int t = from;
+        from = to;
+        to = t;
+    }
+    if (from >= str.length())
+        return String();
+    return String(str.substr(from, to - from));
+}
+
+void String::toUpperCase()
+{
+    for (auto& c : str)
+        c = toupper(c);
+}
+
+void String::toLowerCase()
+{
+    for (auto& c : str)
+        c = tolower(c);
+}
+
+size_t Print::write(const uint8_t* buffer, size_t size)
+{
+    size_t n = 0;
+
+    while (size--)
+        n += write(*buffer++);
+    return n;
+}
+
+size_t Print::print(long v, int base)
+{
+    return print(String(v, base));
+}
+
+size_t Print::print(unsigned long v, int base)
+{
+    return print(String(v, base));
+}
+
+size_t Print::print(long long v, int base)
+{
+    if (v < 0 && base == DEC)
+        return print('-') + print(-(unsigned long long)v, base);
+    return print((unsigned long long)v, base);
+}
+
+size_t Print::print(unsigned long long v, int base)
+{
+    return write(toBase(v, base).c_str());
+}
+
+size_t Print::print(double v, int digits)
+{
+    return print(String(v, digits));
+}
+
+int Print::printf(const char* format, ...)
+{
+    char buf[256];
+    va_list args;
+    int n;
+
+    va_start(args, format);
+    n = vsnprintf(buf, sizeof(buf), format, args);
+    va_end(args);
+    write(buf);
+    return n;
+}
+
+int Stream::timedRead()
+{
+    unsigned long start = millis();
+    int c;
+
+    do
+    {
+        c = read();
+        if (c >= 0)
+            return c;
+        delay(1);
+    } while (millis() - start < streamTimeout);
+    return -1;
+}
+
+int Stream::timedPeek()
+{
+    unsigned long start = millis();
+    int c;
+
+    do
+    {
+        c = peek();
+        if (c >= 0)
+            return c;
+        delay(1);
+    } while (millis() - start < streamTimeout);
+    return -1;
+}
+
+size_t Stream::readBytes(char* buffer, size_t length)
+{
+    size_t n = 0;
+    int c;
+
+    while (n < length && (c = timedRead()) >= 0)
+        buffer[n++] = c;
+    return n;
+}
+
+long Stream::parseInt()
+{
+    long v = 0;
+    bool negative = false;
+    int c;
+
+    // skip up to the first digit or minus sign
+    while ((c = timedPeek()) >= 0 && c != '-' && !isdigit(c))
+        read();
+    if (c == '-')
+    {
+        negative = true;
+        read();
+    }
+    while ((c = timedPeek()) >= 0 && isdigit(c))
+    {
+        v = v * 10 + c - '0';
+        read();
+    }
+    return negative ? -v : v;
+}
+
+String Stream::readString()
+{
+    String s;
+    int c;
+
+    while ((c = timedRead()) >= 0)
+        s += (char)c;
+    return s;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size)
+{
+    // several tasks print at once, keep their chunks whole
+    std::lock_guard<std::mutex> l(outputLock);
+
+    return fwrite(buffer, 1, size, stdout);
+}
+
+int HardwareSerial::available()
+{
+    struct pollfd p = {STDIN_FILENO, POLLIN, 0};
+
+    if (peeked >= 0)
+        return 1;
+    return poll(&p, 1, 0) > 0 && (p.revents & POLLIN) ? 1 : 0;
+}
+
+int HardwareSerial::read()
+{
+    unsigned char c;
+    int v = peeked;
+
+    if (v >= 0)
+    {
+        peeked = -1;
+        return v;
+    }
+    if (!available() || ::read(STDIN_FILENO, &c, 1) != 1)
+        return -1;
+    return c;
+}
+
+int HardwareSerial::peek()
+{
+    if (peeked < 0)
+        peeked = read();
+    return peeked;
+}
+
+void HardwareSerial::flush()
+{
+    std::lock_guard<std::mutex> l(outputLock);
+
+    fflush(stdout);
+}
+
+unsigned long millis()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime()).count();
+}
+
+unsigned long micros()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime()).count();
+}
+
+void delay(unsigned long ms)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+}
+
+long random(long max)
+{
+    return max > 0 ? random(0, max) : 0;
+}
+
+long random(long min, long max)
+{
+    if (max <= min)
+        return min;
+    return std::uniform_int_distribution<long>(min, max - 1)(rng);
+}
+
+void randomSeed(unsigned long seed)
+{
+    rng.seed(seed);
+}
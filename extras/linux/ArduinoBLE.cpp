@@ -0,0 +1,212 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "ArduinoBLE.h"
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <string>
+
+BLELocalDevice BLE;
+
+struct BLECharacteristic::Impl {
+    std::string uuid;
+    uint8_t properties;
+    int valueSize;
+    std::vector<uint8_t> value;
+    BLECharacteristicEventHandler writtenHandler = nullptr;
+};
+
+struct BLEService::Impl {
+    std::string uuid;
+    std::vector<BLECharacteristic> characteristics;
+};
+
+struct BLEEvent {
+    BLEDeviceEvent type;
+    bool write;
+    BLEDevice central;
+    BLECharacteristic characteristic;
+    std::vector<uint8_t> value;
+};
+
+// the events of the phone and the connected centrals, shared with the simulate*() callers
+static std::mutex bleLock;
+static std::deque<BLEEvent> pending;
+
+static bool sameUuid(const std::string& a, const char* b)
+{
+    std::string s(b);
+
+    // UUIDs are compared regardless of case, as the stack does
+    return a.size() == s.size() &&
+        std::equal(a.begin(), a.end(), s.begin(), [](char x, char y) { return toupper(x) == toupper(y); });
+}
+
+bool BLEDevice::connected() const
+{
+    return BLE.isConnected(*this);
+}
+
+BLECharacteristic::BLECharacteristic(const char* uuid, uint8_t properties, int valueSize)
+    : impl(std::make_shared<Impl>())
+{
+    impl->uuid = uuid;
+    impl->properties = properties;
+    impl->valueSize = valueSize;
+}
+
+const char* BLECharacteristic::uuid() const
+{
+    return impl ? impl->uuid.c_str() : "";
+}
+
+uint8_t BLECharacteristic::properties() const
+{
+    return impl ? impl->properties : 0;
+}
+
+const uint8_t* BLECharacteristic::value() const
+{
+    return impl && !impl->value.empty() ? impl->value.data() : nullptr;
+}
+
+int BLECharacteristic::valueLength() const
+{
+    return impl ? impl->value.size() : 0;
+}
+
+int BLECharacteristic::writeValue(const uint8_t* value, int length)
+{
+    if (!impl || length < 0 || length > impl->valueSize)
+        return 0;
+    impl->value.assign(value, value + length);
+    if (BLE.valueHook)
+        BLE.valueHook(impl->uuid.c_str(), value, length);
+    return 1;
+}
+
+void BLECharacteristic::setEventHandler(BLECharacteristicEvent event, BLECharacteristicEventHandler handler)
+{
+    if (impl && event == BLEWritten)
+        impl->writtenHandler = handler;
+}
+
+BLEService::BLEService(const char* uuid) : impl(std::make_shared<Impl>())
+{
+    impl->uuid = uuid;
+}
+
+const char* BLEService::uuid() const
+{
+    return impl ? impl->uuid.c_str() : "";
+}
+
+void BLEService::addCharacteristic(BLECharacteristic& characteristic)
+{
+    if (impl && characteristic)
+        impl->characteristics.push_back(characteristic);
+}
+
+void BLELocalDevice::setAdvertisedService(const BLEService& service)
+{
+    (void)service;
+}
+
+void BLELocalDevice::addService(BLEService& service)
+{
+    std::lock_guard<std::mutex> l(bleLock);
+
+    if (service.impl)
+        services.push_back(service);
+}
+
+void BLELocalDevice::setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler)
+{
+    if (event == BLEConnected)
+        connectHandler = handler;
+    else if (event == BLEDisconnected)
+        disconnectHandler = handler;
+}
+
+void BLELocalDevice::poll(unsigned long timeout)
+{
+    (void)timeout;
+
+    for (;;)
+    {
+        BLEEvent e;
+        {
+            std::lock_guard<std::mutex> l(bleLock);
+
+            if (pending.empty())
+                return;
+            e = pending.front();
+            pending.pop_front();
+            if (!e.write)
+            {
+                auto it = std::find(centrals.begin(), centrals.end(), e.central);
+
+                if (e.type == BLEConnected && it == centrals.end())
+                    centrals.push_back(e.central);
+                else if (e.type == BLEDisconnected && it != centrals.end())
+                    centrals.erase(it);
+                else
+                    continue;
+            }
+        }
+
+        // the handlers may call back into BLE, they run without the lock
+        if (e.write)
+        {
+            e.characteristic.impl->value = e.value;
+            if (e.characteristic.impl->writtenHandler)
+                e.characteristic.impl->writtenHandler(e.central, e.characteristic);
+        }
+        else if (e.type == BLEConnected && connectHandler)
+            connectHandler(e.central);
+        else if (e.type == BLEDisconnected && disconnectHandler)
+            disconnectHandler(e.central);
+    }
+}
+
+void BLELocalDevice::simulateConnect(const BLEDevice& central)
+{
+    std::lock_guard<std::mutex> l(bleLock);
+
+    pending.push_back(BLEEvent{BLEConnected, false, central, BLECharacteristic(), {}});
+}
+
+bool BLELocalDevice::simulateWrite(const BLEDevice& central, const char* uuid, const uint8_t* value, int length)
+{
+    std::lock_guard<std::mutex> l(bleLock);
+    BLECharacteristic c = findCharacteristic(uuid);
+
+    if (!c || length < 0 || length > c.impl->valueSize)
+        return false;
+    pending.push_back(BLEEvent{BLEConnected, true, central, c, std::vector<uint8_t>(value, value + length)});
+    return true;
+}
+
+void BLELocalDevice::simulateDisconnect(const BLEDevice& central)
+{
+    std::lock_guard<std::mutex> l(bleLock);
+
+    pending.push_back(BLEEvent{BLEDisconnected, false, central, BLECharacteristic(), {}});
+}
+
+BLECharacteristic BLELocalDevice::findCharacteristic(const char* uuid)
+{
+    for (auto& s : services)
+        for (auto& c : s.impl->characteristics)
+            if (sameUuid(c.impl->uuid, uuid))
+                return c;
+    return BLECharacteristic();
+}
+
+bool BLELocalDevice::isConnected(const BLEDevice& central)
+{
+    std::lock_guard<std::mutex> l(bleLock);
+
+    return std::find(centrals.begin(), centrals.end(), central) != centrals.end();
+}
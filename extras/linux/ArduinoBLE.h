@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef LINUX_ARDUINOBLE_H
+#define LINUX_ARDUINOBLE_H
+
+/*
+ * The peripheral side of ArduinoBLE used by NearbySessionManager, with no
+ * radio behind it. A test or a sketch plays the phone through the
+ * simulate*() calls of BLE: the events are queued and the handlers run
+ * from BLE.poll(), as with the real stack. Notifications and reads of the
+ * characteristics reach the hook set with onValueWritten().
+ */
+
+#include "Arduino.h"
+#include <memory>
+#include <vector>
+
+#define BLEBroadcast            0x01
+#define BLERead                 0x02
+#define BLEWriteWithoutResponse 0x04
+#define BLEWrite                0x08
+#define BLENotify               0x10
+#define BLEIndicate             0x20
+
+enum BLEDeviceEvent {
+    BLEConnected,
+    BLEDisconnected
+};
+
+enum BLECharacteristicEvent {
+    BLESubscribed,
+    BLEUnsubscribed,
+    BLEWritten
+};
+
+class BLEDevice {
+public:
+    BLEDevice() {}
+    explicit BLEDevice(const char* address) : addr(address) {}
+
+    String address() const { return addr; }
+    bool connected() const;
+    operator bool() const { return addr.length() > 0; }
+    bool operator==(const BLEDevice& rhs) const { return addr == rhs.addr; }
+    bool operator!=(const BLEDevice& rhs) const { return addr != rhs.addr; }
+
+private:
+    String addr;
+};
+
+class BLECharacteristic;
+typedef void (*BLEDeviceEventHandler)(BLEDevice device);
+typedef void (*BLECharacteristicEventHandler)(BLEDevice device, BLECharacteristic characteristic);
+
+/*
+ * As in ArduinoBLE the objects are handles: copies share the value and
+ * the handlers.
+ */
+class BLECharacteristic {
+public:
+    BLECharacteristic() {}
+    BLECharacteristic(const char* uuid, uint8_t properties, int valueSize);
+
+    const char* uuid() const;
+    uint8_t properties() const;
+    const uint8_t* value() const;
+    int valueLength() const;
+    int writeValue(const uint8_t* value, int length);
+    void setEventHandler(BLECharacteristicEvent event, BLECharacteristicEventHandler handler);
+    operator bool() const { return (bool)impl; }
+
+private:
+    friend class BLELocalDevice;
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+class BLEService {
+public:
+    BLEService() {}
+    explicit BLEService(const char* uuid);
+
+    const char* uuid() const;
+    void addCharacteristic(BLECharacteristic& characteristic);
+
+private:
+    friend class BLELocalDevice;
+    struct Impl;
+    std::shared_ptr<Impl> impl;
+};
+
+typedef void (*BLEValueHook)(const char* uuid, const uint8_t* value, int length);
+
+class BLELocalDevice {
+public:
+    int begin() { return 1; }
+    void end() {}
+    void setLocalName(const char* name) { localName = name; }
+    void setDeviceName(const char* name) { deviceName = name; }
+    void setAdvertisedService(const BLEService& service);
+    void addService(BLEService& service);
+    void setEventHandler(BLEDeviceEvent event, BLEDeviceEventHandler handler);
+    int advertise() { advertising = true; return 1; }
+    void stopAdvertise() { advertising = false; }
+    void poll(unsigned long timeout = 0);
+
+    bool isAdvertising() const { return advertising; }
+    const String& name() const { return localName; }
+
+    /*
+     * Phone side. The calls can be made from any thread, the events are
+     * delivered by the next poll(). simulateWrite() returns false if no
+     * service added to BLE has the characteristic.
+     */
+    void simulateConnect(const BLEDevice& central);
+    bool simulateWrite(const BLEDevice& central, const char* uuid, const uint8_t* value, int length);
+    void simulateDisconnect(const BLEDevice& central);
+
+    /*
+     * Called by writeValue() on any characteristic, i.e. what the phone
+     * would read or be notified of.
+     */
+    void onValueWritten(BLEValueHook hook) { valueHook = hook; }
+
+private:
+    friend class BLECharacteristic;
+    friend class BLEDevice;
+
+    BLECharacteristic findCharacteristic(const char* uuid);
+    bool isConnected(const BLEDevice& central);
+
+    String localName;
+    String deviceName;
+    bool advertising = false;
+    BLEDeviceEventHandler connectHandler = nullptr;
+    BLEDeviceEventHandler disconnectHandler = nullptr;
+    BLEValueHook valueHook = nullptr;
+    std::vector<BLEService> services;
+    std::vector<BLEDevice> centrals;
+};
+
+extern BLELocalDevice BLE;
+
+#endif /* LINUX_ARDUINOBLE_H */
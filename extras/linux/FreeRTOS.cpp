@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "Arduino.h"
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Semaphore {
+    std::mutex lock;
+    std::condition_variable changed;
+    UBaseType_t count;
+    UBaseType_t maxCount;
+};
+
+struct Queue {
+    std::mutex lock;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+};
+
+static std::atomic<uintptr_t> nextTask(1);
+static thread_local TaskHandle_t currentTask = nullptr;
+
+template <typename Pred>
+static bool waitFor(std::unique_lock<std::mutex>& l, std::condition_variable& cv, TickType_t ticks, Pred ready)
+{
+    if (ticks == portMAX_DELAY)
+    {
+        cv.wait(l, ready);
+        return true;
+    }
+    return cv.wait_for(l, std::chrono::milliseconds(ticks), ready);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary()
+{
+    return xSemaphoreCreateCounting(1, 0);
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex()
+{
+    // no priority inheritance and no owner, a binary semaphore given once
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t maxCount, UBaseType_t initialCount)
+{
+    Semaphore* s = new Semaphore;
+
+    s->count = initialCount;
+    s->maxCount = maxCount;
+    return s;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+    delete (Semaphore*)sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    Semaphore* s = (Semaphore*)sem;
+    std::unique_lock<std::mutex> l(s->lock);
+
+    if (!waitFor(l, s->changed, ticks, [s] { return s->count > 0; }))
+        return pdFALSE;
+    s->count--;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    Semaphore* s = (Semaphore*)sem;
+    std::lock_guard<std::mutex> l(s->lock);
+
+    if (s->count >= s->maxCount)
+        return pdFALSE;
+    s->count++;
+    s->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTakeFromISR(SemaphoreHandle_t sem, BaseType_t* woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xSemaphoreTake(sem, 0);
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize)
+{
+    Queue* q = new Queue;
+
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t queue)
+{
+    delete (Queue*)queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks)
+{
+    Queue* q = (Queue*)queue;
+    const uint8_t* p = (const uint8_t*)item;
+    std::unique_lock<std::mutex> l(q->lock);
+
+    if (!waitFor(l, q->changed, ticks, [q] { return q->items.size() < q->length; }))
+        return pdFALSE;
+    q->items.emplace_back(p, p + q->itemSize);
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t queue, const void* item, BaseType_t* woken)
+{
+    if (woken)
+        *woken = pdFALSE;
+    return xQueueSend(queue, item, 0);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks)
+{
+    Queue* q = (Queue*)queue;
+    std::unique_lock<std::mutex> l(q->lock);
+
+    if (!waitFor(l, q->changed, ticks, [q] { return !q->items.empty(); }))
+        return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue)
+{
+    Queue* q = (Queue*)queue;
+    std::lock_guard<std::mutex> l(q->lock);
+
+    return q->items.size();
+}
+
+BaseType_t xTaskCreate(TaskFunction_t code, const char* name, uint32_t stackDepth, void* params, UBaseType_t priority, TaskHandle_t* handle)
+{
+    TaskHandle_t task = (TaskHandle_t)nextTask++;
+
+    (void)name;
+    (void)stackDepth;
+    (void)priority;
+    if (handle)
+        *handle = task;
+    // the tasks of the library never return, nobody joins them
+    std::thread([=] {
+        currentTask = task;
+        code(params);
+    }).detach();
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskPrioritySet(TaskHandle_t task, UBaseType_t priority)
+{
+    (void)task;
+    (void)priority;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle()
+{
+    // NULL for the main thread, running setup() and loop()
+    return currentTask;
+}
+
+TickType_t xTaskGetTickCount()
+{
+    // a tick is a millisecond, as millis()
+    return millis();
+}
@@ -0,0 +1,9 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef LINUX_SPI_H
+#define LINUX_SPI_H
+
+// the simulated UWBS has no bus, UWB.cpp only needs the header
+
+#endif /* LINUX_SPI_H */
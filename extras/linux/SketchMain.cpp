@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "Arduino.h"
+#include <thread>
+
+int main()
+{
+    // one line at a time, the output is often piped
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    setup();
+    for (;;)
+    {
+        loop();
+        std::this_thread::yield();
+    }
+}
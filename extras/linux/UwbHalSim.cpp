@@ -0,0 +1,1219 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UwbHalSim.hpp"
+#include <stdarg.h>
+#include <math.h>
+#include <chrono>
+
+// session states, as notified in SESSION_DATA
+#define SIM_STATE_INIT   0x00
+#define SIM_STATE_DEINIT 0x01
+#define SIM_STATE_ACTIVE 0x02
+#define SIM_STATE_IDLE   0x03
+
+#define SIM_STATUS_RX_TIMEOUT 0x21
+#define SIM_DATA_TX_FAILED 0x02
+#define SIM_DEFAULT_INTERVAL 200
+#define SIM_TAG_BASE 0x1000
+#define SIM_DEFAULT_CHANNEL 9
+#define SIM_DEFAULT_PREAMBLE 10
+
+extern "C" {
+int runtime_log_level = (int)uwb::LogLevel::UWB_INFO_LEVEL;
+}
+
+namespace uwb {
+
+// the accessory side of Nearby sessions
+static const uint8_t simShortAddr[MAC_SHORT_ADD_LEN] = {0x5A, 0x51};
+
+UwbHal& UwbHal::getInstance()
+{
+    return UwbHalSim::getInstance();
+}
+
+UwbHalSim& UwbHalSim::getInstance()
+{
+    static UwbHalSim sim;
+    return sim;
+}
+
+UwbHalSim::UwbHalSim()
+    : stopping(false), initialized(false), nextHandle(1), nextProfileId(0x5100),
+      numDevices(0), rounds(0), sigmaCm(5), sigmaDeg(3), nlosProbability(0),
+      nlosBiasCm(0), lossProbability(0), delayMs(2), latencyMs(0),
+      nextFailure(SUCCESS), sendHook(nullptr), numTags(0), tagStride(0), jammedChannels(0), rng(1)
+{
+    userNotificationCallback = nullptr;
+    mPrintCallback = nullptr;
+    memset(sessions, 0, sizeof(sessions));
+    localPos[0] = localPos[1] = localPos[2] = 0;
+    defaultPos[0] = 150;
+    defaultPos[1] = defaultPos[2] = 0;
+    worker = std::thread(&UwbHalSim::run, this);
+}
+
+UwbHalSim::~UwbHalSim()
+{
+    {
+        std::lock_guard<std::mutex> l(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+bool UwbHalSim::addDevice(const uint8_t* addr, uint8_t addrLen, float x, float y, float z)
+{
+    std::lock_guard<std::mutex> l(lock);
+    SimDevice* d = (SimDevice*)device(addr, addrLen);
+
+    if (addrLen != MAC_SHORT_ADD_LEN && addrLen != MAC_EXT_ADD_LEN)
+        return false;
+    if (d == nullptr)
+    {
+        if (numDevices >= UWB_SIM_MAX_DEVICES)
+            return false;
+        d = &devices[numDevices++];
+        memcpy(d->addr, addr, addrLen);
+        d->addrLen = addrLen;
+    }
+    d->x = x;
+    d->y = y;
+    d->z = z;
+    return true;
+}
+
+bool UwbHalSim::addDevice(uint16_t shortAddr, float x, float y, float z)
+{
+    uint8_t addr[MAC_SHORT_ADD_LEN] = {(uint8_t)shortAddr, (uint8_t)(shortAddr >> 8)};
+
+    return addDevice(addr, MAC_SHORT_ADD_LEN, x, y, z);
+}
+
+bool UwbHalSim::removeDevice(const uint8_t* addr, uint8_t addrLen)
+{
+    std::lock_guard<std::mutex> l(lock);
+    const SimDevice* d = device(addr, addrLen);
+
+    if (d == nullptr)
+        return false;
+    devices[d - devices] = devices[--numDevices];
+    return true;
+}
+
+void UwbHalSim::defaultPosition(float x, float y, float z)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    defaultPos[0] = x;
+    defaultPos[1] = y;
+    defaultPos[2] = z;
+}
+
+void UwbHalSim::localPosition(float x, float y, float z)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    localPos[0] = x;
+    localPos[1] = y;
+    localPos[2] = z;
+}
+
+void UwbHalSim::distanceNoise(float sigma)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    sigmaCm = sigma;
+}
+
+void UwbHalSim::angleNoise(float sigma)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    sigmaDeg = sigma;
+}
+
+void UwbHalSim::nlos(float probability, float biasCm)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    nlosProbability = probability;
+    nlosBiasCm = biasCm;
+}
+
+void UwbHalSim::packetLoss(float probability)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    lossProbability = probability;
+}
+
+void UwbHalSim::notificationDelay(uint32_t ms)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    delayMs = ms;
+}
+
+void UwbHalSim::commandLatency(uint32_t ms)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    latencyMs = ms;
+}
+
+void UwbHalSim::contentionTags(uint16_t count, uint8_t blockStride)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    numTags = count;
+    tagStride = blockStride;
+}
+
+void UwbHalSim::seed(uint32_t value)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    rng.seed(value);
+}
+
+void UwbHalSim::failNextCommand(Status status)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    nextFailure = status;
+}
+
+void UwbHalSim::onSendData(SimSendHook hook)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    sendHook = hook;
+}
+
+void UwbHalSim::jamChannel(uint8_t channel, bool jammed)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    if (channel >= 32)
+        return;
+    if (jammed)
+        jammedChannels |= 1UL << channel;
+    else
+        jammedChannels &= ~(1UL << channel);
+}
+
+bool UwbHalSim::linkSessions(uint32_t sessionHandleA, uint32_t sessionHandleB)
+{
+    std::lock_guard<std::mutex> l(lock);
+    Session* a = find(sessionHandleA);
+    Session* b = find(sessionHandleB);
+
+    if (a == nullptr || b == nullptr || a == b)
+        return false;
+    a->link = sessionHandleB;
+    b->link = sessionHandleA;
+    return true;
+}
+
+bool UwbHalSim::injectData(uint32_t sessionHandle, const uint8_t* peerAddr, const uint8_t* data, uint16_t len)
+{
+    std::lock_guard<std::mutex> l(lock);
+    Session* s = find(sessionHandle);
+    Pending p;
+
+    if (s == nullptr || len > MAX_APP_DATA_SIZE)
+        return false;
+    p.type = NotificationType::DATA_RCV_NTF;
+    p.packet.session_handle = sessionHandle;
+    if (peerAddr)
+        memcpy(p.packet.mac_address, peerAddr, s->addrLen);
+    else if (s->numPeers)
+        memcpy(p.packet.mac_address, s->peers[0], s->addrLen);
+    p.packet.sequence_number = s->dataSequence++;
+    p.packet.data_size = len;
+    p.data.assign(data, data + len);
+    post(p);
+    return true;
+}
+
+void UwbHalSim::injectRecovery()
+{
+    std::lock_guard<std::mutex> l(lock);
+    Pending p;
+
+    p.type = NotificationType::RECOVERY_NTF;
+    post(p);
+}
+
+uint32_t UwbHalSim::rangingRounds()
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    return rounds;
+}
+
+Status UwbHalSim::initialize(SystemNotificationCallback systemNotificationCallback)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    userNotificationCallback = systemNotificationCallback;
+    initialized = true;
+    rounds = 0;
+    return SUCCESS;
+}
+
+Status UwbHalSim::deinitialize()
+{
+    return shutdown();
+}
+
+Status UwbHalSim::reset()
+{
+    std::lock_guard<std::mutex> l(lock);
+    Pending p;
+
+    if (!initialized)
+        return NOT_INITIALIZED;
+    // the UWBS forgets the sessions without notifying them
+    dropSessions();
+    p.type = NotificationType::DEVICE_RESET;
+    post(p);
+    return SUCCESS;
+}
+
+Status UwbHalSim::shutdown()
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    dropSessions();
+    pending.clear();
+    initialized = false;
+    return SUCCESS;
+}
+
+void UwbHalSim::initSemaphores()
+{
+}
+
+void UwbHalSim::deInitSemaphores()
+{
+}
+
+Status UwbHalSim::getDeviceInfo(DeviceInfo& info)
+{
+    static const char name[] = "SR150 simulator";
+    std::lock_guard<std::mutex> l(lock);
+
+    if (!initialized)
+        return NOT_INITIALIZED;
+    memset(&info, 0, sizeof(info));
+    info.macMajorVersion = 1;
+    info.macMinorMaintenanceVersion = 0x30;
+    info.phyMajorVersion = 1;
+    info.phyMinorMaintenanceVersion = 0x30;
+    info.devNameLen = sizeof(name) - 1;
+    memcpy(info.devName, name, sizeof(name) - 1);
+    info.fwMajor = 0x40;
+    info.fwMinor = 0x0A;
+    info.uciGenericMajor = 1;
+    info.uciGenericMinorMaintenanceVersion = 0x10;
+    info.maxPpmValue = 30;
+    return SUCCESS;
+}
+
+Status UwbHalSim::getDeviceCapability(DeviceCapabilities& capabilities)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    if (!initialized)
+        return NOT_INITIALIZED;
+    memset(&capabilities, 0, sizeof(capabilities));
+    capabilities.firaPhyLowerRangeMajorVersion = 1;
+    capabilities.firaPhyHigherRangeMajorVersion = 2;
+    capabilities.firaMacLowerRangeMajorVersion = 1;
+    capabilities.firaMacHigherRangeMajorVersion = 2;
+    capabilities.deviceTypes = 0x03;
+    capabilities.deviceRoles = 0x03;
+    capabilities.rangingMethod = 0x3F;
+    capabilities.multiNodeMode = 0x07;
+    capabilities.channels = 0x0A;       // 5 and 9
+    capabilities.aoaSupport = 0x03;
+    capabilities.extendedMacAddress = 1;
+    capabilities.suspendRanging = 1;
+    capabilities.maxMessageSize = MAX_APP_DATA_SIZE;
+    capabilities.maxDataPacketPayloadSize = MAX_APP_DATA_SIZE;
+    return SUCCESS;
+}
+
+Status UwbHalSim::getDeviceState(DeviceState& state)
+{
+    std::lock_guard<std::mutex> l(lock);
+
+    if (!initialized)
+        state = DeviceState::NOT_INITIALIZED;
+    else
+    {
+        state = DeviceState::INITIALIZED;
+        for (auto& s : sessions)
+            if (s.used && s.state == SIM_STATE_ACTIVE)
+                state = DeviceState::ACTIVE;
+    }
+    return SUCCESS;
+}
+
+Status UwbHalSim::getUwbConfigData_Android(DeviceConfig& config)
+{
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = fault()) != SUCCESS)
+        return status;
+    memset(&config, 0, sizeof(config));
+    config.spec_version_major[0] = 1;
+    config.spec_version_minor[0] = 0;
+    config.chip_id[0] = 0x50;
+    config.chip_id[1] = 0x01;
+    config.chip_fw_version[0] = 0x40;
+    config.chip_fw_version[1] = 0x0A;
+    config.mw_version[0] = 0x04;
+    config.mw_version[1] = 0x0C;
+    config.supported_profiles = 1;
+    config.ranging_role = RESPONDER;
+    memcpy(config.device_mac_addr, simShortAddr, MAC_SHORT_ADD_LEN);
+    return SUCCESS;
+}
+
+Status UwbHalSim::getUwbConfigData_iOS(DeviceRole device_role, AccessoryConfigData& config)
+{
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = fault()) != SUCCESS)
+        return status;
+    memset(&config, 0, sizeof(config));
+    config.length = sizeof(config) - 1;
+    config.spec_version_major[0] = 1;
+    config.spec_version_minor[0] = 1;
+    memcpy(config.manufacturer_id, "TSRL", 4);
+    memcpy(config.model_id, "SIM0", 4);
+    config.mw_version[0] = 0x04;
+    config.mw_version[1] = 0x0C;
+    config.ranging_role = device_role;
+    memcpy(config.device_mac_addr, simShortAddr, MAC_SHORT_ADD_LEN);
+    config.clock_drift[0] = 100;
+    return SUCCESS;
+}
+
+Status UwbHalSim::configureDevice_Android(AndroidDeviceConfig& config)
+{
+    static const uint8_t unknown[MAC_SHORT_ADD_LEN] = {0, 0};
+    const uint8_t* peer = unknown;
+    uint32_t id = 0;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = fault()) != SUCCESS)
+        return status;
+    // spec versions, session ID, preamble, channel, profile, role, phone address
+    if (config.config_data != nullptr && config.config_data_length >= 14)
+    {
+        memcpy(&id, config.config_data + 4, sizeof(id));
+        peer = config.config_data + 12;
+    }
+    if (id == 0)
+        id = nextProfileId++;
+    return startProfile(id, config.profile_info.mac_addr, peer, config.profile_info.session_handle);
+}
+
+Status UwbHalSim::configureDevice_iOS(ProfileConfig& config)
+{
+    // the shareable data of the phone is opaque, the phone is the default device
+    static const uint8_t unknown[MAC_SHORT_ADD_LEN] = {0, 0};
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = fault()) != SUCCESS)
+        return status;
+    if (config.sharable_data.empty())
+        return INVALID_PARAM;
+    return startProfile(nextProfileId++, config.profile_info.mac_addr, unknown, config.profile_info.session_handle);
+}
+
+Status UwbHalSim::sessionInit(uint32_t session_id, SessionType type, uint32_t& handle)
+{
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = fault()) != SUCCESS)
+        return status;
+    if ((status = create(session_id, type, s)) != SUCCESS)
+        return status;
+    handle = s->handle;
+    return SUCCESS;
+}
+
+Status UwbHalSim::sessionDeinit(uint32_t session_handle)
+{
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(session_handle, s)) != SUCCESS)
+        return status;
+    dropFrames(*s);
+    setState(*s, SIM_STATE_DEINIT);
+    s->used = false;
+    return SUCCESS;
+}
+
+Status UwbHalSim::getSessionState(uint32_t session_handle, uint8_t& state)
+{
+    std::lock_guard<std::mutex> l(lock);
+    Session* s = find(session_handle);
+
+    if (s == nullptr)
+        return SESSION_NOT_EXIST;
+    state = s->state;
+    return SUCCESS;
+}
+
+Status UwbHalSim::setRangingParams(uint32_t session_handle, UWBRangingParams& params)
+{
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(session_handle, s)) != SUCCESS)
+        return status;
+    s->addrLen = params.macAddrMode() == (uint8_t)MacAddressMode::SHORT ? MAC_SHORT_ADD_LEN : MAC_EXT_ADD_LEN;
+    memcpy(s->local, params.deviceMacAddr(), s->addrLen);
+    s->contention = params.deviceType() == DeviceType::CONTROLLER &&
+                    params.scheduledMode() == ScheduledMode::CONTENTION;
+    configured(*s);
+    return SUCCESS;
+}
+
+Status UwbHalSim::setAppConfig(uint32_t session_handle, AppConfigId param_id, uint32_t value)
+{
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(session_handle, s)) != SUCCESS)
+        return status;
+    appConfig(*s, param_id, value);
+    configured(*s);
+    return SUCCESS;
+}
+
+Status UwbHalSim::setAppConfigMultiple(uint32_t session_handle, UWBAppParamList configs)
+{
+    AppConfig* params = configs.getParamsList();
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(session_handle, s)) != SUCCESS)
+        return status;
+    // the addressing mode decides how the peer addresses are split
+    for (unsigned int i = 0; i < configs.getSize(); ++i)
+        if (params[i].param_id == AppConfigId::MacAddressMode && params[i].param_type == AppParamType::U32)
+            appConfig(*s, params[i].param_id, params[i].param_value.vu32);
+    for (unsigned int i = 0; i < configs.getSize(); ++i)
+    {
+        if (params[i].param_type == AppParamType::U32)
+            appConfig(*s, params[i].param_id, params[i].param_value.vu32);
+        else if (params[i].param_id == AppConfigId::PeerAddress && params[i].param_value.au8.param_value != nullptr)
+        {
+            uint16_t n = params[i].param_value.au8.param_len / s->addrLen;
+
+            s->numPeers = n < MAX_RESPONDERS ? n : MAX_RESPONDERS;
+            for (uint8_t p = 0; p < s->numPeers; ++p)
+                memcpy(s->peers[p], params[i].param_value.au8.param_value + p * s->addrLen, s->addrLen);
+        }
+    }
+    configured(*s);
+    return SUCCESS;
+}
+
+Status UwbHalSim::setVendorAppConfig(uint32_t session_handle, UWBVendorParamList configs)
+{
+    Session* s;
+
+    (void)configs;
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    return check(session_handle, s);
+}
+
+Status UwbHalSim::startRanging(uint32_t session_handle)
+{
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(session_handle, s)) != SUCCESS)
+        return status;
+    if (s->state == SIM_STATE_INIT)
+        return SESSION_NOT_CONFIGURED;
+    if (s->state == SIM_STATE_ACTIVE)
+        return SESSION_ACTIVE;
+    setState(*s, SIM_STATE_ACTIVE);
+    s->nextRound = millis() + delayMs + s->intervalMs;
+    wake.notify_all();
+    return SUCCESS;
+}
+
+Status UwbHalSim::stopRanging(uint32_t session_handle)
+{
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(session_handle, s)) != SUCCESS)
+        return status;
+    if (s->state != SIM_STATE_ACTIVE)
+        return REJECTED;
+    dropFrames(*s);
+    setState(*s, SIM_STATE_IDLE);
+    return SUCCESS;
+}
+
+Status UwbHalSim::enableRangingNotifications(uint32_t session_handle, uint8_t enableRangingDataNtf, uint16_t proximityNear, uint16_t proximityFar)
+{
+    Session* s;
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(session_handle, s)) != SUCCESS)
+        return status;
+    if (enableRangingDataNtf > 2 || (enableRangingDataNtf == 2 && proximityNear > proximityFar))
+        return INVALID_PARAM;
+    s->ntfMode = enableRangingDataNtf;
+    s->near = proximityNear;
+    s->far = proximityFar;
+    return SUCCESS;
+}
+
+Status UwbHalSim::sendData(DataPacket& packet)
+{
+    Session* s;
+    Status status;
+    Pending p;
+    int queued = 0;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = check(packet.session_handle, s)) != SUCCESS)
+        return status;
+    if (s->state != SIM_STATE_ACTIVE)
+        return REJECTED;
+    if (packet.data_size > MAX_APP_DATA_SIZE || (packet.data_size && packet.data == nullptr))
+        return INVALID_PARAM;
+    for (auto& f : outbox)
+        if (f.packet.session_handle == packet.session_handle)
+            queued++;
+    if (queued >= UWB_SIM_TX_FRAMES)
+        return REJECTED;
+
+    // sent with the next ranging round of the session
+    p.packet = packet;
+    p.packet.data = nullptr;
+    p.data.assign(packet.data, packet.data + packet.data_size);
+    outbox.push_back(std::move(p));
+    return SUCCESS;
+}
+
+Status UwbHalSim::setStaticSts(uint32_t session_handle, uint16_t vendor_id, const std::vector<uint8_t>& sts_iv)
+{
+    Session* s;
+
+    (void)vendor_id;
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if (sts_iv.size() != 6)
+        return INVALID_PARAM;
+    return check(session_handle, s);
+}
+
+void UwbHalSim::setPrintCallback(PrintCallback logCB)
+{
+    mPrintCallback = logCB;
+}
+
+void UwbHalSim::setLogLevel(LogLevel logLevel)
+{
+    runtime_log_level = (int)logLevel;
+}
+
+void UwbHalSim::Log_D(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    log(LogLevel::UWB_DEBUG_LEVEL, "D", format, args);
+    va_end(args);
+}
+
+void UwbHalSim::Log_E(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    log(LogLevel::UWB_ERROR_LEVEL, "E", format, args);
+    va_end(args);
+}
+
+void UwbHalSim::Log_I(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    log(LogLevel::UWB_INFO_LEVEL, "I", format, args);
+    va_end(args);
+}
+
+void UwbHalSim::Log_W(const char* format, ...)
+{
+    va_list args;
+
+    va_start(args, format);
+    log(LogLevel::UWB_WARN_LEVEL, "W", format, args);
+    va_end(args);
+}
+
+void UwbHalSim::Log_Array_D(const char* message, const unsigned char* array, size_t array_len)
+{
+    logArray(LogLevel::UWB_DEBUG_LEVEL, "D", message, array, array_len);
+}
+
+void UwbHalSim::Log_Array_E(const char* message, const unsigned char* array, size_t array_len)
+{
+    logArray(LogLevel::UWB_ERROR_LEVEL, "E", message, array, array_len);
+}
+
+void UwbHalSim::Log_Array_I(const char* message, const unsigned char* array, size_t array_len)
+{
+    logArray(LogLevel::UWB_INFO_LEVEL, "I", message, array, array_len);
+}
+
+void UwbHalSim::Log_Array_W(const char* message, const unsigned char* array, size_t array_len)
+{
+    logArray(LogLevel::UWB_WARN_LEVEL, "W", message, array, array_len);
+}
+
+uint16_t UwbHalSim::serializeDeviceConfigData(uint8_t* out_buffer, const DeviceConfig& config)
+{
+    uint8_t* p = out_buffer;
+
+    memcpy(p, config.spec_version_major, 2);
+    p += 2;
+    memcpy(p, config.spec_version_minor, 2);
+    p += 2;
+    memcpy(p, config.chip_id, 2);
+    p += 2;
+    memcpy(p, config.chip_fw_version, 2);
+    p += 2;
+    memcpy(p, config.mw_version, 3);
+    p += 3;
+    for (int i = 0; i < 4; ++i)
+        *p++ = config.supported_profiles >> (8 * i);
+    *p++ = config.ranging_role;
+    memcpy(p, config.device_mac_addr, 2);
+    p += 2;
+    return p - out_buffer;
+}
+
+Status UwbHalSim::setDefaultCoreConfigs(void)
+{
+    Status status;
+
+    busy();
+    std::lock_guard<std::mutex> l(lock);
+    if ((status = fault()) != SUCCESS)
+        return status;
+    return initialized ? SUCCESS : NOT_INITIALIZED;
+}
+
+void UwbHalSim::setDefaultVendorConfigs(UWBVendorParamList& vendorParams)
+{
+    (void)vendorParams;
+}
+
+void UwbHalSim::busy()
+{
+    uint32_t ms;
+
+    {
+        std::lock_guard<std::mutex> l(lock);
+        ms = latencyMs;
+    }
+    if (ms)
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+Status UwbHalSim::fault()
+{
+    Status status = nextFailure;
+
+    nextFailure = SUCCESS;
+    if (status == SUCCESS && !initialized)
+        return NOT_INITIALIZED;
+    return status;
+}
+
+Status UwbHalSim::check(uint32_t session_handle, Session*& s)
+{
+    Status status = fault();
+
+    if (status != SUCCESS)
+        return status;
+    s = find(session_handle);
+    return s ? SUCCESS : SESSION_NOT_EXIST;
+}
+
+Status UwbHalSim::create(uint32_t id, SessionType type, Session*& s)
+{
+    s = nullptr;
+    for (auto& i : sessions)
+    {
+        if (i.used && i.id == id)
+            return REJECTED;
+        if (!i.used && s == nullptr)
+            s = &i;
+    }
+    if (s == nullptr)
+        return MAX_SESSIONS_EXCEEDED;
+    memset(s, 0, sizeof(*s));
+    s->used = true;
+    s->id = id;
+    s->type = type;
+    s->handle = nextHandle++;
+    s->addrLen = MAC_SHORT_ADD_LEN;
+    s->intervalMs = SIM_DEFAULT_INTERVAL;
+    s->ntfMode = 1;
+    s->channel = SIM_DEFAULT_CHANNEL;
+    s->preambleCode = SIM_DEFAULT_PREAMBLE;
+    setState(*s, SIM_STATE_INIT);
+    return SUCCESS;
+}
+
+UwbHalSim::Session* UwbHalSim::find(uint32_t session_handle)
+{
+    for (auto& s : sessions)
+        if (s.used && s.handle == session_handle)
+            return &s;
+    return nullptr;
+}
+
+void UwbHalSim::appConfig(Session& s, AppConfigId id, uint32_t value)
+{
+    switch (id)
+    {
+    case AppConfigId::RangingDuration:
+        if (value > 0)
+            s.intervalMs = value;
+        break;
+    case AppConfigId::Channel:
+        s.channel = (uint8_t)value;
+        break;
+    case AppConfigId::PreambleCodeIndex:
+        s.preambleCode = (uint8_t)value;
+        break;
+    case AppConfigId::CapSizeRange:
+        // maximum in the first octet
+        s.capSize = (uint8_t)value;
+        break;
+    case AppConfigId::MacAddressMode:
+        s.addrLen = value == (uint32_t)MacAddressMode::SHORT ? MAC_SHORT_ADD_LEN : MAC_EXT_ADD_LEN;
+        break;
+    default:
+        break;
+    }
+}
+
+void UwbHalSim::configured(Session& s)
+{
+    if (s.state == SIM_STATE_INIT)
+        setState(s, SIM_STATE_IDLE);
+}
+
+void UwbHalSim::setState(Session& s, uint8_t state)
+{
+    Pending p;
+
+    s.state = state;
+    p.type = NotificationType::SESSION_DATA;
+    p.info.sessionHandle = s.handle;
+    p.info.state = state;
+    p.info.reason_code = 0;
+    post(p);
+}
+
+void UwbHalSim::post(Pending& p)
+{
+    auto it = pending.end();
+
+    p.due = millis() + delayMs;
+    // keep the queue sorted by due time, in order of generation for the same time
+    while (it != pending.begin() && (int32_t)((it - 1)->due - p.due) > 0)
+        --it;
+    pending.insert(it, std::move(p));
+    wake.notify_all();
+}
+
+bool UwbHalSim::nextFrame(Session& s, Pending& frame)
+{
+    Pending ntf;
+
+    for (auto it = outbox.begin(); it != outbox.end(); ++it)
+    {
+        if (it->packet.session_handle != s.handle)
+            continue;
+        frame = std::move(*it);
+        outbox.erase(it);
+        ntf.type = NotificationType::DATA_TRANSMIT_NTF;
+        ntf.transmit.transmitNtf_sessionHandle = s.handle;
+        ntf.transmit.transmitNtf_sequence_number = frame.packet.sequence_number;
+        ntf.transmit.transmitNtf_status = uniform() < lossProbability ? SIM_DATA_TX_FAILED : SUCCESS;
+        ntf.transmit.transmitNtf_txcount = 1;
+        frame.transmit = ntf.transmit;
+        post(ntf);
+        return true;
+    }
+    return false;
+}
+
+void UwbHalSim::dropFrames(Session& s)
+{
+    Pending ntf;
+
+    for (auto it = outbox.begin(); it != outbox.end();)
+    {
+        if (it->packet.session_handle != s.handle)
+        {
+            ++it;
+            continue;
+        }
+        ntf.type = NotificationType::DATA_TRANSMIT_NTF;
+        ntf.transmit.transmitNtf_sessionHandle = s.handle;
+        ntf.transmit.transmitNtf_sequence_number = it->packet.sequence_number;
+        ntf.transmit.transmitNtf_status = SIM_DATA_TX_FAILED;
+        ntf.transmit.transmitNtf_txcount = 0;
+        post(ntf);
+        it = outbox.erase(it);
+    }
+}
+
+void UwbHalSim::dropSessions()
+{
+    for (auto& s : sessions)
+        s.used = false;
+    outbox.clear();
+    // what was generated for the old sessions is lost with them
+    for (auto it = pending.begin(); it != pending.end();)
+    {
+        if (it->type == NotificationType::SESSION_DATA || it->type == NotificationType::DATA_TRANSMIT_NTF ||
+            it->type == NotificationType::DATA_RCV_NTF)
+            it = pending.erase(it);
+        else
+            ++it;
+    }
+}
+
+Status UwbHalSim::startProfile(uint32_t id, const uint8_t* local, const uint8_t* peer, uint32_t& handle)
+{
+    Session* s;
+    Status status;
+
+    if ((status = create(id, RANGING, s)) != SUCCESS)
+        return status;
+    memcpy(s->local, local, MAC_SHORT_ADD_LEN);
+    memcpy(s->peers[0], peer, MAC_SHORT_ADD_LEN);
+    s->numPeers = 1;
+    setState(*s, SIM_STATE_IDLE);
+    setState(*s, SIM_STATE_ACTIVE);
+    s->nextRound = millis() + delayMs + s->intervalMs;
+    handle = s->handle;
+    return SUCCESS;
+}
+
+float UwbHalSim::uniform()
+{
+    return std::uniform_real_distribution<float>(0, 1)(rng);
+}
+
+float UwbHalSim::gaussian(float sigma)
+{
+    return sigma > 0 ? std::normal_distribution<float>(0, sigma)(rng) : 0;
+}
+
+bool UwbHalSim::measure(Session& s, RangingResult& result)
+{
+    bool report = s.ntfMode == 1;
+
+    memset(&result, 0, sizeof(result));
+    result.ranging_measure_type = (uint8_t)MeasurementType::TWO_WAY;
+    result.mac_addr_mode_indicator = s.addrLen == MAC_EXT_ADD_LEN ? 1 : 0;
+    result.no_of_measurements = s.numPeers;
+    result.sequence_number = s.sequence++;
+    result.session_handle = s.handle;
+    result.range_interval_ms = s.intervalMs;
+
+    for (uint8_t i = 0; i < s.numPeers; ++i)
+    {
+        result.measurements.twr[i].slot_index = i + 1;
+        if (measurePeer(s, s.peers[i], result.measurements.twr[i]))
+            report = true;
+    }
+    return report;
+}
+
+// false if the channel is jammed or the other end of the link does not listen
+bool UwbHalSim::reachable(Session& s)
+{
+    Session* peer;
+
+    if (s.channel < 32 && (jammedChannels & (1UL << s.channel)))
+        return false;
+    if (s.link == 0)
+        return true;
+    peer = find(s.link);
+    return peer != nullptr && peer->state == SIM_STATE_ACTIVE &&
+           peer->channel == s.channel && peer->preambleCode == s.preambleCode;
+}
+
+// true if the measurement falls in the notification window of the session
+bool UwbHalSim::measurePeer(Session& s, const uint8_t* addr, twr_mesr& m)
+{
+    const SimDevice* d = device(addr, s.addrLen);
+    const float* pos = d ? &d->x : defaultPos;
+    float dx = pos[0] - localPos[0];
+    float dy = pos[1] - localPos[1];
+    float dz = pos[2] - localPos[2];
+    float range = sqrtf(dx * dx + dy * dy + dz * dz);
+    float azimuth = atan2f(dy, dx) * 180 / M_PI + gaussian(sigmaDeg);
+    float elevation = atan2f(dz, sqrtf(dx * dx + dy * dy)) * 180 / M_PI + gaussian(sigmaDeg);
+    bool isNlos = uniform() < nlosProbability;
+
+    memcpy(m.peer_addr, addr, s.addrLen);
+    if (uniform() < lossProbability || !reachable(s))
+    {
+        m.status = SIM_STATUS_RX_TIMEOUT;
+        m.distance = 0xFFFF;
+        return false;
+    }
+    range += gaussian(sigmaCm) + (isNlos ? nlosBiasCm : 0);
+    range = range < 0 ? 0 : (range > 0xFFFE ? 0xFFFE : range);
+    if (azimuth >= 180)
+        azimuth -= 360;
+    else if (azimuth < -180)
+        azimuth += 360;
+
+    m.status = SUCCESS;
+    m.nlos = isNlos;
+    m.distance = (uint16_t)lroundf(range);
+    // Q9.7 degrees
+    m.aoa_azimuth = (int16_t)lroundf(azimuth * 128);
+    m.aoa_elevation = (int16_t)lroundf(elevation * 128);
+    m.aoa_azimuth_fom = isNlos ? 50 : 100;
+    m.aoa_elevation_fom = m.aoa_azimuth_fom;
+    // free space loss from 40 dB at 1 m, reported as -dBm in Q7.1
+    m.rssi = (uint8_t)lroundf(2 * (40 + 20 * log10f((range < 10 ? 10 : range) / 100) + (isNlos ? 6 : 0)));
+    return s.ntfMode == 2 && m.distance >= s.near && m.distance <= s.far;
+}
+
+bool UwbHalSim::contend(Session& s, std::vector<RangingResult>& results)
+{
+    std::vector<uint16_t> picks(s.capSize, 0);      // tag + 1, 0xFFFF on a collision
+    uint8_t addr[MAC_EXT_ADD_LEN] = {0};
+    uint32_t sequence = s.sequence++;
+    bool report = s.ntfMode == 1;
+    RangingResult* result = nullptr;
+
+    for (uint16_t t = 0; t < numTags; ++t)
+    {
+        // with striding the tags take turns, one group per round
+        if ((t + sequence) % (tagStride + 1) != 0)
+            continue;
+        uint16_t& slot = picks[rng() % s.capSize];
+        slot = slot == 0 ? t + 1 : 0xFFFF;
+    }
+
+    results.clear();
+    for (uint8_t i = 0; i < s.capSize; ++i)
+    {
+        if (picks[i] == 0 || picks[i] == 0xFFFF)
+            continue;
+        if (result == nullptr || result->no_of_measurements == MAX_RESPONDERS)
+        {
+            results.emplace_back();
+            result = &results.back();
+            memset(result, 0, sizeof(*result));
+            result->ranging_measure_type = (uint8_t)MeasurementType::TWO_WAY;
+            result->mac_addr_mode_indicator = s.addrLen == MAC_EXT_ADD_LEN ? 1 : 0;
+            result->sequence_number = sequence;
+            result->session_handle = s.handle;
+            result->range_interval_ms = s.intervalMs;
+        }
+        addr[0] = (uint8_t)(SIM_TAG_BASE + picks[i] - 1);
+        addr[1] = (uint8_t)((SIM_TAG_BASE + picks[i] - 1) >> 8);
+        twr_mesr& m = result->measurements.twr[result->no_of_measurements++];
+        m.slot_index = i + 1;
+        if (measurePeer(s, addr, m))
+            report = true;
+    }
+    // a round nobody answered is notified too
+    if (results.empty())
+    {
+        results.emplace_back();
+        memset(&results.back(), 0, sizeof(RangingResult));
+        results.back().ranging_measure_type = (uint8_t)MeasurementType::TWO_WAY;
+        results.back().sequence_number = sequence;
+        results.back().session_handle = s.handle;
+        results.back().range_interval_ms = s.intervalMs;
+    }
+    return report;
+}
+
+const SimDevice* UwbHalSim::device(const uint8_t* addr, uint8_t addrLen)
+{
+    for (uint8_t i = 0; i < numDevices; ++i)
+        if (devices[i].addrLen == addrLen && memcmp(devices[i].addr, addr, addrLen) == 0)
+            return &devices[i];
+    return nullptr;
+}
+
+void UwbHalSim::run()
+{
+    std::unique_lock<std::mutex> l(lock);
+
+    while (!stopping)
+    {
+        uint32_t now = millis();
+        uint32_t next = now + 100;
+        SystemNotificationCallback callback = userNotificationCallback;
+        SimSendHook hook = sendHook;
+        bool delivered = false;
+
+        if (!pending.empty() && (int32_t)(pending.front().due - now) <= 0)
+        {
+            Pending p = std::move(pending.front());
+            void* data = &p.info;
+
+            pending.pop_front();
+            if (p.type == NotificationType::DATA_TRANSMIT_NTF)
+                data = &p.transmit;
+            else if (p.type == NotificationType::DATA_RCV_NTF)
+            {
+                p.packet.data = p.data.data();
+                data = &p.packet;
+            }
+            l.unlock();
+            if (callback)
+                callback(p.type, data);
+            l.lock();
+            continue;
+        }
+        if (!pending.empty())
+            next = pending.front().due;
+
+        for (auto& s : sessions)
+        {
+            bool contending = s.contention && s.capSize > 0;
+
+            if (!s.used || s.state != SIM_STATE_ACTIVE || (s.numPeers == 0 && !contending))
+                continue;
+            if ((int32_t)(s.nextRound - now) > 0)
+            {
+                if ((int32_t)(s.nextRound - next) < 0)
+                    next = s.nextRound;
+                continue;
+            }
+            // a late round is not made up for
+            s.nextRound += s.intervalMs;
+            if ((int32_t)(s.nextRound - now) <= 0)
+                s.nextRound = now + s.intervalMs;
+
+            std::vector<RangingResult> results(1);
+            Pending frame;
+            // one queued data frame goes out with every round
+            bool sent = nextFrame(s, frame);
+            bool report = contending ? contend(s, results) : measure(s, results[0]);
+
+            if (!report && !sent)
+                continue;
+            if (report)
+                rounds++;
+            l.unlock();
+            if (sent && hook && frame.transmit.transmitNtf_status == SUCCESS)
+            {
+                frame.packet.data = frame.data.data();
+                hook(frame.packet);
+            }
+            for (size_t i = 0; report && callback && i < results.size(); ++i)
+                callback(NotificationType::RANGING_DATA, &results[i]);
+            l.lock();
+            delivered = true;
+            break;
+        }
+        if (!delivered && (int32_t)(next - now) > 0)
+            wake.wait_for(l, std::chrono::milliseconds(next - now));
+    }
+}
+
+void UwbHalSim::log(LogLevel level, const char* tag, const char* format, va_list args)
+{
+    char buf[256];
+    int n;
+
+    if (runtime_log_level < (int)level)
+        return;
+    n = snprintf(buf, sizeof(buf), "%s: ", tag);
+    n += vsnprintf(buf + n, sizeof(buf) - n, format, args);
+    if (n > (int)sizeof(buf) - 3)
+        n = sizeof(buf) - 3;
+    strcpy(buf + n, "\r\n");
+    if (mPrintCallback)
+        mPrintCallback(buf);
+    else
+        fputs(buf, stdout);
+}
+
+void UwbHalSim::logArray(LogLevel level, const char* tag, const char* message, const unsigned char* array, size_t len)
+{
+    char buf[256];
+    int n;
+
+    if (runtime_log_level < (int)level)
+        return;
+    n = snprintf(buf, sizeof(buf), "%s: %s", tag, message);
+    for (size_t i = 0; i < len && n < (int)sizeof(buf) - 6; ++i)
+        n += snprintf(buf + n, sizeof(buf) - n, " %02X", array[i]);
+    strcpy(buf + n, "\r\n");
+    if (mPrintCallback)
+        mPrintCallback(buf);
+    else
+        fputs(buf, stdout);
+}
+
+} // namespace uwb
+
+uwb::UwbHal& UWBHAL = uwb::UwbHal::getInstance();
+uwb::UwbHalSim& UWBHALSim = uwb::UwbHalSim::getInstance();
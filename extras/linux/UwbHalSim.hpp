@@ -0,0 +1,364 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBHALSIM_HPP
+#define UWBHALSIM_HPP
+
+#include <Arduino.h>
+#include "hal/uwb_hal.hpp"
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <thread>
+
+#ifndef UWB_SIM_MAX_SESSIONS
+#define UWB_SIM_MAX_SESSIONS 8
+#endif
+
+#ifndef UWB_SIM_MAX_DEVICES
+#define UWB_SIM_MAX_DEVICES 16
+#endif
+
+// Data frames a session keeps waiting for its ranging rounds
+#ifndef UWB_SIM_TX_FRAMES
+#define UWB_SIM_TX_FRAMES 8
+#endif
+
+namespace uwb {
+
+/**
+ * @brief a virtual UWB device the local one ranges with
+ *
+ * Positions are in cm, x forward from the local antenna, y left, z up.
+ *
+ */
+struct SimDevice {
+    uint8_t addr[MAC_EXT_ADD_LEN];
+    uint8_t addrLen;
+    float x;
+    float y;
+    float z;
+};
+
+/**
+ * @brief called from the simulator thread with every data frame that
+ * reached the peer, e.g. to injectData() it in the receiving session
+ */
+typedef void (*SimSendHook)(const DataPacket& packet);
+
+/**
+ * @brief software UWBS implementing the HAL on a Linux host
+ *
+ * The session state machine follows the UWBS: sessionInit() notifies
+ * INIT, the first configuration IDLE, startRanging() ACTIVE, stopRanging()
+ * IDLE and sessionDeinit() DEINIT, and the commands are rejected with the
+ * same status codes in the wrong state.
+ *
+ * Every ACTIVE session produces one two-way ranging result per ranging
+ * interval (RANGING_DURATION, 200 ms by default) with a measurement for
+ * every peer address configured. A peer the host did not add with
+ * addDevice() is placed at the default position. The distance is the
+ * geometric one plus gaussian noise, plus a bias when the round is drawn
+ * as NLOS; a lost measurement is reported with status 0x21 (RX timeout)
+ * and distance 0xFFFF. The angles are computed from the positions.
+ *
+ * sendData() only queues the frame: every ranging round of the session
+ * carries the oldest queued frame, and its DATA_TRANSMIT_NTF follows the
+ * round, failed if the frame is drawn as lost. Up to UWB_SIM_TX_FRAMES
+ * frames wait per session, the next ones are rejected. The frames still
+ * waiting when the session stops are notified as failed.
+ *
+ * The notifications are delivered to the callback given to initialize()
+ * by a thread of the simulator, after the configured delay, in the order
+ * they were generated. No lock of the simulator is held by the callback:
+ * handlers may call the HAL back.
+ *
+ * TDoA, one way ranging and the HUS phases are not modelled: every
+ * session ranges two-way.
+ *
+ */
+class UwbHalSim : public UwbHal {
+public:
+    static UwbHalSim& getInstance();
+
+    UwbHalSim();
+    ~UwbHalSim() override;
+
+    /**
+     * @brief add or move a virtual device
+     *
+     * @param addr MAC address, as configured in the sessions
+     * @param addrLen 2 or 8
+     * @return false if the table is full
+     */
+    bool addDevice(const uint8_t* addr, uint8_t addrLen, float x, float y, float z = 0);
+
+    /**
+     * @brief add or move a virtual device with a short address
+     *
+     * @param shortAddr address, first byte in the low byte ({0x11, 0x22} is 0x2211)
+     */
+    bool addDevice(uint16_t shortAddr, float x, float y, float z = 0);
+    bool removeDevice(const uint8_t* addr, uint8_t addrLen);
+
+    /**
+     * @brief position of the peers not added with addDevice(), 150 cm ahead by default
+     */
+    void defaultPosition(float x, float y, float z = 0);
+
+    /**
+     * @brief position of the local device, the origin by default
+     */
+    void localPosition(float x, float y, float z = 0);
+
+    /**
+     * @brief standard deviation of the distance error, 5 cm by default
+     */
+    void distanceNoise(float sigmaCm);
+
+    /**
+     * @brief standard deviation of the angle error, 3 degrees by default
+     */
+    void angleNoise(float sigmaDeg);
+
+    /**
+     * @brief chance that a measurement is non line of sight and the bias it adds
+     *
+     * @param probability 0 to 1, 0 by default
+     * @param biasCm added to the distance of the NLOS measurements
+     */
+    void nlos(float probability, float biasCm);
+
+    /**
+     * @brief chance that a measurement or a data packet is lost, 0 by default
+     */
+    void packetLoss(float probability);
+
+    /**
+     * @brief delay between an event of the UWBS and its notification, 2 ms by default
+     */
+    void notificationDelay(uint32_t ms);
+
+    /**
+     * @brief time taken by every session command, 0 by default
+     */
+    void commandLatency(uint32_t ms);
+
+    /**
+     * @brief seed of the random draws, for repeatable runs
+     */
+    void seed(uint32_t value);
+
+    /**
+     * @brief the next session command fails with the given status
+     *
+     * e.g. HPDWKUP to exercise the retries after a wake up.
+     */
+    void failNextCommand(Status status);
+
+    void onSendData(SimSendHook hook);
+
+    /**
+     * @brief tags answering the contention based sessions
+     *
+     * A controller session in CONTENTION mode with a CAP_SIZE_RANGE ranges
+     * with these tags instead of its peer addresses. Every round each tag
+     * picks a random slot of the CAP, the slots picked by exactly one tag
+     * give a measurement. With blockStride the tags take turns, each one
+     * answers every blockStride + 1 rounds. The tags are named
+     * 0x1000 + i and placed as the other peers. A round with more than
+     * MAX_RESPONDERS measurements is notified in several RANGING_DATA.
+     *
+     * @param count 0 by default
+     * @param blockStride
+     */
+    void contentionTags(uint16_t count, uint8_t blockStride = 0);
+
+    /**
+     * @brief narrowband interference on a channel
+     *
+     * Every measurement of the sessions configured on a jammed channel
+     * is lost, e.g. a Wi-Fi 6E burst on channel 5.
+     *
+     * @param channel as set with CHANNEL_NUMBER, 9 by default
+     * @param jammed
+     */
+    void jamChannel(uint8_t channel, bool jammed);
+
+    /**
+     * @brief make two sessions of the simulated UWBS the two ends of one link
+     *
+     * A measurement of either session is lost unless the other one is
+     * ACTIVE on the same channel and preamble code, as a controller and
+     * its controlee on two devices. Once one of them is deinitialized, the
+     * other one loses every measurement.
+     *
+     * @return false if a session does not exist
+     */
+    bool linkSessions(uint32_t sessionHandleA, uint32_t sessionHandleB);
+
+    /**
+     * @brief notify DATA_RCV_NTF as if a peer had sent data over UWB
+     *
+     * @param sessionHandle
+     * @param peerAddr sender, the first peer of the session if nullptr
+     * @param data copied
+     * @param len up to MAX_APP_DATA_SIZE
+     * @return false if the session does not exist or len is too long
+     */
+    bool injectData(uint32_t sessionHandle, const uint8_t* peerAddr, const uint8_t* data, uint16_t len);
+
+    /**
+     * @brief notify RECOVERY_NTF, the sessions are kept
+     */
+    void injectRecovery();
+
+    /**
+     * @brief number of ranging rounds notified in RANGING_DATA since initialize()
+     */
+    uint32_t rangingRounds();
+
+    // UwbHal
+    Status initialize(SystemNotificationCallback systemNotificationCallback) override;
+    Status deinitialize() override;
+    Status reset() override;
+    Status shutdown() override;
+    void initSemaphores() override;
+    void deInitSemaphores() override;
+
+    Status getDeviceInfo(DeviceInfo& info) override;
+    Status getDeviceCapability(DeviceCapabilities& capabilities) override;
+    Status getDeviceState(DeviceState& state) override;
+
+    Status getUwbConfigData_Android(DeviceConfig& config) override;
+    Status getUwbConfigData_iOS(DeviceRole device_role, AccessoryConfigData& config) override;
+    Status configureDevice_Android(AndroidDeviceConfig& config) override;
+    Status configureDevice_iOS(ProfileConfig& config) override;
+
+    Status sessionInit(uint32_t session_id, SessionType type, uint32_t& handle) override;
+    Status sessionDeinit(uint32_t session_handle) override;
+    Status getSessionState(uint32_t session_handle, uint8_t& state) override;
+
+    Status setRangingParams(uint32_t session_handle, UWBRangingParams& params) override;
+    Status setAppConfig(uint32_t session_handle, AppConfigId param_id, uint32_t value) override;
+    Status setAppConfigMultiple(uint32_t session_handle, UWBAppParamList configs) override;
+    Status setVendorAppConfig(uint32_t session_handle, UWBVendorParamList configs) override;
+
+    Status startRanging(uint32_t session_handle) override;
+    Status stopRanging(uint32_t session_handle) override;
+    Status enableRangingNotifications(uint32_t session_handle, uint8_t enableRangingDataNtf, uint16_t proximityNear, uint16_t proximityFar) override;
+
+    Status sendData(DataPacket& packet) override;
+    Status setStaticSts(uint32_t session_handle, uint16_t vendor_id, const std::vector<uint8_t>& sts_iv) override;
+
+    void setPrintCallback(PrintCallback logCB) override;
+    void setLogLevel(LogLevel logLevel) override;
+    void Log_D(const char* format, ...) override;
+    void Log_E(const char* format, ...) override;
+    void Log_I(const char* format, ...) override;
+    void Log_W(const char* format, ...) override;
+    void Log_Array_D(const char* message, const unsigned char* array, size_t array_len) override;
+    void Log_Array_E(const char* message, const unsigned char* array, size_t array_len) override;
+    void Log_Array_I(const char* message, const unsigned char* array, size_t array_len) override;
+    void Log_Array_W(const char* message, const unsigned char* array, size_t array_len) override;
+
+    uint16_t serializeDeviceConfigData(uint8_t* out_buffer, const DeviceConfig& config) override;
+    Status setDefaultCoreConfigs(void) override;
+    void setDefaultVendorConfigs(UWBVendorParamList& vendorParams) override;
+
+private:
+    struct Session {
+        bool used;
+        uint32_t id;
+        uint32_t handle;
+        SessionType type;
+        uint8_t state;
+        uint8_t addrLen;
+        uint8_t local[MAC_EXT_ADD_LEN];
+        uint8_t numPeers;
+        uint8_t peers[MAX_RESPONDERS][MAC_EXT_ADD_LEN];
+        uint32_t intervalMs;
+        uint32_t sequence;
+        uint16_t dataSequence;
+        uint32_t nextRound;
+        uint8_t ntfMode;        // 0 off, 1 always, 2 inside [near, far]
+        uint16_t near;
+        uint16_t far;
+        bool contention;        // controller in CONTENTION mode
+        uint8_t capSize;        // contention access period slots, 0 if not set
+        uint8_t channel;
+        uint8_t preambleCode;
+        uint32_t link;          // handle of the other end, 0 if not linked
+    };
+
+    struct Pending {
+        uint32_t due;
+        NotificationType type;
+        SessionInfo info;
+        DataTransmit transmit;
+        DataPacket packet;
+        std::vector<uint8_t> data;
+    };
+
+    void busy();
+    Status fault();
+    Status check(uint32_t session_handle, Session*& s);
+    Status create(uint32_t id, SessionType type, Session*& s);
+    Session* find(uint32_t session_handle);
+    void appConfig(Session& s, AppConfigId id, uint32_t value);
+    void configured(Session& s);
+    void setState(Session& s, uint8_t state);
+    void post(Pending& p);
+    bool nextFrame(Session& s, Pending& frame);
+    void dropFrames(Session& s);
+    void dropSessions();
+    Status startProfile(uint32_t id, const uint8_t* local, const uint8_t* peer, uint32_t& handle);
+    float uniform();
+    float gaussian(float sigma);
+    bool measure(Session& s, RangingResult& result);
+    bool reachable(Session& s);
+    bool measurePeer(Session& s, const uint8_t* addr, twr_mesr& m);
+    bool contend(Session& s, std::vector<RangingResult>& results);
+    const SimDevice* device(const uint8_t* addr, uint8_t addrLen);
+    void run();
+    void log(LogLevel level, const char* tag, const char* format, va_list args);
+    void logArray(LogLevel level, const char* tag, const char* message, const unsigned char* array, size_t len);
+
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread worker;
+    bool stopping;
+    bool initialized;
+
+    Session sessions[UWB_SIM_MAX_SESSIONS];
+    uint32_t nextHandle;
+    uint32_t nextProfileId;
+    SimDevice devices[UWB_SIM_MAX_DEVICES];
+    uint8_t numDevices;
+    std::deque<Pending> pending;
+    std::deque<Pending> outbox;     // data frames waiting for a round
+    uint32_t rounds;
+
+    float localPos[3];
+    float defaultPos[3];
+    float sigmaCm;
+    float sigmaDeg;
+    float nlosProbability;
+    float nlosBiasCm;
+    float lossProbability;
+    uint32_t delayMs;
+    uint32_t latencyMs;
+    Status nextFailure;
+    SimSendHook sendHook;
+    uint16_t numTags;
+    uint8_t tagStride;
+    uint32_t jammedChannels;        // bit per channel number
+    std::mt19937 rng;
+};
+
+} // namespace uwb
+
+extern uwb::UwbHalSim& UWBHALSim;
+
+#endif /* UWBHALSIM_HPP */
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef NEARBYCORPUS_H
+#define NEARBYCORPUS_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "NearbyMessageParser.hpp"
+
+/*
+ * Random Nearby sessions as a phone writes them: Initialize,
+ * ConfigureAndStart, Stop, from an iPhone or an Android phone, cut in BLE
+ * writes of random length. Only the C library is used.
+ */
+
+struct NearbyCorpus {
+    static const size_t maxMessages = 3;
+    static const size_t maxBytes = 1 + SHAREABLE_DATA_HEADER_LENGTH + 200 + 2;
+    static const size_t maxWrite = 20;      // payload of a BLE write with the default MTU
+
+    uint32_t state;
+
+    // the session bytes, and the length of each message
+    uint8_t bytes[maxBytes];
+    size_t len;
+    uint8_t ids[maxMessages];
+    size_t lens[maxMessages];
+    size_t numMessages;
+
+    explicit NearbyCorpus(uint32_t seed) : state(seed ? seed : 1), len(0), numMessages(0) {}
+
+    uint32_t random()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    // the message written from start to the end of the session
+    void message(size_t start)
+    {
+        ids[numMessages] = bytes[start];
+        lens[numMessages++] = len - start;
+    }
+
+    // a new session, returns its length
+    size_t session()
+    {
+        bool ios = random() & 1;
+        size_t dataLen, start;
+
+        len = 0;
+        numMessages = 0;
+        bytes[len++] = ios ? kMsg_Initialize_iOS : kMsg_Initialize_Android;
+        message(0);
+
+        start = len;
+        bytes[len++] = kMsg_ConfigureAndStart;
+        if (ios)
+        {
+            dataLen = random() % 201;
+            for (int i = 1; i < SHAREABLE_DATA_LENGTH_OFFSET; ++i)
+                bytes[len++] = (uint8_t)random();
+            bytes[len++] = (uint8_t)dataLen;
+        }
+        else
+        {
+            dataLen = SHAREABLE_DATA_HEADER_LENGTH_ANDROID;
+        }
+        for (size_t i = 0; i < dataLen; ++i)
+            bytes[len++] = (uint8_t)random();
+        message(start);
+
+        start = len;
+        bytes[len++] = kMsg_Stop;
+        message(start);
+        return len;
+    }
+
+    // length of the next BLE write
+    size_t writeLength()
+    {
+        return 1 + random() % maxWrite;
+    }
+};
+
+#endif /* NEARBYCORPUS_H */
@@ -0,0 +1,33 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef SIMTEST_H
+#define SIMTEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Checks of the host tests, a failed one is printed and the program
+ * exits with status 1 at simTestExit().
+ */
+
+static int simTestFailures = 0;
+
+#define SIM_CHECK(cond)                                                      \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            printf("FAIL %s:%d: %s\n", __FILE__, __LINE__, #cond);           \
+            simTestFailures++;                                               \
+        }                                                                    \
+    } while (0)
+
+// the tasks of the library never end, leave without running the destructors
+static inline void simTestExit()
+{
+    printf(simTestFailures ? "FAILED\n" : "PASSED\n");
+    fflush(stdout);
+    _Exit(simTestFailures ? 1 : 0);
+}
+
+#endif /* SIMTEST_H */
@@ -0,0 +1,94 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// Throughput vs tag count of a UWBContentionAnchor ranging with the
+// contention tags of the simulated UWBS, next to the figures of
+// UWBRangingPlanner: the expected throughput of the plan and simulate().
+// The same rows as the UWB_ContentionBenchmark example, with the results
+// counted from the RANGING_DATA notifications of a running session.
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+
+static const float updateRate = 10;     // Hz
+static const uint32_t rounds = 30;      // per row
+static const uint16_t tagCounts[] = {1, 2, 4, 8, 12, 16, 24, 32, 48, 64};
+
+static volatile uint32_t sessionHandle = 0;
+static volatile uint32_t results = 0;
+
+void setup() {}
+void loop() {}
+
+static void ranging(UWBRangingData& data)
+{
+    if (data.sessionHandle() != sessionHandle)
+        return;
+    for (int i = 0; i < data.available() && i < uwb::MAX_RESPONDERS; ++i)
+    {
+        if (data.twoWayRangingMeasure()[i].status == 0)
+            results++;
+    }
+}
+
+// ranging results per second of a running anchor
+static float measure(uint16_t tags, uint8_t stride, const UWBRoundPlan& plan)
+{
+    static uint32_t sessionID = 0x3000;
+    uint8_t addr[2] = {0x11, 0x11};
+    UWBContentionAnchor anchor(sessionID++, UWBMacAddress(UWBMacAddress::Size::SHORT, addr), tags, updateRate, stride);
+    uint32_t first, last;
+
+    UWBHALSim.contentionTags(tags, stride);
+    if (anchor.init() != uwb::Status::SUCCESS || anchor.start() != uwb::Status::SUCCESS)
+        return -1;
+    sessionHandle = anchor.sessionHandle();
+
+    // from the first round notified to the last one, the rest is setup
+    first = UWBHALSim.rangingRounds();
+    while (UWBHALSim.rangingRounds() == first)
+        delay(1);
+    first = UWBHALSim.rangingRounds();
+    results = 0;
+    while (UWBHALSim.rangingRounds() - first < rounds)
+        delay(plan.rangingDuration / 4 + 1);
+    last = UWBHALSim.rangingRounds();
+
+    anchor.stop();
+    anchor.waitForState(UWBSessionState::IDLE);
+    anchor.deInit();
+    sessionHandle = 0;
+    return results * 1000.0f / ((last - first) * plan.rangingDuration);
+}
+
+static void printRow(const char* mode, uint16_t tags, uint8_t stride, const UWBRoundPlan& plan)
+{
+    float simulated = UWBRangingPlanner::simulate(tags, plan, 1000);
+    float measured = measure(tags, stride, plan);
+
+    printf("%-10s tags %2u cap %3u interval %3u ms  expected %6.1f/s  simulate() %6.1f/s  sim UWBS %6.1f/s\n",
+           mode, tags, plan.capSize, (unsigned)plan.rangingDuration, plan.throughput, simulated, measured);
+    fflush(stdout);
+}
+
+int main()
+{
+    UWBRoundPlan plan;
+
+    UWBHALSim.seed(3);
+    UWBHALSim.notificationDelay(1);
+    UWB.registerRangingCallback(ranging);
+    UWB.begin();
+
+    printf("%u rounds per row at %.0f Hz\n", (unsigned)rounds, updateRate);
+    for (uint16_t tags : tagCounts)
+    {
+        if (UWBRangingPlanner::planContention(tags, uwb::RangingMethod::DS_TWR_NO_DEFER, uwb::RfFrameConfig::SP3, updateRate, plan))
+            printRow("contention", tags, 0, plan);
+        if (UWBRangingPlanner::planContention(tags, uwb::RangingMethod::DS_TWR_NO_DEFER, uwb::RfFrameConfig::SP3, updateRate, plan, 1))
+            printRow("stride 1", tags, 1, plan);
+    }
+
+    fflush(stdout);
+    _Exit(0);
+}
@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// NearbyMessageParser throughput on randomly fragmented iOS and Android
+// sessions, built with the C library only
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "NearbyMessageParser.hpp"
+#include "NearbyCorpus.h"
+
+static const int sessions = 200000;
+static const int passes = 10;
+
+static double now()
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main()
+{
+    NearbyCorpus corpus(12345);
+    NearbyMessageParser parser;
+    NearbyMessage msg;
+    uint8_t* stream = (uint8_t*)malloc((size_t)sessions * NearbyCorpus::maxBytes);
+    uint8_t* writes = (uint8_t*)malloc((size_t)sessions * NearbyCorpus::maxBytes);
+    size_t* sessionEnd = (size_t*)malloc(sessions * sizeof(size_t));
+    size_t total = 0, numWrites = 0, offset, w, chunk;
+    unsigned long messages = 0;
+    double t0, generation, parsing;
+
+    if (stream == NULL || writes == NULL || sessionEnd == NULL)
+        return 1;
+
+    // the corpus and the lengths of the BLE writes, once
+    t0 = now();
+    for (int s = 0; s < sessions; ++s)
+    {
+        corpus.session();
+        memcpy(&stream[total], corpus.bytes, corpus.len);
+        for (offset = 0; offset < corpus.len; offset += chunk)
+        {
+            chunk = corpus.writeLength();
+            if (chunk > corpus.len - offset)
+                chunk = corpus.len - offset;
+            writes[numWrites++] = (uint8_t)chunk;
+        }
+        total += corpus.len;
+        sessionEnd[s] = total;
+    }
+    generation = now() - t0;
+
+    t0 = now();
+    for (int p = 0; p < passes; ++p)
+    {
+        offset = 0;
+        w = 0;
+        for (int s = 0; s < sessions; ++s)
+        {
+            parser.reset();
+            while (offset < sessionEnd[s])
+            {
+                chunk = writes[w++];
+                parser.feed(&stream[offset], chunk);
+                offset += chunk;
+                while (parser.next(msg))
+                    messages++;
+            }
+        }
+    }
+    parsing = (now() - t0) / passes;
+
+    printf("%d sessions, %zu bytes in %zu writes, %lu messages per pass\n",
+           sessions, total, numWrites, messages / passes);
+    printf("parsing: %.1f MB/s\n", total / parsing / 1e6);
+    printf("generation and parsing: %.1f MB/s\n", total / (generation + parsing) / 1e6);
+
+    free(stream);
+    free(writes);
+    free(sessionEnd);
+    return 0;
+}
@@ -0,0 +1,149 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// UWBChannelHopper on both ends of a link: a burst seen by both moves them
+// to the same next entry in one step, and a controlee that lost the
+// controller finds it again while the controller sweeps the sequence
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static const uint16_t roundMs = 20;
+
+static const uint8_t controllerAddr[2] = {0x11, 0x11};
+static const uint8_t controleeAddr[2] = {0x22, 0x22};
+
+static volatile uint32_t controllerHandle = 0;
+static volatile uint32_t controleeHandle = 0;
+static volatile uint32_t controllerResults = 0;
+static volatile uint32_t controleeResults = 0;
+
+void setup() {}
+void loop() {}
+
+static void ranging(UWBRangingData& data)
+{
+    RangingMeasures twr = data.twoWayRangingMeasure();
+
+    for (int i = 0; i < data.available() && i < uwb::MAX_RESPONDERS; ++i)
+    {
+        if (twr[i].status != 0)
+            continue;
+        if (data.sessionHandle() == controllerHandle)
+            controllerResults++;
+        else if (data.sessionHandle() == controleeHandle)
+            controleeResults++;
+    }
+}
+
+static void run(UWBChannelHopper& a, UWBChannelHopper& b, uint32_t ms)
+{
+    uint32_t start = millis();
+
+    while (millis() - start < ms)
+    {
+        a.update();
+        b.update();
+        delay(5);
+    }
+}
+
+// both ends range on the same entry
+static bool together(UWBChannelHopper& controller, UWBChannelHopper& controlee)
+{
+    uint32_t a = controllerResults;
+    uint32_t b = controleeResults;
+
+    run(controller, controlee, 10 * roundMs);
+    return controller.current() == controlee.current() &&
+           controllerResults - a >= 5 && controleeResults - b >= 5;
+}
+
+int main()
+{
+    UWBHoppingConfig cfg;
+    UWBHopStats st;
+    uint8_t before;
+    uint32_t start;
+
+    cfg.channels[0] = 5;
+    cfg.channels[1] = 6;
+    cfg.channels[2] = 8;
+    cfg.channels[3] = 9;
+    cfg.preambleCodes[0] = 9;
+    cfg.preambleCodes[1] = 10;
+    cfg.preambleCodes[2] = 11;
+    cfg.preambleCodes[3] = 12;
+    cfg.numEntries = 4;
+    cfg.key = 0x5EED1234;
+    cfg.failThreshold = 3;
+    cfg.roundHopping = false;
+
+    UWBHALSim.seed(11);
+    UWBHALSim.notificationDelay(1);
+    UWB.registerRangingCallback(ranging);
+    UWB.begin();
+
+    UWBRangingController controllerSession(0x600, UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)controllerAddr),
+                                           UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)controleeAddr));
+    UWBRangingControlee controleeSession(0x601, UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)controleeAddr),
+                                         UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)controllerAddr));
+    UWBChannelHopper controller(controllerSession, cfg);
+    UWBChannelHopper controlee(controleeSession, cfg);
+
+    controllerSession.appParams.rangingDuration(roundMs);
+    controleeSession.appParams.rangingDuration(roundMs);
+    SIM_CHECK(controller.begin());
+    SIM_CHECK(controlee.begin());
+    SIM_CHECK(controllerSession.init() == uwb::Status::SUCCESS);
+    SIM_CHECK(controleeSession.init() == uwb::Status::SUCCESS);
+    controllerHandle = controllerSession.sessionHandle();
+    controleeHandle = controleeSession.sessionHandle();
+    SIM_CHECK(UWBHALSim.linkSessions(controllerHandle, controleeHandle));
+    SIM_CHECK(controllerSession.start() == uwb::Status::SUCCESS);
+    SIM_CHECK(controleeSession.start() == uwb::Status::SUCCESS);
+    SIM_CHECK(together(controller, controlee));
+    SIM_CHECK(controller.hops() == 0 && controlee.hops() == 0);
+
+    // a burst on the current channel, seen by both ends
+    before = controller.current();
+    UWBHALSim.jamChannel(cfg.channels[before], true);
+    start = millis();
+    while (controller.hops() + controlee.hops() < 2 && millis() - start < 2000)
+        run(controller, controlee, roundMs);
+    SIM_CHECK(together(controller, controlee));
+    controller.stats(before, st);
+    printf("burst on channel %u: the controller hopped %u times and the controlee %u, both on entry %u\n",
+           st.channel, controller.hops(), controlee.hops(), controlee.current());
+    SIM_CHECK(controller.hops() == 1 && controlee.hops() == 1);
+    SIM_CHECK(controller.current() != before);
+    UWBHALSim.jamChannel(cfg.channels[before], false);
+
+    // the controller moves two entries ahead: the controlee follows one
+    // step, then waits on its entry until the controller comes around
+    controller.hop();
+    controller.hop();
+    start = millis();
+    while (controller.current() != controlee.current() && millis() - start < 5000)
+        run(controller, controlee, roundMs);
+    SIM_CHECK(together(controller, controlee));
+    printf("lost controller: found again after %u ms, %u and %u hops\n",
+           (unsigned)(millis() - start), controller.hops(), controlee.hops());
+    SIM_CHECK(controlee.hops() == 2);
+
+    // back in step: the next burst takes one hop again
+    before = controller.current();
+    UWBHALSim.jamChannel(cfg.channels[before], true);
+    start = millis();
+    uint32_t hops = controller.hops() + controlee.hops();
+    while (controller.hops() + controlee.hops() < hops + 2 && millis() - start < 2000)
+        run(controller, controlee, roundMs);
+    SIM_CHECK(together(controller, controlee));
+    SIM_CHECK(controller.current() != before);
+    SIM_CHECK(controller.hops() + controlee.hops() == hops + 2);
+
+    controller.end();
+    controlee.end();
+    simTestExit();
+}
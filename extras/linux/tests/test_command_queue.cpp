@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// UWBCommandQueue with a per-command latency injected in the simulated UWBS
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static const uint32_t latency = 10;     // ms per HAL command
+static const int numSessions = 3;
+
+static volatile int completions = 0;
+static volatile uint8_t lastStatus = 0;
+
+void setup() {}
+void loop() {}
+
+static void completed(UWBSession& session, UWBCommandType command, uwb::Status status, void* context)
+{
+    (void)session;
+    (void)command;
+    (void)context;
+    lastStatus = (uint8_t)status;
+    completions++;
+}
+
+static UWBMacAddress shortAddr(uint8_t lo, uint8_t hi)
+{
+    uint8_t addr[2] = {lo, hi};
+
+    return UWBMacAddress(UWBMacAddress::Size::SHORT, addr);
+}
+
+int main()
+{
+    uint32_t start, inlineMs, batchMs;
+
+    UWBHALSim.notificationDelay(1);
+    UWB.begin();
+    SIM_CHECK(UWBCommandQueue.running());
+    UWBHALSim.commandLatency(latency);
+
+    // one session inline: the cost of a bring up, latency included
+    UWBRangingController single(0x100, shortAddr(0x11, 0x11), shortAddr(0x22, 0x22));
+    start = millis();
+    SIM_CHECK(single.init() == uwb::Status::SUCCESS);
+    SIM_CHECK(single.start() == uwb::Status::SUCCESS);
+    inlineMs = millis() - start;
+    single.stop();
+    single.deInit();
+
+    // the same bring up of several sessions as one batch
+    for (int i = 0; i < numSessions; ++i)
+    {
+        UWBRangingController s(0x200 + i, shortAddr(0x11, 0x11), shortAddr(0x30 + i, 0x22));
+        SIM_CHECK(UWBSessionManager.addSession(s));
+    }
+    start = millis();
+    SIM_CHECK(UWBSessionManager.initSessions() == uwb::Status::SUCCESS);
+    SIM_CHECK(UWBSessionManager.startSessions() == uwb::Status::SUCCESS);
+    batchMs = millis() - start;
+    printf("bring up with %u ms per command: %u ms inline, %u ms for %d sessions batched\n",
+           latency, inlineMs, batchMs, numSessions);
+    // the HAL blocks, the batch can not overlap the commands but adds no gaps
+    SIM_CHECK(inlineMs >= 4 * latency);
+    SIM_CHECK(batchMs >= numSessions * 4 * latency);
+    SIM_CHECK(batchMs <= numSessions * (inlineMs + latency));
+    for (int i = 0; i < numSessions; ++i)
+        SIM_CHECK(UWBSessionManager.sessions[i]->waitForState(UWBSessionState::ACTIVE) == uwb::Status::SUCCESS);
+
+    // deadlines: the commands that wait longer than their timeout are not sent
+    UWBHALSim.commandLatency(50);
+    UWBCommandBatch batch;
+    uint32_t timeouts = UWBCommandQueue.timeouts();
+    completions = 0;
+    for (int i = 0; i < numSessions; ++i)
+        SIM_CHECK(UWBCommandQueue.submit(*UWBSessionManager.sessions[i], UWBCommandType::STOP, &batch, completed, nullptr, 70));
+    SIM_CHECK(batch.wait(1000) == uwb::Status::TIMEOUT);
+    printf("stops with a 70 ms deadline at 50 ms per command: %d completed, %u expired\n",
+           completions, UWBCommandQueue.timeouts() - timeouts);
+    SIM_CHECK(completions == numSessions);
+    SIM_CHECK(UWBCommandQueue.timeouts() - timeouts == 1);
+    SIM_CHECK(lastStatus == (uint8_t)uwb::Status::TIMEOUT);
+    SIM_CHECK(UWBSessionManager.sessions[numSessions - 1]->currentState() == UWBSessionState::ACTIVE);
+
+    simTestExit();
+}
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// UWBSessionMultiplexer switching one hardware slot between logical
+// sessions that share the UWBS session, each with its own controlee
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static const int numLogical = 3;
+static const uint32_t slice = 100;      // ms
+
+static uint8_t peerAddrs[numLogical][2] = {{0x21, 0x22}, {0x31, 0x32}, {0x41, 0x42}};
+static volatile uint32_t seen[numLogical];
+static volatile uint32_t strangers = 0;
+
+void setup() {}
+void loop() {}
+
+static void ranging(UWBRangingData& data)
+{
+    RangingMeasures twr = data.twoWayRangingMeasure();
+    int found;
+
+    for (int i = 0; i < data.available() && i < uwb::MAX_RESPONDERS; ++i)
+    {
+        found = -1;
+        for (int j = 0; j < numLogical; ++j)
+        {
+            if (memcmp(twr[i].peer_addr, peerAddrs[j], 2) == 0)
+                found = j;
+        }
+        if (found < 0)
+            strangers++;
+        else
+            seen[found]++;
+    }
+}
+
+int main()
+{
+    uint8_t src[2] = {0x11, 0x11};
+    UWBSessionMultiplexer mux(1, slice);
+    uint32_t start;
+
+    UWBHALSim.notificationDelay(1);
+    UWB.registerRangingCallback(ranging);
+    UWB.begin();
+
+    // same session ID and type: the slot is switched by reconfigure()
+    for (int i = 0; i < numLogical; ++i)
+    {
+        UWBRangingController s(0x500, UWBMacAddress(UWBMacAddress::Size::SHORT, src),
+                               UWBMacAddress(UWBMacAddress::Size::SHORT, peerAddrs[i]));
+        s.appParams.rangingDuration(20);
+        SIM_CHECK(mux.addSession(s) == i);
+    }
+
+    SIM_CHECK(mux.begin() == uwb::Status::SUCCESS);
+    start = millis();
+    while (millis() - start < 2 * numLogical * slice + slice / 2)
+    {
+        mux.update();
+        delay(5);
+    }
+    mux.end();
+
+    printf("%u fast and %u full switches, results per peer %u %u %u, %u from unknown peers\n",
+           mux.fastSwitches(), mux.fullSwitches(), seen[0], seen[1], seen[2], strangers);
+    SIM_CHECK(mux.fullSwitches() == 1);
+    SIM_CHECK(mux.fastSwitches() >= 2 * numLogical - 1);
+    for (int i = 0; i < numLogical; ++i)
+        SIM_CHECK(seen[i] > 0);
+    SIM_CHECK(strangers == 0);
+
+    simTestExit();
+}
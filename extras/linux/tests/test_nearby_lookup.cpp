@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// NearbySessionManager finding the session of a phone by its address, as
+// the BLE callbacks do for every write
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static const char* addrs[] = {"aa:bb:cc:dd:ee:01", "aa:bb:cc:dd:ee:02", "11:bb:cc:dd:ee:01"};
+static const int numPhones = sizeof(addrs) / sizeof(addrs[0]);
+
+void setup() {}
+void loop() {}
+
+static void settle(int ms)
+{
+    for (int i = 0; i < ms / 10; ++i)
+    {
+        delay(10);
+        UWBNearbySessionManager.poll();
+    }
+}
+
+// the session of the phone, not one of another phone or the empty one
+static bool found(BLEDevice& phone)
+{
+    NearbySession& s = UWBNearbySessionManager.find(phone);
+
+    return s.bleDevice() == phone;
+}
+
+int main()
+{
+    BLEDevice phones[numPhones] = {BLEDevice(addrs[0]), BLEDevice(addrs[1]), BLEDevice(addrs[2])};
+    BLEDevice stranger("aa:bb:cc:dd:ee:03");
+    uint32_t firstID;
+    int i;
+
+    UWBHALSim.notificationDelay(1);
+    UWBNearbySessionManager.begin("sim");
+    for (i = 0; i < numPhones; ++i)
+        BLE.simulateConnect(phones[i]);
+    settle(20);
+    SIM_CHECK(UWBNearbySessionManager.numSessions == numPhones);
+
+    // in any order, the last byte or the first one differing
+    for (i = numPhones - 1; i >= 0; --i)
+        SIM_CHECK(found(phones[i]));
+    SIM_CHECK(found(phones[0]) && found(phones[2]) && found(phones[0]));
+    SIM_CHECK(!found(stranger));
+    firstID = UWBNearbySessionManager.find(phones[1]).sessionID();
+
+    // gone with the disconnect, a new session when the phone comes back
+    BLE.simulateDisconnect(phones[1]);
+    settle(200);
+    SIM_CHECK(UWBNearbySessionManager.numSessions == numPhones - 1);
+    SIM_CHECK(!found(phones[1]));
+    SIM_CHECK(found(phones[0]) && found(phones[2]));
+    BLE.simulateConnect(phones[1]);
+    settle(20);
+    SIM_CHECK(found(phones[1]));
+    printf("session of %s: %u, then %u after a reconnection\n", addrs[1], (unsigned)firstID,
+           (unsigned)UWBNearbySessionManager.find(phones[1]).sessionID());
+    SIM_CHECK(UWBNearbySessionManager.find(phones[1]).sessionID() != firstID);
+
+    simTestExit();
+}
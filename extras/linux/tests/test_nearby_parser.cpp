@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// NearbyMessageParser on randomly fragmented iOS and Android sessions,
+// built with the C library only
+
+#include <string.h>
+#include "NearbyMessageParser.hpp"
+#include "NearbyCorpus.h"
+#include "SimTest.h"
+
+static const int sessions = 200000;
+
+int main()
+{
+    NearbyCorpus corpus(12345);
+    NearbyMessageParser parser;
+    NearbyMessage msg;
+    size_t offset, chunk, msgStart;
+    size_t got;
+    long mismatches = 0;
+    unsigned long messages = 0;
+
+    for (int s = 0; s < sessions; ++s)
+    {
+        corpus.session();
+        parser.reset();
+        got = 0;
+        msgStart = 0;
+        for (offset = 0; offset < corpus.len; offset += chunk)
+        {
+            chunk = corpus.writeLength();
+            if (chunk > corpus.len - offset)
+                chunk = corpus.len - offset;
+            if (!parser.feed(&corpus.bytes[offset], chunk))
+                mismatches++;
+            while (parser.next(msg))
+            {
+                if (got >= corpus.numMessages || msg.id != corpus.ids[got] || msg.len != corpus.lens[got] ||
+                    msgStart + msg.len > corpus.len ||
+                    memcmp(msg.data, &corpus.bytes[msgStart], msg.len) != 0)
+                    mismatches++;
+                msgStart += msg.len;
+                got++;
+            }
+        }
+        if (got != corpus.numMessages || parser.pending() != 0 || parser.errors() != 0)
+            mismatches++;
+        messages += got;
+    }
+    printf("%d sessions, %lu messages, %ld mismatches\n", sessions, messages, mismatches);
+    SIM_CHECK(mismatches == 0);
+
+    // a write longer than the buffer is dropped, the parser goes on
+    uint8_t big[NearbyMessageParser::bufferSize + 1];
+    uint8_t stop = kMsg_Stop;
+    memset(big, kMsg_Stop, sizeof(big));
+    parser.reset();
+    SIM_CHECK(!parser.feed(big, sizeof(big)));
+    SIM_CHECK(parser.errors() == 1);
+    SIM_CHECK(parser.feed(&stop, 1));
+    SIM_CHECK(parser.next(msg) && msg.id == kMsg_Stop && msg.len == 1);
+
+    // an unknown ID takes all the bytes buffered
+    uint8_t unknown[4] = {0x7F, 1, 2, 3};
+    SIM_CHECK(parser.feed(unknown, sizeof(unknown)));
+    SIM_CHECK(parser.next(msg) && msg.id == 0x7F && msg.len == sizeof(unknown));
+    SIM_CHECK(!parser.next(msg));
+
+    simTestExit();
+}
@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// NearbySessionManager with its event queue full: a dropped write does not
+// desynchronize the message parser of the phone, a disconnect is never lost
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static const char* rxUuid = "6E400002-B5A3-F393-E0A9-E50E24DCCA9E";
+static const char* txUuid = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E";
+
+static volatile int didStop = 0;
+static volatile int sessionsStopped = 0;
+
+void setup() {}
+void loop() {}
+
+static void written(const char* uuid, const uint8_t* value, int length)
+{
+    if (strcmp(uuid, txUuid) == 0 && length > 0 && value[0] == kRsp_UwbDidStop)
+        didStop++;
+}
+
+static void stopped(BLEDevice dev)
+{
+    (void)dev;
+    sessionsStopped++;
+}
+
+static void write(BLEDevice& phone, const uint8_t* data, int len)
+{
+    BLE.simulateWrite(phone, rxUuid, data, len);
+    UWBNearbySessionManager.poll();
+}
+
+static void settle(int ms)
+{
+    for (int i = 0; i < ms / 10; ++i)
+    {
+        delay(10);
+        UWBNearbySessionManager.poll();
+    }
+}
+
+int main()
+{
+    BLEDevice phone("aa:bb:cc:dd:ee:01");
+    const uint8_t init = kMsg_Initialize_iOS;
+    const uint8_t unknown = 0x7F;
+    const uint8_t stop = kMsg_Stop;
+    // the first part of a ConfigureAndStart, the rest is dropped below
+    const uint8_t configHead[5] = {kMsg_ConfigureAndStart, 0x01, 0x00, 0x00, 0x00};
+    const uint8_t configTail[8] = {0x20, 0, 0, 0, 0, 0, 0, 0};
+
+    UWBHALSim.notificationDelay(1);
+    BLE.onValueWritten(written);
+    UWBNearbySessionManager.onSessionStop(stopped);
+    UWBNearbySessionManager.begin("sim");
+    BLE.simulateConnect(phone);
+    settle(20);
+    SIM_CHECK(UWBNearbySessionManager.numSessions == 1);
+
+    // the worker is busy with the first message while the queue fills up
+    UWBHALSim.commandLatency(300);
+    write(phone, &init, 1);
+    delay(50);
+    for (int i = 0; i < UWB_NEARBY_QUEUE_DEPTH - 1; ++i)
+        write(phone, &unknown, 1);
+    write(phone, configHead, sizeof(configHead));
+    write(phone, configTail, sizeof(configTail));      // dropped
+    UWBHALSim.commandLatency(0);
+    settle(500);
+
+    // without a resync the Stop would complete the ConfigureAndStart head
+    write(phone, &stop, 1);
+    settle(200);
+    printf("stop after a dropped write: %d kRsp_UwbDidStop\n", didStop);
+    SIM_CHECK(didStop == 1);
+
+    // the disconnect does not fit the queue either, another phone fills it
+    BLEDevice other("aa:bb:cc:dd:ee:02");
+    BLE.simulateConnect(other);
+    settle(20);
+    UWBHALSim.commandLatency(300);
+    write(other, &init, 1);
+    delay(50);
+    for (int i = 0; i < UWB_NEARBY_QUEUE_DEPTH; ++i)
+        write(other, &unknown, 1);
+    BLE.simulateDisconnect(phone);
+    UWBNearbySessionManager.poll();
+    UWBHALSim.commandLatency(0);
+    settle(1000);
+    printf("disconnect with the queue full: %d sessions left, %d stopped\n",
+           UWBNearbySessionManager.numSessions, sessionsStopped);
+    SIM_CHECK(UWBNearbySessionManager.numSessions == 1);
+    SIM_CHECK(sessionsStopped == 2);
+
+    simTestExit();
+}
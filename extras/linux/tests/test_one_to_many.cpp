@@ -0,0 +1,87 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// Controlees joining a live one-to-many session: a planned round is planned
+// again with a slot for the newcomer, a round sized by hand that is full
+// rejects it
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static uint8_t srcAddr[2] = {0x11, 0x11};
+static uint8_t peerAddrs[4][2] = {{0x21, 0x21}, {0x22, 0x22}, {0x23, 0x23}, {0x24, 0x24}};
+static volatile uint32_t seen[4];
+
+void setup() {}
+void loop() {}
+
+static void ranging(UWBRangingData& data)
+{
+    RangingMeasures twr = data.twoWayRangingMeasure();
+
+    for (int i = 0; i < data.available() && i < uwb::MAX_RESPONDERS; ++i)
+    {
+        for (int j = 0; j < 4; ++j)
+        {
+            if (twr[i].status == 0 && memcmp(twr[i].peer_addr, peerAddrs[j], 2) == 0)
+                seen[j]++;
+        }
+    }
+}
+
+static uint32_t param(UWBSession& s, uwb::AppConfigId id)
+{
+    uwb::AppConfig* p = s.appParams.findParam(id);
+
+    return p != nullptr ? p->param_value.vu32 : 0;
+}
+
+int main()
+{
+    UWBMacAddressList peers(UWBMacAddress::Size::SHORT);
+    UWBMacAddress first(UWBMacAddress::Size::SHORT, peerAddrs[0]);
+    UWBMacAddress second(UWBMacAddress::Size::SHORT, peerAddrs[1]);
+    UWBMacAddress third(UWBMacAddress::Size::SHORT, peerAddrs[2]);
+    UWBMacAddress fourth(UWBMacAddress::Size::SHORT, peerAddrs[3]);
+    uint32_t before;
+
+    UWBHALSim.notificationDelay(1);
+    UWB.registerRangingCallback(ranging);
+    UWB.begin();
+
+    peers.add(first);
+    peers.add(second);
+
+    // planned for two controlees at 20 Hz
+    UWBRangingOneToMany planned(0x700, UWBMacAddress(UWBMacAddress::Size::SHORT, srcAddr), peers, 20);
+    before = param(planned, uwb::AppConfigId::SlotsPerRound);
+    SIM_CHECK(before == UWBRangingPlanner::slotsNeeded(2, uwb::RangingMethod::DS_TWR));
+    SIM_CHECK(planned.plannedRate() == 20);
+    SIM_CHECK(planned.init() == uwb::Status::SUCCESS);
+    SIM_CHECK(planned.start() == uwb::Status::SUCCESS);
+    SIM_CHECK(planned.addControlee(third) == uwb::Status::SUCCESS);
+    printf("planned round: %u slots for 2 controlees, %u for 3\n",
+           (unsigned)before, (unsigned)param(planned, uwb::AppConfigId::SlotsPerRound));
+    SIM_CHECK(param(planned, uwb::AppConfigId::SlotsPerRound) == UWBRangingPlanner::slotsNeeded(3, uwb::RangingMethod::DS_TWR));
+    SIM_CHECK(planned.waitForState(UWBSessionState::ACTIVE) == uwb::Status::SUCCESS);
+    delay(300);
+    SIM_CHECK(seen[2] > 0);
+    planned.stop();
+    planned.waitForState(UWBSessionState::IDLE);
+    planned.deInit();
+
+    // sized by hand for two controlees: no slot for a third one
+    UWBRangingOneToMany fixed(0x701, UWBMacAddress(UWBMacAddress::Size::SHORT, srcAddr), peers);
+    fixed.appParams.slotPerRR(UWBRangingPlanner::slotsNeeded(2, uwb::RangingMethod::DS_TWR));
+    SIM_CHECK(fixed.init() == uwb::Status::SUCCESS);
+    SIM_CHECK(fixed.addControlee(fourth) == uwb::Status::INVALID_RANGE);
+    SIM_CHECK(fixed.numControlees() == 2);
+
+    // the default 25 slots fit it
+    UWBRangingOneToMany spacious(0x702, UWBMacAddress(UWBMacAddress::Size::SHORT, srcAddr), peers);
+    SIM_CHECK(spacious.addControlee(fourth) == uwb::Status::SUCCESS);
+    SIM_CHECK(spacious.numControlees() == 3);
+
+    simTestExit();
+}
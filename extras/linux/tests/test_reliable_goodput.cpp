@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// UWBInBandDataTx::sendReliable() goodput with data frames lost by the
+// simulated link. Both ends are sessions of the same simulated UWBS: the
+// frames that get through are injected in the other session.
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static const uint16_t roundMs = 20;
+static const size_t msgLen = 2000;
+static const int messages = 4;
+static const uint32_t msgTimeout = 30000;
+
+static const uint8_t txAddr[2] = {0x11, 0x11};
+static const uint8_t rxAddr[2] = {0x22, 0x22};
+
+static UWBInBandDataTx* tx;
+static UWBInBandDataRx* rx;
+static volatile int acksToDrop = 0;
+static volatile uint32_t acksDropped = 0;
+
+static uint8_t sent[msgLen];
+static uint8_t received[msgLen];
+static volatile int receivedOk = 0;
+static volatile int receivedBad = 0;
+
+void setup() {}
+void loop() {}
+
+static void ranging(UWBRangingData& data)
+{
+    (void)data;
+}
+
+// called by the simulator thread with the frames that reached the peer
+static void deliver(const uwb::DataPacket& packet)
+{
+    if (packet.session_handle == tx->sessionHandle())
+    {
+        UWBHALSim.injectData(rx->sessionHandle(), txAddr, packet.data, packet.data_size);
+    }
+    else if (packet.session_handle == rx->sessionHandle())
+    {
+        if (acksToDrop > 0)
+        {
+            acksToDrop--;
+            acksDropped++;
+            return;
+        }
+        UWBHALSim.injectData(tx->sessionHandle(), rxAddr, packet.data, packet.data_size);
+    }
+}
+
+static void receiverTask(void* arg)
+{
+    size_t len;
+
+    (void)arg;
+    for (;;)
+    {
+        if (rx->receive(received, sizeof(received), len, msgTimeout) != uwb::Status::SUCCESS)
+            continue;
+        if (len == msgLen && memcmp(received, sent, msgLen) == 0)
+            receivedOk++;
+        else
+            receivedBad++;
+    }
+}
+
+static void fill(uint8_t seed)
+{
+    for (size_t i = 0; i < msgLen; ++i)
+        sent[i] = (uint8_t)(i * 31 + seed);
+}
+
+// send some messages, waiting for each one to be received
+static bool run(float loss, int count)
+{
+    float goodput = 0;
+    int ok = receivedOk;
+    uint32_t retx = tx->retransmissions();
+    bool success = true;
+
+    UWBHALSim.packetLoss(loss);
+    for (int m = 0; m < count && success; ++m)
+    {
+        fill((uint8_t)m);
+        success = tx->sendReliable(sent, msgLen, msgTimeout) == uwb::Status::SUCCESS;
+        goodput += tx->goodput();
+        // the last acknowledgement may precede the end of receive()
+        for (int i = 0; i < 100 && receivedOk + receivedBad < ok + m + 1; ++i)
+            delay(5);
+    }
+    printf("loss %3.0f%%: %5.0f B/s, %u retransmissions, rtt %.1f rto %.1f rounds\n",
+           loss * 100, goodput / count, tx->retransmissions() - retx, tx->rtt(), tx->rto());
+    SIM_CHECK(success);
+    SIM_CHECK(receivedOk - ok == count);
+    return success;
+}
+
+static void configure(UWBSession& s)
+{
+    s.appParams.rangingDuration(roundMs);
+}
+
+int main()
+{
+    float rtoBefore, rtoAfter;
+
+    UWBHALSim.seed(7);
+    UWBHALSim.notificationDelay(1);
+    UWBHALSim.onSendData(deliver);
+    UWB.registerRangingCallback(ranging);
+    UWB.begin();
+
+    tx = new UWBInBandDataTx(0x4000, UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)txAddr),
+                             UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)rxAddr));
+    rx = new UWBInBandDataRx(0x4001, UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)rxAddr),
+                             UWBMacAddress(UWBMacAddress::Size::SHORT, (uint8_t*)txAddr));
+    tx->enableAcks();
+    rx->enableAcks();
+    configure(*tx);
+    configure(*rx);
+    SIM_CHECK(rx->init() == uwb::Status::SUCCESS);
+    SIM_CHECK(rx->start() == uwb::Status::SUCCESS);
+    SIM_CHECK(tx->init() == uwb::Status::SUCCESS);
+    SIM_CHECK(tx->start() == uwb::Status::SUCCESS);
+    xTaskCreate(receiverTask, "rx", 4096, nullptr, 1, nullptr);
+
+    printf("%u byte messages, %u ms rounds\n", (unsigned)msgLen, roundMs);
+    // no loss: every fragment goes through the first time
+    run(0, messages);
+    SIM_CHECK(tx->retransmissions() == 0);
+    SIM_CHECK(tx->rtt() > 0);
+
+    // lost fragments: the selective acknowledgements ask for them again
+    run(0.1f, messages);
+    SIM_CHECK(tx->retransmissions() > 0);
+    run(0.3f, messages);
+
+    // lost acknowledgements: the retransmission timeout expires and doubles
+    UWBHALSim.packetLoss(0);
+    rtoBefore = tx->rto();
+    acksToDrop = 1;
+    fill(0xA5);
+    SIM_CHECK(tx->sendReliable(sent, msgLen, msgTimeout) == uwb::Status::SUCCESS);
+    rtoAfter = tx->rto();
+    printf("acknowledgement dropped: rto %.1f -> %.1f rounds\n", rtoBefore, rtoAfter);
+    SIM_CHECK(acksDropped == 1);
+    SIM_CHECK(rtoAfter >= 2 * rtoBefore || rtoAfter == UWBInBandDataTx::maxRto);
+    SIM_CHECK(receivedBad == 0);
+    SIM_CHECK(rx->dropped() == 0);
+
+    simTestExit();
+}
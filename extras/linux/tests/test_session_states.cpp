@@ -0,0 +1,69 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+// UWBSessionStates with more sessions than entries: the live sessions keep
+// their state, the entries of deinitialized ones are reused, and a reset
+// records the state every session had before it
+
+#include "PortentaUWBShield.h"
+#include "UwbHalSim.hpp"
+#include "SimTest.h"
+
+static const int numSessions = UWBSessionStates_::maxEntries + 1;
+
+void setup() {}
+void loop() {}
+
+static void ranging(UWBRangingData& data)
+{
+    (void)data;
+}
+
+int main()
+{
+    static UWBRangingController* sessions[numSessions];
+    uint8_t src[2] = {0x11, 0x11};
+    uint8_t dst[2] = {0x22, 0x22};
+    int i;
+
+    UWBHALSim.notificationDelay(1);
+    UWB.registerRangingCallback(ranging);
+    UWB.begin();
+
+    for (i = 0; i < numSessions; ++i)
+    {
+        sessions[i] = new UWBRangingController(0x800 + i, UWBMacAddress(UWBMacAddress::Size::SHORT, src),
+                                               UWBMacAddress(UWBMacAddress::Size::SHORT, dst));
+        sessions[i]->init();
+    }
+    for (i = 0; i < numSessions - 1; ++i)
+        SIM_CHECK(sessions[i]->waitForState(UWBSessionState::IDLE) == uwb::Status::SUCCESS);
+    SIM_CHECK(sessions[0]->start() == uwb::Status::SUCCESS);
+    SIM_CHECK(sessions[0]->waitForState(UWBSessionState::ACTIVE) == uwb::Status::SUCCESS);
+
+    // no room for the last one: the others are live
+    delay(20);
+    printf("%d sessions, %d entries: the last one is %s\n", numSessions, UWBSessionStates_::maxEntries,
+           sessions[numSessions - 1]->currentState() == UWBSessionState::UNKNOWN ? "not tracked" : "tracked");
+    SIM_CHECK(sessions[numSessions - 1]->currentState() == UWBSessionState::UNKNOWN);
+    SIM_CHECK(sessions[0]->currentState() == UWBSessionState::ACTIVE);
+    for (i = 1; i < numSessions - 1; ++i)
+        SIM_CHECK(sessions[i]->currentState() == UWBSessionState::IDLE);
+
+    // a deinitialized session gives its entry to the next one
+    sessions[numSessions - 1]->deInit();
+    SIM_CHECK(sessions[1]->deInit() == uwb::Status::SUCCESS);
+    SIM_CHECK(sessions[1]->waitForState(UWBSessionState::DEINIT) == uwb::Status::SUCCESS);
+    SIM_CHECK(sessions[numSessions - 1]->init() == uwb::Status::SUCCESS);
+    SIM_CHECK(sessions[numSessions - 1]->waitForState(UWBSessionState::IDLE) == uwb::Status::SUCCESS);
+    SIM_CHECK(sessions[0]->currentState() == UWBSessionState::ACTIVE);
+
+    // the reset takes every live session down
+    UWBHAL.reset();
+    SIM_CHECK(sessions[0]->waitForState(UWBSessionState::DEINIT) == uwb::Status::SUCCESS);
+    SIM_CHECK(UWBSessionStates.stateBeforeReset(sessions[0]->sessionHandle()) == UWBSessionState::ACTIVE);
+    SIM_CHECK(UWBSessionStates.stateBeforeReset(sessions[2]->sessionHandle()) == UWBSessionState::IDLE);
+    SIM_CHECK(UWBSessionStates.stateBeforeReset(sessions[1]->sessionHandle()) == UWBSessionState::UNKNOWN);
+
+    simTestExit();
+}
@@ -2,7 +2,10 @@
 #define ARDUWB_H
 #include <Arduino.h>
 #include "uwbapps/UWB.hpp"
+#include "uwbapps/NearbyMessageParser.hpp"
+#include "uwbapps/NearbyConfigCache.hpp"
 #include "uwbapps/NearbySession.hpp"
+#include "uwbapps/NearbyLatency.hpp"
 #include "uwbapps/NearbySessionManager.hpp"
 #include "uwbapps/UWBRangingControlee.hpp"
 #include "uwbapps/UWBRangingController.hpp"
@@ -11,4 +14,16 @@
 #include "uwbapps/UWBMultiSessionTag.hpp"
 #include "uwbapps/UWBUltdoaAnchor.hpp"
 #include "uwbapps/UWBUltdoaSyncAnchor.hpp"
+#include "uwbapps/UWBSessionSnapshot.hpp"
+#include "uwbapps/UWBCommandQueue.hpp"
+#include "uwbapps/UWBSessionMultiplexer.hpp"
+#include "uwbapps/UWBRangingPlanner.hpp"
+#include "uwbapps/UWBContentionAnchor.hpp"
+#include "uwbapps/UWBContentionTag.hpp"
+#include "uwbapps/UWBHusSession.hpp"
+#include "uwbapps/UWBChannelHopper.hpp"
+#include "uwbapps/UWBInbandDataTx.hpp"
+#include "uwbapps/UWBInbandDataRx.hpp"
+#include "uwbapps/UWBInbandStream.hpp"
+#include "uwbapps/UWBTelemetryCodec.hpp"
 #endif
@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "NearbyConfigCache.hpp"
+#include "UWBNotification.hpp"
+
+static const uint8_t noSpec[2] = {0, 0};
+
+NearbyConfigCache_::NearbyConfigCache_()
+{
+    for (int i = 0; i < maxEntries; ++i)
+        entries[i].valid = false;
+    generation = 0;
+    handlersRegistered = false;
+    macState = 1;
+}
+
+void NearbyConfigCache_::freshMac(uint8_t mac[2])
+{
+    uint32_t x = macState ^ micros();
+    uint16_t addr = 0;
+
+    // xorshift stirred by the arrival time of the phones, 0000 and FFFF
+    // are not valid short addresses
+    while (addr == 0 || addr == 0xFFFF)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        addr = x >> 16;
+    }
+    macState = x;
+    mac[0] = addr & 0xFF;
+    mac[1] = addr >> 8;
+}
+
+void NearbyConfigCache_::registerHandlers()
+{
+    if (handlersRegistered)
+        return;
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::DEVICE_RESET, resetHandler);
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::RECOVERY_NTF, resetHandler);
+    handlersRegistered = true;
+}
+
+NearbyConfigCache_::Entry* NearbyConfigCache_::find(uint8_t kind, uwb::DeviceRole role, const uint8_t specMajor[2], const uint8_t specMinor[2])
+{
+    for (int i = 0; i < maxEntries; ++i)
+    {
+        Entry& e = entries[i];
+        if (e.valid && e.kind == kind && e.role == role &&
+            memcmp(e.specMajor, specMajor, 2) == 0 && memcmp(e.specMinor, specMinor, 2) == 0)
+            return &e;
+    }
+    return nullptr;
+}
+
+NearbyConfigCache_::Entry* NearbyConfigCache_::store(uint8_t kind, uwb::DeviceRole role, const uint8_t specMajor[2], const uint8_t specMinor[2])
+{
+    Entry* e = &entries[0];
+
+    for (int i = 0; i < maxEntries; ++i)
+    {
+        if (!entries[i].valid)
+        {
+            e = &entries[i];
+            break;
+        }
+    }
+    e->kind = kind;
+    e->role = role;
+    memcpy(e->specMajor, specMajor, 2);
+    memcpy(e->specMinor, specMinor, 2);
+    return e;
+}
+
+uwb::Status NearbyConfigCache_::iOS(uwb::DeviceRole role, const uint8_t specMajor[2], const uint8_t specMinor[2], uwb::AccessoryConfigData& config)
+{
+    uwb::Status status;
+    uint32_t gen = generation;
+    Entry* e;
+
+    registerHandlers();
+    e = find(KIND_IOS, role, specMajor, specMinor);
+    if (e != nullptr)
+    {
+        UWBHAL.Log_D("iOS config data from cache");
+        config = e->iosData;
+        freshMac(config.device_mac_addr);
+        return uwb::Status::SUCCESS;
+    }
+
+    status = UWBHAL.getUwbConfigData_iOS(role, config);
+    if (status == uwb::Status::HPDWKUP)
+    {
+        UWBHAL.Log_W("Device woke up from HPD");
+        UWBHAL.setDefaultCoreConfigs();
+        status = UWBHAL.getUwbConfigData_iOS(role, config);
+    }
+    // a reset while reading could have made the answer stale
+    if (status == uwb::Status::SUCCESS && gen == generation)
+    {
+        e = store(KIND_IOS, role, specMajor, specMinor);
+        e->iosData = config;
+        memset(e->iosData.device_mac_addr, 0, sizeof(e->iosData.device_mac_addr));
+        macState ^= config.device_mac_addr[0] | (config.device_mac_addr[1] << 8);
+        e->valid = true;
+    }
+    return status;
+}
+
+uwb::Status NearbyConfigCache_::android(uwb::DeviceConfig& config)
+{
+    uwb::Status status;
+    uint32_t gen = generation;
+    Entry* e;
+
+    registerHandlers();
+    e = find(KIND_ANDROID, uwb::DeviceRole::RESPONDER, noSpec, noSpec);
+    if (e != nullptr)
+    {
+        UWBHAL.Log_D("Android config data from cache");
+        config = e->androidData;
+        freshMac(config.device_mac_addr);
+        return uwb::Status::SUCCESS;
+    }
+
+    status = UWBHAL.getUwbConfigData_Android(config);
+    if (status == uwb::Status::SUCCESS && gen == generation)
+    {
+        e = store(KIND_ANDROID, uwb::DeviceRole::RESPONDER, noSpec, noSpec);
+        e->androidData = config;
+        memset(e->androidData.device_mac_addr, 0, sizeof(e->androidData.device_mac_addr));
+        macState ^= config.device_mac_addr[0] | (config.device_mac_addr[1] << 8);
+        e->valid = true;
+    }
+    return status;
+}
+
+void NearbyConfigCache_::invalidate()
+{
+    generation++;
+    for (int i = 0; i < maxEntries; ++i)
+        entries[i].valid = false;
+}
+
+void NearbyConfigCache_::resetHandler(void* data)
+{
+    (void)data;
+    // the UWBS may come back with different data, e.g. after a firmware update
+    getInstance().invalidate();
+}
+
+NearbyConfigCache_ &NearbyConfigCache_::getInstance()
+{
+    static NearbyConfigCache_ instance;
+
+    return instance;
+}
+
+NearbyConfigCache_ &NearbyConfigCache = NearbyConfigCache.getInstance();
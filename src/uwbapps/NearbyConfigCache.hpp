@@ -0,0 +1,86 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef NEARBYCONFIGCACHE_HPP
+#define NEARBYCONFIGCACHE_HPP
+
+#include <Arduino.h>
+#include "hal/uwb_hal.hpp"
+
+/**
+ * @brief keeps the accessory configuration data read from the UWBS for the
+ * Nearby Initialize messages
+ *
+ * Apart from the device MAC address the data only depends on the UWBS and
+ * on the requested device role and specification version, it is read once
+ * and every phone connecting afterwards is answered from memory. The MAC
+ * address is not cached: every answer from memory gets a new random short
+ * address, as the UWBS would give, so two sessions never share one.
+ * A HPDWKUP answer is handled once, when the data is read.
+ *
+ * The data is read again after the UWBS notifies DEVICE_RESET or
+ * RECOVERY_NTF, or after invalidate().
+ *
+ */
+class NearbyConfigCache_ {
+public:
+    static const int maxEntries = 4;
+
+    /**
+     * @brief the iOS accessory configuration data, see getUwbConfigData_iOS()
+     *
+     * @param role
+     * @param specMajor customer specification major version
+     * @param specMinor customer specification minor version
+     * @param config
+     * @return uwb::Status
+     */
+    uwb::Status iOS(uwb::DeviceRole role, const uint8_t specMajor[2], const uint8_t specMinor[2], uwb::AccessoryConfigData& config);
+
+    /**
+     * @brief the Android device configuration data, see getUwbConfigData_Android()
+     *
+     * @param config
+     * @return uwb::Status
+     */
+    uwb::Status android(uwb::DeviceConfig& config);
+
+    /**
+     * @brief forget the cached data, e.g. after changing the core configuration
+     */
+    void invalidate();
+
+    static NearbyConfigCache_& getInstance();
+
+private:
+    enum Kind : uint8_t { KIND_IOS, KIND_ANDROID };
+
+    struct Entry {
+        bool valid;
+        uint8_t kind;
+        uwb::DeviceRole role;
+        uint8_t specMajor[2];
+        uint8_t specMinor[2];
+        uwb::AccessoryConfigData iosData;
+        uwb::DeviceConfig androidData;
+    };
+
+    NearbyConfigCache_();
+    NearbyConfigCache_(const NearbyConfigCache_&) = delete;
+    NearbyConfigCache_& operator=(const NearbyConfigCache_&) = delete;
+
+    Entry* find(uint8_t kind, uwb::DeviceRole role, const uint8_t specMajor[2], const uint8_t specMinor[2]);
+    Entry* store(uint8_t kind, uwb::DeviceRole role, const uint8_t specMajor[2], const uint8_t specMinor[2]);
+    void freshMac(uint8_t mac[2]);
+    void registerHandlers();
+    static void resetHandler(void* data);
+
+    Entry entries[maxEntries];
+    volatile uint32_t generation;   // changed by every invalidation
+    bool handlersRegistered;
+    uint32_t macState;              // generator of the MAC addresses
+};
+
+extern NearbyConfigCache_ &NearbyConfigCache;
+
+#endif /* NEARBYCONFIGCACHE_HPP */
@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "NearbyLatency.hpp"
+
+static const char* const phaseNames[NEARBY_PHASES] = {
+    "initialize",
+    "configure",
+    "phone",
+    "start",
+    "first ranging",
+    "total"
+};
+
+uint32_t NearbyHistogram::mean() const
+{
+    return count ? totalMs / count : 0;
+}
+
+uint32_t NearbyHistogram::percentile(uint8_t p) const
+{
+    uint32_t rank, seen = 0;
+
+    if (count == 0)
+        return 0;
+    rank = ((uint64_t)count * p + 99) / 100;
+    for (uint8_t i = 0; i < buckets - 1; ++i)
+    {
+        seen += bucket[i];
+        if (seen >= rank)
+            return i == 0 ? 1 : (uint32_t)1 << i;
+    }
+    return maxMs;
+}
+
+NearbyLatency::NearbyLatency()
+{
+    for (int i = 0; i < maxTraces; ++i)
+        marked[i] = 0;
+    reset();
+}
+
+void NearbyLatency::begin(int trace, uint32_t now)
+{
+    if (trace < 0 || trace >= maxTraces)
+        return;
+    marked[trace] = 0;
+    mark(trace, NEARBY_CONNECTED, now);
+}
+
+void NearbyLatency::mark(int trace, uint8_t m, uint32_t now)
+{
+    uint8_t bit = 1 << m;
+
+    if (trace < 0 || trace >= maxTraces || m >= NEARBY_MARKS)
+        return;
+    if (marked[trace] & bit)
+    {
+        // the phone starts over on the same connection
+        if (m != NEARBY_INITIALIZE)
+            return;
+        marked[trace] = 0;
+    }
+    stamps[trace][m] = now;
+    marked[trace] |= bit;
+
+    if (m > 0 && (marked[trace] & (bit >> 1)))
+        add(m - 1, now - stamps[trace][m - 1]);
+    if (m == NEARBY_FIRST_RANGING && (marked[trace] & (1 << NEARBY_CONNECTED)))
+        add(NEARBY_PHASE_TOTAL, now - stamps[trace][NEARBY_CONNECTED]);
+}
+
+bool NearbyLatency::waitingRanging(int trace)
+{
+    if (trace < 0 || trace >= maxTraces)
+        return false;
+    return (marked[trace] & ((1 << NEARBY_STARTED) | (1 << NEARBY_FIRST_RANGING))) == (1 << NEARBY_STARTED);
+}
+
+uint32_t NearbyLatency::at(int trace, uint8_t m)
+{
+    if (trace < 0 || trace >= maxTraces || m >= NEARBY_MARKS || !(marked[trace] & (1 << m)))
+        return 0;
+    return stamps[trace][m];
+}
+
+const NearbyHistogram& NearbyLatency::phase(uint8_t p)
+{
+    return hist[p < NEARBY_PHASES ? p : (uint8_t)NEARBY_PHASE_TOTAL];
+}
+
+void NearbyLatency::reset()
+{
+    for (int p = 0; p < NEARBY_PHASES; ++p)
+    {
+        hist[p].count = 0;
+        hist[p].minMs = 0;
+        hist[p].maxMs = 0;
+        hist[p].totalMs = 0;
+        for (int b = 0; b < NearbyHistogram::buckets; ++b)
+            hist[p].bucket[b] = 0;
+    }
+}
+
+void NearbyLatency::add(uint8_t p, uint32_t ms)
+{
+    NearbyHistogram& h = hist[p];
+    uint8_t b = 0;
+
+    while (b < NearbyHistogram::buckets - 1 && ms >= ((uint32_t)1 << b))
+        b++;
+    h.bucket[b]++;
+    if (h.count == 0 || ms < h.minMs)
+        h.minMs = ms;
+    if (ms > h.maxMs)
+        h.maxMs = ms;
+    h.totalMs += ms;
+    h.count++;
+}
+
+void NearbyLatency::print(Print& out)
+{
+    for (int p = 0; p < NEARBY_PHASES; ++p)
+    {
+        const NearbyHistogram& h = hist[p];
+
+        out.print(phaseNames[p]);
+        out.print(": n ");
+        out.print(h.count);
+        out.print(" min ");
+        out.print(h.minMs);
+        out.print(" mean ");
+        out.print(h.mean());
+        out.print(" p90 <");
+        out.print(h.percentile(90));
+        out.print(" max ");
+        out.print(h.maxMs);
+        out.println(" ms");
+    }
+}
+
+const char* NearbyLatency::phaseName(uint8_t p)
+{
+    return p < NEARBY_PHASES ? phaseNames[p] : "";
+}
@@ -0,0 +1,137 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef NEARBYLATENCY_HPP
+#define NEARBYLATENCY_HPP
+
+#include <Arduino.h>
+#include "UWBSessionManager.hpp"
+
+/**
+ * @brief steps of the start of a Nearby session, in order
+ *
+ */
+enum NearbyMark : uint8_t {
+    NEARBY_CONNECTED,       // BLE connection of the phone
+    NEARBY_INITIALIZE,      // kMsg_Initialize_iOS / _Android received
+    NEARBY_CONFIGURED,      // accessory configuration data sent back
+    NEARBY_START,           // kMsg_ConfigureAndStart received
+    NEARBY_STARTED,         // UWB session configured and started
+    NEARBY_FIRST_RANGING,   // first RANGING_DATA of the session
+    NEARBY_MARKS
+};
+
+/**
+ * @brief time between two steps, phase n goes from mark n to mark n + 1
+ *
+ */
+enum NearbyPhase : uint8_t {
+    NEARBY_PHASE_INITIALIZE,    // phone discovering the service and asking the configuration
+    NEARBY_PHASE_CONFIGURE,     // reading the accessory configuration data
+    NEARBY_PHASE_PHONE,         // phone setting up its side
+    NEARBY_PHASE_START,         // configuring and starting the UWB session
+    NEARBY_PHASE_FIRST_RANGING, // first ranging round
+    NEARBY_PHASE_TOTAL,         // connection to first ranging result
+    NEARBY_PHASES
+};
+
+/**
+ * @brief durations of a phase, in milliseconds
+ *
+ * Bucket 0 counts the durations below 1 ms, bucket n those from 2^(n-1)
+ * up to 2^n ms, the last bucket everything longer.
+ *
+ */
+struct NearbyHistogram {
+    static const uint8_t buckets = 16;
+
+    uint32_t count;
+    uint32_t minMs;
+    uint32_t maxMs;
+    uint32_t totalMs;
+    uint32_t bucket[buckets];
+
+    uint32_t mean() const;
+
+    /**
+     * @brief upper bound of the bucket holding the p-th percentile
+     *
+     * @param p 1 to 100
+     * @return uint32_t ms, 0 if nothing was recorded
+     */
+    uint32_t percentile(uint8_t p) const;
+};
+
+/**
+ * @brief timestamps the steps of every Nearby session start and aggregates
+ * the phases in histograms
+ *
+ * A trace starts when the phone connects, or when it sends Initialize
+ * again on the same connection. A step is recorded the first time only,
+ * a phase is added when both its steps are recorded.
+ *
+ * The steps are marked by the BLE callbacks, the Nearby worker task and
+ * the ranging notification, each phase is updated from one of them only.
+ * A print() running at the same time may show a phase half updated.
+ *
+ */
+class NearbyLatency {
+public:
+    static const int maxTraces = UWB_MAX_SESSIONS;
+
+    NearbyLatency();
+
+    /**
+     * @brief start the trace of a session, e.g. when the phone connects
+     *
+     * @param trace session slot
+     * @param now millis()
+     */
+    void begin(int trace, uint32_t now);
+
+    /**
+     * @brief record a step of a session
+     *
+     * @param trace session slot
+     * @param mark
+     * @param now millis()
+     */
+    void mark(int trace, uint8_t mark, uint32_t now);
+
+    /**
+     * @brief true if the session started and no ranging result was received yet
+     */
+    bool waitingRanging(int trace);
+
+    /**
+     * @brief millis() of a step of the current trace of a session
+     *
+     * @return uint32_t 0 if the step was not recorded
+     */
+    uint32_t at(int trace, uint8_t mark);
+
+    const NearbyHistogram& phase(uint8_t phase);
+
+    /**
+     * @brief clear the histograms, the traces in progress continue
+     */
+    void reset();
+
+    /**
+     * @brief print count, min, mean, 90th percentile and max of every phase
+     *
+     * @param out
+     */
+    void print(Print& out);
+
+    static const char* phaseName(uint8_t phase);
+
+private:
+    void add(uint8_t phase, uint32_t ms);
+
+    uint32_t stamps[maxTraces][NEARBY_MARKS];
+    uint8_t marked[maxTraces];      // one bit per recorded step
+    NearbyHistogram hist[NEARBY_PHASES];
+};
+
+#endif /* NEARBYLATENCY_HPP */
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include <string.h>
+#include "NearbyMessageParser.hpp"
+
+// the message needs more bytes, or can never be complete
+static const long incomplete = 0;
+static const long invalid = -1;
+
+NearbyMessageParser::NearbyMessageParser()
+{
+    reset();
+}
+
+void NearbyMessageParser::reset()
+{
+    start = 0;
+    end = 0;
+    platform = 0;
+    numErrors = 0;
+}
+
+void NearbyMessageParser::discard()
+{
+    start = 0;
+    end = 0;
+}
+
+bool NearbyMessageParser::feed(const uint8_t* data, size_t len)
+{
+    if (len == 0)
+        return true;
+    if (data == NULL || len > bufferSize)
+    {
+        numErrors++;
+        return false;
+    }
+    if (len > bufferSize - (end - start))
+    {
+        // the incomplete message will not be completed, start over
+        numErrors++;
+        start = end = 0;
+    }
+    // the returned messages are done with, make room at the end
+    if (start > 0 && len > bufferSize - end)
+    {
+        memmove(buf, &buf[start], end - start);
+        end -= start;
+        start = 0;
+    }
+    memcpy(&buf[end], data, len);
+    end += len;
+    return true;
+}
+
+long NearbyMessageParser::messageLength()
+{
+    size_t avail = end - start;
+    long len;
+
+    switch (buf[start])
+    {
+    case kMsg_Initialize_iOS:
+    case kMsg_Initialize_Android:
+    case kMsg_Stop:
+        return 1;
+
+    case kMsg_ConfigureAndStart:
+        if (platform == kMsg_Initialize_iOS)
+        {
+            if (avail <= SHAREABLE_DATA_LENGTH_OFFSET)
+                return incomplete;
+            // message ID, then the shareable data header and payload
+            len = 1 + SHAREABLE_DATA_HEADER_LENGTH + buf[start + SHAREABLE_DATA_LENGTH_OFFSET];
+        }
+        else if (platform == kMsg_Initialize_Android)
+        {
+            len = 1 + SHAREABLE_DATA_HEADER_LENGTH_ANDROID;
+        }
+        else
+        {
+            len = avail;
+        }
+        break;
+
+    default:
+        len = avail;
+        break;
+    }
+
+    if ((size_t)len > bufferSize)
+        return invalid;
+    return (size_t)len <= avail ? len : incomplete;
+}
+
+bool NearbyMessageParser::next(NearbyMessage& msg)
+{
+    long len;
+
+    if (start == end)
+    {
+        start = end = 0;
+        return false;
+    }
+    len = messageLength();
+    if (len == invalid)
+    {
+        // the rest of the message can not be told from the next one
+        numErrors++;
+        start = end = 0;
+        return false;
+    }
+    if (len == incomplete)
+        return false;
+
+    msg.id = buf[start];
+    msg.data = &buf[start];
+    msg.len = len;
+    start += len;
+    if (msg.id == kMsg_Initialize_iOS || msg.id == kMsg_Initialize_Android)
+        platform = msg.id;
+    return true;
+}
+
+size_t NearbyMessageParser::pending()
+{
+    return end - start;
+}
+
+uint32_t NearbyMessageParser::errors()
+{
+    return numErrors;
+}
@@ -0,0 +1,122 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef NEARBYMESSAGEPARSER_HPP
+#define NEARBYMESSAGEPARSER_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bytes of phone messages buffered per BLE connection
+#ifndef UWB_NEARBY_PARSER_SIZE
+#define UWB_NEARBY_PARSER_SIZE 256
+#endif
+
+#define SHAREABLE_DATA_LENGTH_OFFSET 5
+#define SHAREABLE_DATA_HEADER_LENGTH 5
+
+#define SHAREABLE_DATA_HEADER_LENGTH_ANDROID 14
+
+typedef enum
+{
+    kMsg_Initialize_iOS = 0x0A,
+    kMsg_Initialize_Android = 0xA5,
+    kMsg_ConfigureAndStart = 0x0B,
+    kMsg_Stop = 0x0C
+} MessageId_t;
+
+typedef enum
+{
+    kRsp_InitializedData = 0x01,
+    kRsp_UwbDidStart = 0x02,
+    kRsp_UwbDidStop = 0x03,
+} ResponseId_t;
+
+/**
+ * @brief a complete phone message, a view into the parser buffer
+ *
+ */
+struct NearbyMessage {
+    uint8_t id;
+    uint8_t* data;          // starts with the message ID
+    size_t len;
+};
+
+/**
+ * @brief splits the BLE writes of a phone into Nearby messages
+ *
+ * The phone may split a message over several writes, or put several
+ * messages in one write. The length of a message follows from its ID:
+ * one byte for the Initialize and Stop messages, the shareable data length
+ * field for ConfigureAndStart from an iPhone, a fixed length from an
+ * Android phone. The platform is learnt from the Initialize message.
+ *
+ * A message with an unknown ID, or a ConfigureAndStart before the
+ * platform is known, takes all the buffered bytes, as when every write was
+ * a single message. A message longer than the buffer is dropped and
+ * counted as an error.
+ *
+ * No memory is allocated and nothing but the C library is used, the
+ * parser can be built and tested on a PC.
+ *
+ */
+class NearbyMessageParser {
+public:
+    static const size_t bufferSize = UWB_NEARBY_PARSER_SIZE;
+
+    NearbyMessageParser();
+
+    /**
+     * @brief forget the buffered bytes and the platform, for a new connection
+     */
+    void reset();
+
+    /**
+     * @brief forget the buffered bytes but not the platform, e.g. after a
+     * write of the phone was lost
+     */
+    void discard();
+
+    /**
+     * @brief append a BLE write
+     *
+     * Invalidates the messages returned by next(). If the write does not
+     * fit after the incomplete message buffered, that message is dropped.
+     *
+     * @param data may be NULL if len is 0
+     * @param len
+     * @return true
+     * @return false if the write is longer than the buffer, it is dropped
+     */
+    bool feed(const uint8_t* data, size_t len);
+
+    /**
+     * @brief get the next complete message
+     *
+     * @param msg valid until the next feed() or reset()
+     * @return true
+     * @return false if no message is complete yet
+     */
+    bool next(NearbyMessage& msg);
+
+    /**
+     * @brief bytes waiting for the rest of their message
+     */
+    size_t pending();
+
+    /**
+     * @brief writes and messages dropped
+     */
+    uint32_t errors();
+
+private:
+    long messageLength();
+
+    uint8_t buf[bufferSize];
+    size_t start;           // first byte not returned by next()
+    size_t end;
+    uint8_t platform;       // ID of the Initialize message received, 0 if none
+    uint32_t numErrors;
+};
+
+#endif /* NEARBYMESSAGEPARSER_HPP */
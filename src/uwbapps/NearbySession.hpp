@@ -5,6 +5,8 @@
 #define NEARBYSESSION_HPP
 #include "UWBSession.hpp"
 #include "hal/uwb_types.hpp"
+#include "NearbyMessageParser.hpp"
+#include "NearbyConfigCache.hpp"
 
 /* Define for App developer */
 /* Specification number must be filled as mention in the developer specification */
@@ -17,11 +19,6 @@
     0x00, 0x00 \
   }  // Spec minor 00.00
 
-#define SHAREABLE_DATA_LENGTH_OFFSET 5
-#define SHAREABLE_DATA_HEADER_LENGTH 5
-
-#define SHAREABLE_DATA_HEADER_LENGTH_ANDROID 14
-
 // Enumerations for session state and device type
 enum SessionState
 {
@@ -38,21 +35,6 @@ enum DeviceType
 
 };
 
-typedef enum
-{
-    kMsg_Initialize_iOS = 0x0A,
-    kMsg_Initialize_Android = 0xA5,
-    kMsg_ConfigureAndStart = 0x0B,
-    kMsg_Stop = 0x0C
-} MessageId_t;
-
-typedef enum
-{
-    kRsp_InitializedData = 0x01,
-    kRsp_UwbDidStart = 0x02,
-    kRsp_UwbDidStop = 0x03,
-} ResponseId_t;
-
 /**
  * @brief this class implements the device side of the Nearby Interaction with
  *  3rd Party Devices from Apple (see https://developer.apple.com/nearby-interaction/) 
@@ -150,19 +132,8 @@ public:
         //cfgIos.spec_version_major[0] = SPEC_VERSION_MAJOR[0];
         //cfgIos.spec_version_minor[1] = SPEC_VERSION_MAJOR[1];
         
-        uwb_status = UWBHAL.getUwbConfigData_iOS(uwb::DeviceRole::INITIATOR, UserConfigData_iOS.uwb_config_data);
-        if (uwb_status != uwb::Status::SUCCESS)
-        {
-            UWBHAL.Log_E("GetUwbConfigData configuration failed");
-            /* If the status if HPD wake up then try to do it one more time */
-            if (uwb::Status::HPDWKUP == uwb_status)
-            {
-                UWBHAL.Log_W("Device woke up from HPD");
-                UWBHAL.setDefaultCoreConfigs();
-
-                uwb_status = UWBHAL.getUwbConfigData_iOS(uwb::DeviceRole::INITIATOR, UserConfigData_iOS.uwb_config_data);                
-            }
-        }
+        /* read once from the UWBS, the HPD wake up is handled by the cache */
+        uwb_status = NearbyConfigCache.iOS(uwb::DeviceRole::INITIATOR, SpecMajorVersion, SpecMinorVersion, UserConfigData_iOS.uwb_config_data);
         if (uwb_status != uwb::Status::SUCCESS)
         {
             UWBHAL.Log_E("GetUwbConfigData configuration failed");
@@ -259,7 +230,7 @@ public:
         deviceType(Android);
         uwb::DeviceConfig cfgAndroid;
         /* UWB related definitions */
-        uwb_status = UWBHAL.getUwbConfigData_Android(cfgAndroid);
+        uwb_status = NearbyConfigCache.android(cfgAndroid);
         if (uwb_status != uwb::Status::SUCCESS)
         {
             UWBHAL.Log_E("GetUwbConfigData configuration failed");
@@ -3,9 +3,26 @@
 
 #include "UWBAppParamList.hpp"
 #include "NearbySessionManager.hpp"
+#include "UWBNotification.hpp"
 
 NearbySessionManager::NearbySessionManager() {
-    SEMAPHORE_CREATE();
+    listLock = xSemaphoreCreateMutex();
+    events = NULL;
+    replies = NULL;
+    workerHandle = NULL;
+    nextSessionID = 1;
+    numStopping = 0;
+    lastKey = 0;
+    for (int i = 0; i < maxSessions; i++)
+    {
+        slotKey[i] = 0;
+        useSlot(i, &nearbySlab[i]);
+        stopPhase[i] = STOP_NONE;
+        stopReply[i] = false;
+        closing[i] = false;
+        closePending[i] = false;
+        resync[i] = false;
+    }
 }
 
 void NearbySessionManager::blePeripheralConnectHandler(BLEDevice central)
@@ -41,105 +58,367 @@ void NearbySessionManager::onSessionStart(BLEDeviceEventHandler sessionStartHand
 
 void NearbySessionManager::blePeripheralDisconnectHandler(BLEDevice central)
 {
+    NearbySessionManager& mgr = NearbySessionManager::instance();
+    int slot;
+
     Serial.println("In blePeripheralDisconnectHandler");
     // central disconnected event handler
 
-    //NearbySessionManager::instance().handleStopSession(central);
-    
-   
-
-    
-    if (NearbySessionManager::instance().clientDisconnectionHandler)
-        NearbySessionManager::instance().clientDisconnectionHandler(central);
-    
-    NearbySessionManager::instance().deleteSession(NearbySessionManager::instance().find(central).sessionID());
+    if (mgr.clientDisconnectionHandler)
+        mgr.clientDisconnectionHandler(central);
 
+    // marked here so that a full queue can not lose it: the worker stops
+    // the UWB session, then deletes it
+    xSemaphoreTake(mgr.listLock, portMAX_DELAY);
+    slot = mgr.lookup(central);
+    if (slot >= 0 && !mgr.closing[slot])
+    {
+        mgr.closing[slot] = true;
+        mgr.closePending[slot] = true;
+    }
+    xSemaphoreGive(mgr.listLock);
+    if (slot >= 0)
+        mgr.queueEvent(EVENT_DISCONNECT, central, nullptr, 0);
 }
 
 void NearbySessionManager::rxCharacteristicWritten(BLEDevice central, BLECharacteristic characteristic)
 {
+    NearbySessionManager::instance().queueEvent(EVENT_MESSAGE, central, characteristic.value(), characteristic.valueLength());
+}
+
+bool NearbySessionManager::queueEvent(uint8_t type, BLEDevice& dev, const uint8_t* data, size_t len)
+{
+    Event ev;
+    int slot = findSlot(dev);
+
+    ev.type = type;
+    ev.sessionID = slot >= 0 ? nearbySlab[slot].sessionID() : emptySession.sessionID();
+    ev.resync = type == EVENT_MESSAGE && slot >= 0 && resync[slot];
+    ev.len = len < (size_t)messageSize ? len : messageSize;
+    if (data != nullptr)
+        memcpy(ev.data, data, ev.len);
+    if (events == NULL)
+    {
+        // no worker, e.g. begin() not called yet
+        process(ev);
+    }
+    else if (xQueueSend(events, &ev, 0) != pdTRUE)
+    {
+        // a disconnect is already marked in its slot, the worker finds it
+        if (type == EVENT_DISCONNECT)
+            return true;
+        UWBHAL.Log_W("Nearby queue full, message dropped");
+        // the rest of the message is lost, the parser starts over
+        if (type == EVENT_MESSAGE && slot >= 0)
+            resync[slot] = true;
+        return false;
+    }
+    if (ev.resync)
+        resync[slot] = false;
+    return true;
+}
+
+void NearbySessionManager::reply(uint8_t target, const uint8_t* data, size_t len)
+{
+    Reply r;
+
+    r.target = target;
+    r.len = len < (size_t)messageSize ? len : messageSize;
+    memcpy(r.data, data, r.len);
+    if (replies == NULL)
+    {
+        deliver(r);
+        return;
+    }
+    if (xQueueSend(replies, &r, 0) != pdTRUE)
+        UWBHAL.Log_W("Nearby reply queue full, reply dropped");
+}
+
+void NearbySessionManager::deliver(Reply& r)
+{
+    BLEDevice dev;
 
-    NearbySessionManager::instance().handleTLV(central, (uint8_t *)characteristic.value());
+    if (r.target == REPLY_TX)
+    {
+        txCharacteristic.writeValue(r.data, r.len);
+    }
+    else if (r.target == REPLY_ACCESSORY_CONFIG)
+    {
+        accessoryConfigDataChar.writeValue(r.data, r.len);
+    }
+    else if (r.target == REPLY_SESSION_STOPPED && sessionStoppedHandler != nullptr)
+    {
+        xSemaphoreTake(listLock, portMAX_DELAY);
+        dev = stoppedDevice[r.data[0]];
+        xSemaphoreGive(listLock);
+        sessionStoppedHandler(dev);
+    }
+}
+
+void NearbySessionManager::process(Event& ev)
+{
+    NearbySession* sess = nullptr;
+    int slot = -1;
+    bool closed;
+
+    if (ev.type == EVENT_DISCONNECT)
+    {
+        closeDisconnected();
+        return;
+    }
+
+    xSemaphoreTake(listLock, portMAX_DELAY);
+    for (int i = 0; i < numSessions && sess == nullptr; i++)
+    {
+        if (sessions[i]->sessionID() == ev.sessionID)
+            sess = (NearbySession *)sessions[i];
+    }
+    xSemaphoreGive(listLock);
+    if (sess != nullptr)
+        slot = slotOf(*sess);
+    if (slot < 0)
+    {
+        UWBHAL.Log_W("message for an unknown Nearby session");
+        return;
+    }
+
+    xSemaphoreTake(listLock, portMAX_DELAY);
+    closed = closing[slot];
+    xSemaphoreGive(listLock);
+
+    if (ev.type == EVENT_MESSAGE && !closed)
+    {
+        NearbyMessageParser &parser = parsers[slot];
+        NearbyMessage msg;
+        uint32_t errors = parser.errors();
+
+        if (ev.resync)
+            parser.discard();
+        // a write may hold part of a message, or several messages
+        parser.feed(ev.data, ev.len);
+        while (parser.next(msg))
+            handleMessage(slot, msg.data, msg.len);
+        if (parser.errors() != errors)
+            UWBHAL.Log_W("malformed Nearby message dropped");
+    }
+    else if (ev.type == EVENT_STOP)
+    {
+        stopSession(slot);
+    }
+}
+
+void NearbySessionManager::closeDisconnected()
+{
+    bool start;
+
+    for (int slot = 0; slot < maxSessions; ++slot)
+    {
+        xSemaphoreTake(listLock, portMAX_DELAY);
+        start = closePending[slot];
+        closePending[slot] = false;
+        xSemaphoreGive(listLock);
+        if (start)
+            stopSession(slot);
+    }
+}
+
+void NearbySessionManager::workerTask(void* arg)
+{
+    NearbySessionManager* self = (NearbySessionManager*)arg;
+    Event ev;
+
+    for (;;)
+    {
+        // wake up regularly only while sessions are being stopped
+        if (xQueueReceive(self->events, &ev, self->numStopping > 0 ? pdMS_TO_TICKS(stopPollInterval) : portMAX_DELAY) == pdTRUE)
+            self->process(ev);
+        // also the disconnects whose event did not fit the queue
+        self->closeDisconnected();
+        self->advanceStops();
+    }
+}
+
+int NearbySessionManager::slotOf(NearbySession& sess)
+{
+    int slot = &sess - nearbySlab;
+
+    return slot >= 0 && slot < maxSessions ? slot : -1;
 }
 
 bool NearbySessionManager::handleStopSession(BLEDevice bleDev)
+{
+    // the stop state belongs to the worker, which is woken by the event
+    if (findSlot(bleDev) < 0)
+        return false;
+    return queueEvent(EVENT_STOP, bleDev, nullptr, 0);
+}
+
+bool NearbySessionManager::stopSession(int slot)
 {
     Serial.println("In handleStopSession");
-    bool status = true;
-    uwb::Status operation = uwb::Status::SUCCESS;
-    NearbySession &nearbySession = NearbySessionManager::instance().find(bleDev);
-    SEMAPHORE_TAKE();
-    delay(2000);
-    while (nearbySession.sessionState() != notCreated)
-    {
-        switch (nearbySession.sessionState())
+    NearbySession &nearbySession = nearbySlab[slot];
+    uwb::Status operation;
+
+    if (stopPhase[slot] != STOP_NONE)
+        return true;
+
+    stopReply[slot] = !closing[slot];
+    numStopping++;
+    if (nearbySession.sessionState() == Started)
+    {
+        UWBHAL.Log_D("Stopping session: %04X", nearbySession.sessionHandle());
+        operation = nearbySession.stop();
+        if (operation == uwb::Status::SUCCESS)
+        {
+            // continued by advanceStops() once the session is idle
+            stopPhase[slot] = STOP_IDLE;
+            stopSince[slot] = millis();
+            return true;
+        }
+        if (operation != uwb::Status::SESSION_NOT_EXIST)
         {
-            case notStarted:
-                Serial.println("In notStarted");
-            UWBHAL.Log_D("Deleting session: %04X", nearbySession.sessionHandle());
-            nearbySession.stop();
-            operation = nearbySession.deInit();
+            UWBHAL.Log_E("Stop session failed: %d", operation);
+            finishStop(slot, false);
+            return false;
+        }
+        nearbySession.sessionState(notStarted);
+    }
+    deinitStep(slot);
+    return true;
+}
+
+void NearbySessionManager::deinitStep(int slot)
+{
+    NearbySession &nearbySession = nearbySlab[slot];
+    uwb::Status operation;
+
+    if (nearbySession.sessionState() == notCreated)
+    {
+        finishStop(slot, true);
+        return;
+    }
+    if (nearbySession.sessionState() != notStarted)
+    {
+        UWBHAL.Log_E("Stop session wrong state: %d", nearbySession.sessionState());
+        finishStop(slot, false);
+        return;
+    }
 
-            if (operation == uwb::Status::SUCCESS || operation == uwb::Status::SESSION_NOT_EXIST)
+    UWBHAL.Log_D("Deleting session: %04X", nearbySession.sessionHandle());
+    if (nearbySession.currentState() == UWBSessionState::ACTIVE)
+        nearbySession.stop();
+    operation = nearbySession.deInit();
+    if (operation == uwb::Status::SUCCESS)
+    {
+        stopPhase[slot] = STOP_DEINIT;
+        stopSince[slot] = millis();
+    }
+    else if (operation == uwb::Status::SESSION_NOT_EXIST)
+    {
+        nearbySession.sessionState(notCreated);
+        finishStop(slot, true);
+    }
+    else
+    {
+        finishStop(slot, false);
+    }
+}
+
+void NearbySessionManager::advanceStops()
+{
+    for (int slot = 0; slot < maxSessions && numStopping > 0; ++slot)
+    {
+        NearbySession &nearbySession = nearbySlab[slot];
+        bool expired = millis() - stopSince[slot] > stopTimeout;
+
+        if (stopPhase[slot] == STOP_IDLE)
+        {
+            if (nearbySession.currentState() == UWBSessionState::IDLE)
             {
-                nearbySession.sessionState(notCreated);
-                status = true;
+                nearbySession.sessionState(notStarted);
+                deinitStep(slot);
             }
-            else
+            else if (expired)
             {
-                status = false;
+                UWBHAL.Log_E("Session %04X did not stop", nearbySession.sessionHandle());
+                finishStop(slot, false);
             }
-            //delay(2000);
-            break;
-        case Started:
-                Serial.println("In Started");
-            UWBHAL.Log_D("Stopping session: %04X", nearbySession.sessionHandle());
-            operation = nearbySession.stop();
-            UWBHAL.Log_D("Stopped session with status: %04X", operation);
-
-            if (operation == uwb::Status::SUCCESS || operation == uwb::Status::SESSION_NOT_EXIST)
+        }
+        else if (stopPhase[slot] == STOP_DEINIT)
+        {
+            if (nearbySession.currentState() == UWBSessionState::DEINIT)
             {
-                nearbySession.sessionState(notStarted);
-                status = true;
+                nearbySession.sessionState(notCreated);
+                finishStop(slot, true);
             }
-            else
+            else if (expired)
             {
-                status = false;
+                UWBHAL.Log_E("Session %04X did not deinit", nearbySession.sessionHandle());
+                finishStop(slot, false);
             }
-            break;
-            
-        default:
-            UWBHAL.Log_E("Stop session wrong state: %d", nearbySession.sessionState());
-            status = false;
-            break;
         }
     }
-    SEMAPHORE_GIVE();
-    if (sessionStoppedHandler != nullptr)
-        sessionStoppedHandler(bleDev);
-    return status;
 }
 
-void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
+void NearbySessionManager::finishStop(int slot, bool success)
+{
+    NearbySession &nearbySession = nearbySlab[slot];
+    uint8_t response = kRsp_UwbDidStop;
+    uint8_t stopped = slot;
+
+    stopPhase[slot] = STOP_NONE;
+    numStopping--;
+    if (!success)
+        UWBHAL.Log_E("Stop session failed");
+    if (stopReply[slot])
+        reply(REPLY_TX, &response, sizeof(response));
+    // the application is told from poll(), like the BLE events
+    xSemaphoreTake(listLock, portMAX_DELAY);
+    stoppedDevice[slot] = nearbySession.bleDevice();
+    xSemaphoreGive(listLock);
+    reply(REPLY_SESSION_STOPPED, &stopped, sizeof(stopped));
+    xSemaphoreTake(listLock, portMAX_DELAY);
+    if (closing[slot])
+    {
+        closing[slot] = false;
+        forgetAddress(slot);
+        deleteSession(nearbySession.sessionID());
+    }
+    xSemaphoreGive(listLock);
+}
+
+void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data, size_t len)
+{
+    int slot = findSlot(bleDev);
+
+    if (slot < 0)
+    {
+        UWBHAL.Log_W("message for an unknown Nearby session");
+        return;
+    }
+    handleMessage(slot, data, len);
+}
+
+void NearbySessionManager::handleMessage(int slot, uint8_t *data, size_t len)
 {
     Serial.println("In handleTLV");
     uwb::Status uwb_status = uwb::Status::FAILED;
 
     uint8_t response;
 
-    if (data == NULL)
+    if (data == NULL || len == 0)
     {
         UWBHAL.Log_W("handleTLV data is NULL");
+        return;
     }
-    NearbySession &nearbySession = NearbySessionManager::instance().find(bleDev);
-
-    // TODO check if object is valid
+    NearbySession &nearbySession = nearbySlab[slot];
 
     switch (data[0])
     {
     case kMsg_ConfigureAndStart:
     {
         Serial.println("In ConfigureAndStart");
+        trace.mark(slot, NEARBY_START, millis());
         nearbySession.sessionState(notStarted);
         if (nearbySession.deviceType() == Android)
         {
@@ -147,7 +426,7 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
             if (nearbySession.startAndroid(data) == uwb::Status::SUCCESS)
             {
                 response = kRsp_UwbDidStart;
-                txCharacteristic.writeValue(&response, sizeof(response));
+                reply(REPLY_TX, &response, sizeof(response));
             }
             else
             {
@@ -155,7 +434,7 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
             }
             {
                 response = kRsp_UwbDidStart;
-                txCharacteristic.writeValue(&response, sizeof(response));
+                reply(REPLY_TX, &response, sizeof(response));
             }
         }
         else if (nearbySession.deviceType() == iOS)
@@ -168,12 +447,12 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
             {
 				Serial.println("In Success");
                 response = kRsp_UwbDidStart;
-                txCharacteristic.writeValue(&response, sizeof(response));
+                reply(REPLY_TX, &response, sizeof(response));
                 if (nearbySession.shouldUpdateAccessory())
                 {
 					Serial.println("In ShouldUpdateAccessory");
                     const uint8_t tmpData[50] = {0};
-                    accessoryConfigDataChar.writeValue(tmpData, 50);//neds to be fixed
+                    reply(REPLY_ACCESSORY_CONFIG, tmpData, 50);//neds to be fixed
                 }
 				Serial.println("End of IOS");
             }
@@ -188,6 +467,8 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
             uwb_status = uwb::Status::FAILED; // Unknown platform detected
             UWBHAL.Log_E("Unknown platform detected");
         }
+        if (nearbySession.sessionState() == Started)
+            trace.mark(slot, NEARBY_STARTED, millis());
     }
     break;
 
@@ -197,9 +478,11 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
          * Fill the ConfigData and send it over BLE to the phone application
          */
         Serial.println("In Initialize_iOS");
+        trace.mark(slot, NEARBY_INITIALIZE, millis());
 
         if (nearbySession.configIOS() == uwb::Status::SUCCESS)
         {
+            trace.mark(slot, NEARBY_CONFIGURED, millis());
             uint8_t *BLEmessage_iOS = nearbySession.config();
             for (int jj=0; jj < 1 + nearbySession.configLen(); jj++)
             {
@@ -213,17 +496,17 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
                 UWBHAL.Log_I(" Following spec: 1.1");
                 /* Spec 1.1 required to update GATT server
                 Update the GATT server with the same BLEmessage (only removing Response ID that is not part of the original definition) */
-                accessoryConfigDataChar.writeValue(BLEmessage_iOS + 1, nearbySession.configLen() - 1);
+                reply(REPLY_ACCESSORY_CONFIG, BLEmessage_iOS + 1, nearbySession.configLen() - 1);
 
                 /* Need to send the exact data over ble */
                 
-                txCharacteristic.writeValue(BLEmessage_iOS, nearbySession.configLen());
+                reply(REPLY_TX, BLEmessage_iOS, nearbySession.configLen());
             }
             else
             {
                 UWBHAL.Log_I(" Following spec 1.0");
                 /* Spec 1.0 support, clock drift not sent over BLE. BLE message size must  */
-                txCharacteristic.writeValue(BLEmessage_iOS, nearbySession.configLen());
+                reply(REPLY_TX, BLEmessage_iOS, nearbySession.configLen());
             }
         }
     }
@@ -231,13 +514,15 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
 
     case kMsg_Initialize_Android:
     {
+        trace.mark(slot, NEARBY_INITIALIZE, millis());
 
         if (nearbySession.configAndroid() == uwb::Status::SUCCESS)
         {
+            trace.mark(slot, NEARBY_CONFIGURED, millis());
             uint8_t *BLEmessage_Android = nearbySession.config();
 
             /* Need to send the exact data from ConfigData  over ble */
-            txCharacteristic.writeValue(BLEmessage_Android, nearbySession.configLen());
+            reply(REPLY_TX, BLEmessage_Android, nearbySession.configLen());
         }
         else
             UWBHAL.Log_E("Android config fail");
@@ -250,16 +535,9 @@ void NearbySessionManager::handleTLV(BLEDevice bleDev, uint8_t *data)
          */
             Serial.println("In Stop");
         UWBHAL.Log_I("Received stop message");
-        if (!NearbySessionManager::instance().handleStopSession(bleDev))
-        {
-            UWBHAL.Log_E("Stop session failed");
-        }
-        else
-        {
+        // kRsp_UwbDidStop is sent once the session is deinitialized
+        if (stopSession(slot))
             uwb_status = uwb::Status::SUCCESS;
-        }
-        response = kRsp_UwbDidStop;
-        txCharacteristic.writeValue(&response, sizeof(response));
 
         break;
 
@@ -284,6 +562,22 @@ void NearbySessionManager::begin(const char* deviceName)
     this->rxCharacteristic = rxChar;
     this->txCharacteristic = txChar;
 
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::RANGING_DATA, rangingHandler);
+    if (workerHandle == NULL)
+    {
+        events = xQueueCreate(UWB_NEARBY_QUEUE_DEPTH, sizeof(Event));
+        replies = xQueueCreate(UWB_NEARBY_REPLY_DEPTH, sizeof(Reply));
+        if (events == NULL || replies == NULL ||
+            xTaskCreate(workerTask, "nearby", 2048, this, 2, &workerHandle) != pdPASS)
+        {
+            // messages are then handled in the BLE callbacks
+            UWBHAL.Log_E("could not start the Nearby task");
+            events = NULL;
+            replies = NULL;
+            workerHandle = NULL;
+        }
+    }
+
     while (!BLE.begin())
         UWBHAL.Log_E("starting Bluetooth® Low Energy module failed!");
     
@@ -311,44 +605,133 @@ void NearbySessionManager::poll(void)
     }
     BLE.poll();
 
+    if (replies != NULL)
+    {
+        Reply r;
+        while (xQueueReceive(replies, &r, 0) == pdTRUE)
+            deliver(r);
+    }
 }
 
-NearbySession &NearbySessionManager::find(BLEDevice dev) 
+NearbyLatency& NearbySessionManager::latency()
 {
-    NearbySession *tempSession;
-    for (int i = 0; i < numSessions; i++)
+    return trace;
+}
+
+void NearbySessionManager::rangingHandler(void* data)
+{
+    UWBRangingData* rangingData = (UWBRangingData*)data;
+    NearbySessionManager& mgr = instance();
+
+    for (int slot = 0; slot < maxSessions; ++slot)
     {
+        if (mgr.trace.waitingRanging(slot) && mgr.nearbySlab[slot].sessionHandle() == rangingData->sessionHandle())
+            mgr.trace.mark(slot, NEARBY_FIRST_RANGING, millis());
+    }
+}
 
-        tempSession = (NearbySession *)sessions[i];
+int NearbySessionManager::findSlot(BLEDevice& dev)
+{
+    int slot;
 
-        if (tempSession->bleAddress() == dev.address())
-        {
-            return *(NearbySession *)sessions[i];
-        }
+    xSemaphoreTake(listLock, portMAX_DELAY);
+    slot = lookup(dev);
+    xSemaphoreGive(listLock);
+    return slot;
+}
+
+// called with listLock taken
+int NearbySessionManager::lookup(BLEDevice& dev)
+{
+    uint64_t key = deviceKey(dev);
+    uint8_t slot;
+
+    // the newest session of the phone: one being closed only if it has no other
+    if (!slotByAddress.find(key, slot) || !slotUsed(slot) || slotKey[slot] != key)
+        return -1;
+    return slot;
+}
+
+// called with listLock taken
+uint64_t NearbySessionManager::deviceKey(BLEDevice& dev)
+{
+    // BLEDevice compares the address bytes, but only gives them as a String:
+    // the writes of a phone come in bursts, parse it again only for another phone
+    if (!(dev == lastDevice))
+    {
+        lastDevice = dev;
+        lastKey = addressKey(dev.address());
+    }
+    return lastKey;
+}
+
+// called with listLock taken, before the session of the slot is deleted
+void NearbySessionManager::forgetAddress(int slot)
+{
+    uint64_t key = slotKey[slot];
+    uint8_t newest;
+
+    if (!slotByAddress.find(key, newest) || newest != slot)
+        return;
+    slotByAddress.remove(key);
+    // an older session of the phone still being closed takes the address back
+    for (int i = 0; i < maxSessions; ++i)
+    {
+        if (i != slot && slotUsed(i) && slotKey[i] == key)
+            slotByAddress.insert(key, i);
     }
-    return emptySession;
+}
+
+// "aa:bb:cc:dd:ee:ff" -> 0xaabbccddeeff
+uint64_t NearbySessionManager::addressKey(const String& address)
+{
+    const char* p = address.c_str();
+    char* end;
+    uint64_t key = 0;
+
+    for (int i = 0; i < 6; ++i)
+    {
+        key = (key << 8) | (strtoul(p, &end, 16) & 0xFF);
+        if (*end != ':')
+            break;
+        p = end + 1;
+    }
+    return key;
+}
+
+NearbySession &NearbySessionManager::find(BLEDevice dev) 
+{
+    int slot = findSlot(dev);
+
+    return slot >= 0 ? nearbySlab[slot] : emptySession;
 }
 
 bool NearbySessionManager::addSession(NearbySession &sess)
 {
-    Serial.println("In addSession");
-    Serial.println("NumSessions" );
-    Serial.println(numSessions);
-    Serial.println("MaxSessions");
-    Serial.println(maxSessions);
-    NearbySession *newSess = new NearbySession();
-    newSess->sessionID(sess.sessionID());
-    newSess->sessionType(sess.sessionType());
-    newSess->bleDevice(sess.bleDevice());
-
-    if (numSessions >= maxSessions) {
-        Serial.println("Session already exists");
+    bool added;
+
+    xSemaphoreTake(listLock, portMAX_DELAY);
+    int slot = allocSlot();
+    if (slot < 0) {
+        xSemaphoreGive(listLock);
+        UWBHAL.Log_E("too many Nearby sessions");
         return false;
     }
 
-
-    sessions[numSessions++] = newSess; //&sess;
-    return true;
+    NearbySession *newSess = &nearbySlab[slot];
+    *newSess = sess;
+    // the phone provides the UWB session parameters, the ID only has to be 
+    // unique to find the session again in the list
+    newSess->sessionID(nextSessionID++);
+    parsers[slot].reset();
+    resync[slot] = false;
+    trace.begin(slot, millis());
+    slotKey[slot] = addressKey(newSess->bleDevice().address());
+    added = commitSlot(slot);
+    if (added)
+        slotByAddress.insert(slotKey[slot], slot);
+    xSemaphoreGive(listLock);
+    return added;
 }
 
 NearbySessionManager &NearbySessionManager::instance()
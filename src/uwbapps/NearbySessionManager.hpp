@@ -9,8 +9,36 @@
 #include <Arduino_FreeRTOS.h>
 #include "UWBSessionManager.hpp"
 #include "NearbySession.hpp"
+#include "NearbyLatency.hpp"
 #include "hal/uwb_hal.hpp"
 
+// Phone messages waiting for the Nearby worker task
+#ifndef UWB_NEARBY_QUEUE_DEPTH
+#define UWB_NEARBY_QUEUE_DEPTH 8
+#endif
+
+// Replies to the phones waiting for poll()
+#ifndef UWB_NEARBY_REPLY_DEPTH
+#define UWB_NEARBY_REPLY_DEPTH 8
+#endif
+
+/**
+ * @brief serves the Nearby Interaction protocol to several phones at once
+ *
+ * The BLE callbacks only queue the phone messages. A worker task started by
+ * begin() runs the UWB commands of every phone; its replies are written to
+ * the BLE characteristics by poll(), so the BLE stack is only used from the
+ * task calling poll(). All the application callbacks are called from
+ * poll() as well.
+ *
+ * Stopping a session does not block the worker: the stop and deinit steps
+ * are issued and the session moves on when the UWBS notifies the new state,
+ * while the messages of the other phones are processed.
+ *
+ * Up to UWB_MAX_SESSIONS phones are served at once, define it in the build
+ * flags to change it.
+ *
+ */
 class NearbySessionManager : public UWBSessionManager_ {
 public:
     NearbySessionManager();
@@ -28,7 +56,7 @@ public:
      */
     void onDisconnect(BLEDeviceEventHandler disconnectHandler);
     /**
-     * @brief callback for when a UWB session starts
+     * @brief callback for when a UWB session stops, called by poll()
      * 
      * @param sessionStopHandler 
      */
@@ -42,21 +70,29 @@ public:
     void onSessionStart(BLEDeviceEventHandler sessionStartHandler);
 
     /**
-     * @brief internal method to handle a situation where the UWB session is being stopped
+     * @brief internal method to start stopping and deinitializing the UWB session of a phone
+     * 
+     * Returns at once: the stop is queued to the worker task, that stops the
+     * session, waits for the UWBS to report it idle, then deinitialized, and
+     * replies kRsp_UwbDidStop.
      * 
      * @param bleDev 
-     * @return true 
-     * @return false 
+     * @return true if the stop was queued
+     * @return false if the device has no session or the queue is full
      */
     bool handleStopSession(BLEDevice bleDev);
 
     /**
      * @brief internal method that handles the incoming commands sent by the phone
      * 
+     * The worker task handles the messages of the phones the same way, 
+     * without looking the session up by BLEDevice.
+     * 
      * @param bleDev 
-     * @param data 
+     * @param data the message, starting with its ID
+     * @param len 
      */
-    void handleTLV(BLEDevice bleDev, uint8_t *data);
+    void handleTLV(BLEDevice bleDev, uint8_t *data, size_t len);
 
     /**
      * @brief start the BLE manager
@@ -66,7 +102,7 @@ public:
     void begin(const char* deviceName);
 
     /**
-     * @brief poll the BLE stack
+     * @brief poll the BLE stack and send the pending replies
      * 
      */
     void poll(void);
@@ -74,11 +110,24 @@ public:
     /**
      * @brief find a session by BLEDevice
      * 
+     * The devices are compared without building their address strings, 
+     * the session found last is tried first.
+     * 
      * @param dev 
-     * @return NearbySession& 
+     * @return NearbySession& emptySession if the device has no session
      */
     NearbySession &find(BLEDevice dev) override;
 
+    /**
+     * @brief latency of the steps from the BLE connection of a phone to 
+     * its first ranging result
+     * 
+     * e.g. UWBNearbySessionManager.latency().print(Serial);
+     * 
+     * @return NearbyLatency& 
+     */
+    NearbyLatency& latency();
+
     /**
      * @brief add a session
      * 
@@ -134,15 +183,75 @@ public:
 
     bool bleInitialized;
 private:
-    SemaphoreHandle_t sess_sem = NULL;
-    #define SEMAPHORE_CREATE()  { if (sess_sem == NULL) { sess_sem = xSemaphoreCreateBinary(); xSemaphoreGive(sess_sem); } }
-    #define SEMAPHORE_TAKE()    { if (inISR()) { xSemaphoreTakeFromISR(sess_sem, &pxHigherPriorityTaskWoken); } else { xSemaphoreTake(sess_sem, 100);} }
-    #define SEMAPHORE_GIVE()    { if (inISR()) { xSemaphoreGiveFromISR(sess_sem, &pxHigherPriorityTaskWoken); } else { xSemaphoreGive(sess_sem);} }
-    BaseType_t pxHigherPriorityTaskWoken;
-    static int inISR(void)
-    {
-        return (SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0 ;
-    }
+    // milliseconds to wait for each session status notification while stopping
+    static const uint32_t stopTimeout = uwb::UWB_CMD_TIMEOUT;
+    // milliseconds between two checks of the sessions being stopped
+    static const uint32_t stopPollInterval = 10;
+    static const int messageSize = 128;
+
+    // EVENT_DISCONNECT only wakes the worker up, the slot is marked by the BLE handler
+    enum EventType : uint8_t { EVENT_MESSAGE, EVENT_DISCONNECT, EVENT_STOP };
+    struct Event {
+        uint8_t type;
+        uint8_t len;
+        bool resync;            // a previous write of the phone was dropped
+        uint32_t sessionID;
+        uint8_t data[messageSize];
+    };
+
+    // REPLY_SESSION_STOPPED carries the slot, its device is in stoppedDevice[]
+    enum ReplyTarget : uint8_t { REPLY_TX, REPLY_ACCESSORY_CONFIG, REPLY_SESSION_STOPPED };
+    struct Reply {
+        uint8_t target;
+        uint8_t len;
+        uint8_t data[messageSize];
+    };
+
+    enum StopPhase : uint8_t { STOP_NONE, STOP_IDLE, STOP_DEINIT };
+
+    void reply(uint8_t target, const uint8_t* data, size_t len);
+    void deliver(Reply& r);
+    bool queueEvent(uint8_t type, BLEDevice& dev, const uint8_t* data, size_t len);
+    void process(Event& ev);
+    int slotOf(NearbySession& sess);
+    int findSlot(BLEDevice& dev);
+    int lookup(BLEDevice& dev);
+    uint64_t deviceKey(BLEDevice& dev);
+    void forgetAddress(int slot);
+    static uint64_t addressKey(const String& address);
+    void closeDisconnected();
+    void handleMessage(int slot, uint8_t* data, size_t len);
+    bool stopSession(int slot);
+    void deinitStep(int slot);
+    void advanceStops();
+    void finishStop(int slot, bool success);
+    static void workerTask(void* arg);
+    static void rangingHandler(void* data);
+
+    NearbySession nearbySlab[maxSessions];
+    NearbyMessageParser parsers[maxSessions];   // phone writes, per slot
+    // the 6 address bytes of the phone of each slot, parsed when it connects
+    uint64_t slotKey[maxSessions];
+    // phone address -> its newest slot, guarded by listLock like slotKey[]
+    UWBIdMap<maxSessions, uint64_t> slotByAddress;
+    BLEDevice lastDevice;                       // last device looked up, with its key
+    uint64_t lastKey;
+    NearbyLatency trace;
+    uint32_t nextSessionID;
+    SemaphoreHandle_t listLock;     // sessions[] is changed by the BLE callbacks and the worker
+    QueueHandle_t events;
+    QueueHandle_t replies;
+    TaskHandle_t workerHandle;
+
+    // stops in progress, per slot
+    uint8_t stopPhase[maxSessions];
+    uint32_t stopSince[maxSessions];
+    bool stopReply[maxSessions];    // send kRsp_UwbDidStop when done
+    bool closing[maxSessions];      // the phone disconnected, delete the session when done, guarded by listLock
+    bool closePending[maxSessions]; // closing, the worker has not started the stop yet, guarded by listLock
+    bool resync[maxSessions];       // a write was dropped, only used by the BLE callbacks
+    BLEDevice stoppedDevice[maxSessions];   // for the stop callback, guarded by listLock
+    int numStopping;
 };
 
 extern NearbySessionManager &UWBNearbySessionManager;
@@ -35,7 +35,7 @@ Print* UWB_::printer = nullptr;
 
 UWB_::UWB_()
 {
-    
+    isReady = false;
 }
 
 void UWB_::begin(Print& printInterface, uwb::LogLevel logLevel)
@@ -46,11 +46,24 @@ void UWB_::begin(Print& printInterface, uwb::LogLevel logLevel)
     UWBHAL.setPrintCallback(logCB);
    
     vTaskPrioritySet(NULL,1);
-    initUWB();
+    isReady = (initUWB() == uwb::Status::SUCCESS);
+    if (isReady)
+    {
+        UWBSessionStates.begin();
+        UWBCommandQueue.begin();
+        UWBSessionManager.autoRecovery(true);
+    }
     
 }
+
+bool UWB_::ready()
+{
+    return isReady;
+}
+
 void UWB_::end(void)
 {
+    isReady = false;
     if (UWBHAL.shutdown() != uwb::Status::SUCCESS) {
         UWBHAL.Log_E("ShutDown Failed");
     }
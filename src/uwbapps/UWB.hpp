@@ -74,6 +74,17 @@ public:
     */
     void begin(Print& printInterface = Serial, uwb::LogLevel logLevel = uwb::LogLevel::UWB_INFO_LEVEL);
 
+    /**
+     * @brief true once begin() brought the UWB stack up
+     * 
+     * begin() returns only after the UWBS answered, there is no need to 
+     * poll state() afterwards.
+     * 
+     * @return true 
+     * @return false if the stack could not be initialized
+     */
+    bool ready();
+
     /**
      * @brief stop the UWB engine
      * 
@@ -151,6 +162,7 @@ private:
     UWB_(UWB_ const &) = delete;
     void operator=(UWB_ const &) = delete;
     static Print* printer;
+    bool isReady;
 };
 
 extern UWB_ &UWB;
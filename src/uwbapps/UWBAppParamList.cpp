@@ -117,6 +117,37 @@ bool UWBAppParamList::noOfControlees(uint8_t number)
 {
     return addOrUpdateParam(buildScalar(uwb::AppConfigId::NumControlees, number));
 }
+
+bool UWBAppParamList::capSizeRange(uint8_t maxSlots, uint8_t minSlots)
+{
+    // two octets on the wire, maximum first
+    return addOrUpdateParam(buildScalar(uwb::AppConfigId::CapSizeRange, (uint32_t)maxSlots | ((uint32_t)minSlots << 8)));
+}
+
+bool UWBAppParamList::blockStride(uint8_t stride)
+{
+    return addOrUpdateParam(buildScalar(uwb::AppConfigId::BlockStride, stride));
+}
+
+bool UWBAppParamList::hoppingMode(uint8_t mode)
+{
+    return addOrUpdateParam(buildScalar(uwb::AppConfigId::HoppingMode, mode));
+}
+
+bool UWBAppParamList::mtuSize(uint16_t mtu)
+{
+    return addOrUpdateParam(buildScalar(uwb::AppConfigId::MtuSize, mtu));
+}
+
+bool UWBAppParamList::dataRepetition(uint8_t count)
+{
+    return addOrUpdateParam(buildScalar(uwb::AppConfigId::DataRepetition, count));
+}
+
+bool UWBAppParamList::sessionPriority(uint8_t priority)
+{
+    return addOrUpdateParam(buildScalar(uwb::AppConfigId::SessionPriority, priority));
+}
     
 bool UWBAppParamList::destinationMacAddr(UWBMacAddress &addr)
 {
@@ -384,6 +384,75 @@ public:
      * @param noOfControlees the number of controlees
      */
     bool noOfControlees(uint8_t number);
+
+    /**
+     * @brief Set the size of the Contention Access Period, in slots
+     *
+     * Used by contention based and hybrid sessions: responders pick a
+     * random slot of the CAP to answer. The controller can shrink the CAP
+     * down to minSlots when few responders are expected.
+     *
+     * @param maxSlots maximum CAP size
+     * @param minSlots minimum CAP size, at least 5
+     * @return true
+     * @return false
+     */
+    bool capSizeRange(uint8_t maxSlots, uint8_t minSlots);
+
+    /**
+     * @brief Set the Block Striding length
+     *
+     * The device takes part in one ranging block every stride + 1 blocks,
+     * trading update rate for power and channel occupancy.
+     *
+     * @param stride 0 to range in every block
+     * @return true
+     * @return false
+     */
+    bool blockStride(uint8_t stride);
+
+    /**
+     * @brief Set the Hopping Mode
+     *
+     * With hopping enabled the ranging round used in each ranging block is
+     * picked by a pseudo random sequence, so two sessions sharing the air
+     * do not collide in every block.
+     *
+     * @param mode 0 disabled, 1 FiRa hopping
+     * @return true
+     * @return false
+     */
+    bool hoppingMode(uint8_t mode);
+
+    /**
+     * @brief Set the Maximum Transfer Unit of the in-band data frames, in bytes
+     *
+     * @param mtu
+     * @return true
+     * @return false
+     */
+    bool mtuSize(uint16_t mtu);
+
+    /**
+     * @brief Set how many times each data frame is repeated
+     *
+     * @param count 0 sends every frame once
+     * @return true
+     * @return false
+     */
+    bool dataRepetition(uint8_t count);
+
+    /**
+     * @brief Set the Session Priority
+     *
+     * The UWBS gives the air time to the session with the highest priority
+     * when two sessions overlap.
+     *
+     * @param priority 1 to 100, default 50
+     * @return true
+     * @return false
+     */
+    bool sessionPriority(uint8_t priority);
     
     
     /**
@@ -496,4 +565,6 @@ public:
      //      }
 };
 
+typedef UWBAppParamsSnapshot<uwb::AppConfig, uwb::AppConfigId, uwb::AppParamType, uwb::AppParamValue> UWBAppParamSnapshot;
+
 #endif //__UWBAPPPARAMLIST_HPP__
\ No newline at end of file
@@ -102,12 +102,117 @@ public:
     unsigned int getSize() {
         return _size;
     }
-    
 
-private:
+    void clear() {
+        _size = 0;
+    }
+
+    /**
+     * @brief compare two entries by type and value. Array values are compared
+     * by content, since the same buffer may be updated in place
+     */
+    static bool sameValue(const T& a, const T& b) {
+        if (a.param_type != b.param_type)
+            return false;
+        if (a.param_type == uwb::AppParamType::ARRAY_U8) {
+            if (a.param_value.au8.param_len != b.param_value.au8.param_len)
+                return false;
+            return memcmp(a.param_value.au8.param_value, b.param_value.au8.param_value,
+                          a.param_value.au8.param_len) == 0;
+        }
+        return a.param_value.vu32 == b.param_value.vu32;
+    }
+
+    /**
+     * @brief collect in delta every param of this list that is missing or has
+     * a different value in reference
+     *
+     * @param reference the list to compare against
+     * @param delta receives the changed params
+     * @return unsigned int number of changed params
+     */
+    unsigned int diff(UWBAppParamsList& reference, UWBAppParamsList& delta) {
+        delta.clear();
+        for (unsigned int i = 0; i < _size; i++) {
+            T* old = reference.findParam(_paramsList[i].param_id);
+            if (old == nullptr || !sameValue(*old, _paramsList[i])) {
+                delta.addOrUpdateParam(_paramsList[i]);
+            }
+        }
+        return delta.getSize();
+    }
+
+protected:
     static const unsigned int MAX_SIZE = 30; // Maximum number of elements
     T _paramsList[MAX_SIZE];
     unsigned int _size; // Current number of elements
 };
 
+/**
+ * @brief deep copy of a params list
+ *
+ * Array values are copied in an internal buffer, so the snapshot keeps the
+ * values that were actually sent to the UWBS even if the caller later reuses
+ * or modifies its own buffers.
+ */
+template <typename T, typename P1, typename P2, typename P3> class UWBAppParamsSnapshot : public UWBAppParamsList<T, P1, P2, P3> {
+public:
+    UWBAppParamsSnapshot() : _used(0) {}
+
+    UWBAppParamsSnapshot(const UWBAppParamsSnapshot& other) : UWBAppParamsList<T, P1, P2, P3>() {
+        copyFrom(other);
+    }
+
+    UWBAppParamsSnapshot& operator=(const UWBAppParamsSnapshot& other) {
+        if (this != &other)
+            copyFrom(other);
+        return *this;
+    }
+
+    /**
+     * @brief replace the snapshot content with a copy of src
+     *
+     * @param src
+     * @return false if the array values do not fit the internal buffer
+     */
+    bool capture(UWBAppParamsList<T, P1, P2, P3>& src) {
+        this->clear();
+        _used = 0;
+        T* params = src.getParamsList();
+        for (unsigned int i = 0; i < src.getSize(); i++) {
+            T tmp = params[i];
+            if (tmp.param_type == uwb::AppParamType::ARRAY_U8) {
+                uint16_t len = tmp.param_value.au8.param_len;
+                if (_used + len > MAX_ARRAY_BYTES)
+                    return false;
+                memcpy(&_arena[_used], tmp.param_value.au8.param_value, len);
+                tmp.param_value.au8.param_value = &_arena[_used];
+                _used += len;
+            }
+            this->addOrUpdateParam(tmp);
+        }
+        return true;
+    }
+
+protected:
+    static const unsigned int MAX_ARRAY_BYTES = 160; // Room for array values
+
+    void copyFrom(const UWBAppParamsSnapshot& other) {
+        memcpy(_arena, other._arena, other._used);
+        _used = other._used;
+        this->_size = other._size;
+        for (unsigned int i = 0; i < this->_size; i++) {
+            this->_paramsList[i] = other._paramsList[i];
+            if (this->_paramsList[i].param_type == uwb::AppParamType::ARRAY_U8) {
+                // point to our own copy of the data
+                this->_paramsList[i].param_value.au8.param_value =
+                    _arena + (other._paramsList[i].param_value.au8.param_value - other._arena);
+            }
+        }
+    }
+
+    uint8_t _arena[MAX_ARRAY_BYTES];
+    unsigned int _used;
+};
+
 #endif //_UWBAPPPARAMSLIST_H_
@@ -0,0 +1,262 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBChannelHopper.hpp"
+#include "UWBNotification.hpp"
+
+UWBChannelHopper* UWBChannelHopper::hoppers[maxHoppers] = {nullptr};
+
+UWBChannelHopper::UWBChannelHopper(UWBSession& session, const UWBHoppingConfig& config)
+    : sess(session), cfg(config)
+{
+    uint32_t x = cfg.key ? cfg.key : 1;
+    uint8_t j, tmp;
+
+    if (cfg.numEntries > UWBHoppingConfig::maxEntries)
+        cfg.numEntries = UWBHoppingConfig::maxEntries;
+    if (cfg.failThreshold == 0)
+        cfg.failThreshold = 1;
+
+    // Fisher-Yates shuffle driven by the key, the same on both ends
+    for (uint8_t i = 0; i < cfg.numEntries; ++i)
+        sequence[i] = i;
+    for (uint8_t i = cfg.numEntries; i > 1; --i)
+    {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        j = x % i;
+        tmp = sequence[i - 1];
+        sequence[i - 1] = sequence[j];
+        sequence[j] = tmp;
+    }
+
+    for (uint8_t i = 0; i < cfg.numEntries; ++i)
+    {
+        entryStats[i].channel = cfg.channels[i];
+        entryStats[i].preambleCode = cfg.preambleCodes[i];
+        entryStats[i].rounds = 0;
+        entryStats[i].successes = 0;
+        entryStats[i].hopsAway = 0;
+        entryStats[i].coexIndications = 0;
+    }
+    position = 0;
+    failedRounds = 0;
+    hopRequested = false;
+    searching = false;
+    numHops = 0;
+    running = false;
+}
+
+UWBChannelHopper::~UWBChannelHopper()
+{
+    end();
+}
+
+bool UWBChannelHopper::begin()
+{
+    int free = -1;
+
+    if (running)
+        return true;
+    if (cfg.numEntries == 0)
+        return false;
+    for (int i = 0; i < maxHoppers && free < 0; ++i)
+    {
+        if (hoppers[i] == nullptr)
+            free = i;
+    }
+    if (free < 0)
+    {
+        UWBHAL.Log_E("too many channel hoppers");
+        return false;
+    }
+
+    position = 0;
+    numHops = 0;
+    failedRounds = 0;
+    hopRequested = false;
+    searching = false;
+    if (cfg.roundHopping)
+        sess.appParams.hoppingMode(1);
+    apply();
+    if (sess.isConfigured())
+        sess.reconfigure();
+
+    hoppers[free] = this;
+    running = true;
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::RANGING_DATA, rangingHandler);
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::WIFI_COEX_IND_NTF, coexHandler);
+    return true;
+}
+
+void UWBChannelHopper::end()
+{
+    for (int i = 0; i < maxHoppers; ++i)
+    {
+        if (hoppers[i] == this)
+            hoppers[i] = nullptr;
+    }
+    running = false;
+}
+
+void UWBChannelHopper::apply()
+{
+    uint8_t entry = sequence[position];
+
+    sess.appParams.channel(cfg.channels[entry]);
+    sess.appParams.preambleCodeIndex(cfg.preambleCodes[entry]);
+}
+
+uwb::Status UWBChannelHopper::hop()
+{
+    uwb::Status status = uwb::Status::SUCCESS;
+    bool ranging;
+
+    if (cfg.numEntries < 2)
+        return uwb::Status::REJECTED;
+
+    entryStats[sequence[position]].hopsAway++;
+    position = (position + 1) % cfg.numEntries;
+    apply();
+    searching = true;
+    failedRounds = 0;
+    hopRequested = false;
+    numHops++;
+    if (!sess.isConfigured())
+        return status;
+
+    // the UWBS takes the new channel only while the session is idle
+    ranging = sess.currentState() == UWBSessionState::ACTIVE;
+    if (ranging && sess.stop() == uwb::Status::SUCCESS)
+        sess.waitForState(UWBSessionState::IDLE);
+    status = sess.reconfigure();
+    if (ranging)
+    {
+        uwb::Status startStatus = sess.start();
+        if (status == uwb::Status::SUCCESS)
+            status = startStatus;
+    }
+    UWBHAL.Log_I("session %08X hopped to channel %d preamble %d: %d", sess.sessionID(),
+                 cfg.channels[sequence[position]], cfg.preambleCodes[sequence[position]], status);
+    return status;
+}
+
+bool UWBChannelHopper::update()
+{
+    if (!running || !hopRequested)
+        return false;
+    hop();
+    return true;
+}
+
+uint8_t UWBChannelHopper::current()
+{
+    return sequence[position];
+}
+
+uint32_t UWBChannelHopper::hops()
+{
+    return numHops;
+}
+
+bool UWBChannelHopper::stats(uint8_t index, UWBHopStats& stats)
+{
+    if (index >= cfg.numEntries)
+        return false;
+    stats = entryStats[index];
+    return true;
+}
+
+uint8_t UWBChannelHopper::successRate(uint8_t index)
+{
+    if (index >= cfg.numEntries || entryStats[index].rounds == 0)
+        return 100;
+    return entryStats[index].successes * 100 / entryStats[index].rounds;
+}
+
+void UWBChannelHopper::printStats(Print& out)
+{
+    out.print("hops: ");
+    out.println(numHops);
+    for (uint8_t i = 0; i < cfg.numEntries; ++i)
+    {
+        out.print("channel ");
+        out.print(entryStats[i].channel);
+        out.print(" preamble ");
+        out.print(entryStats[i].preambleCode);
+        out.print(" rounds ");
+        out.print(entryStats[i].rounds);
+        out.print(" success ");
+        out.print(successRate(i));
+        out.print("% coex ");
+        out.print(entryStats[i].coexIndications);
+        out.print(" left ");
+        out.print(entryStats[i].hopsAway);
+        out.println(i == current() ? " times, current" : " times");
+    }
+}
+
+void UWBChannelHopper::roundResult(bool success)
+{
+    uint16_t limit = cfg.failThreshold;
+    UWBHopStats& st = entryStats[sequence[position]];
+
+    st.rounds++;
+    if (success)
+    {
+        st.successes++;
+        failedRounds = 0;
+        searching = false;
+        return;
+    }
+
+    // both ends take the same step, but a controlee that did not find the
+    // controller on the new entry waits for it to sweep the whole sequence
+    if (searching && sess.rangingParams.deviceType() != uwb::DeviceType::CONTROLLER)
+        limit = cfg.failThreshold * (cfg.numEntries + 1);
+    if (++failedRounds >= limit)
+        hopRequested = true;
+}
+
+void UWBChannelHopper::rangingHandler(void* data)
+{
+    UWBRangingData* rangingData = (UWBRangingData*)data;
+    bool success = false;
+
+    for (int i = 0; i < maxHoppers; ++i)
+    {
+        UWBChannelHopper* h = hoppers[i];
+        if (h == nullptr || h->sess.sessionHandle() != rangingData->sessionHandle())
+            continue;
+
+        if (rangingData->measureType() == (uint8_t)uwb::MeasurementType::TWO_WAY)
+        {
+            for (int j = 0; j < rangingData->available() && j < uwb::MAX_RESPONDERS; ++j)
+            {
+                if (rangingData->twoWayRangingMeasure()[j].status == 0)
+                    success = true;
+            }
+        }
+        else
+        {
+            success = rangingData->available() > 0;
+        }
+        h->roundResult(success);
+        return;
+    }
+}
+
+void UWBChannelHopper::coexHandler(void* data)
+{
+    (void)data;
+    // the interference hits every session on the air, but only this end
+    // knows: a hop here would leave the peer behind, the ranging results
+    // decide
+    for (int i = 0; i < maxHoppers; ++i)
+    {
+        UWBChannelHopper* h = hoppers[i];
+        if (h != nullptr)
+            h->entryStats[h->sequence[h->position]].coexIndications++;
+    }
+}
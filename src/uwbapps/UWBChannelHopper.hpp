@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBCHANNELHOPPER_HPP
+#define UWBCHANNELHOPPER_HPP
+
+#include <Arduino.h>
+#include "UWBSession.hpp"
+#include "UWBSessionManager.hpp"
+
+/**
+ * @brief hopping configuration of a session
+ *
+ * Every entry is a (channel, preamble code) pair. The key scrambles the
+ * order in which the entries are visited: the two ends of a session must
+ * use the same entries and the same key.
+ *
+ */
+struct UWBHoppingConfig {
+    static const uint8_t maxEntries = 8;
+
+    uint8_t channels[maxEntries];
+    uint8_t preambleCodes[maxEntries];
+    uint8_t numEntries;
+    uint32_t key;               // seed of the hopping sequence
+    uint8_t failThreshold;      // consecutive failed rounds before hopping
+    bool roundHopping;          // also enable the FiRa round hopping of the UWBS
+};
+
+/**
+ * @brief per entry statistics of a UWBChannelHopper
+ *
+ */
+struct UWBHopStats {
+    uint8_t channel;
+    uint8_t preambleCode;
+    uint32_t rounds;            // ranging rounds run on the entry
+    uint32_t successes;         // rounds with at least one valid measurement
+    uint32_t hopsAway;          // times the entry was left because of failures
+    uint32_t coexIndications;   // Wi-Fi coexistence indications received on the entry
+};
+
+/**
+ * @brief adaptive channel and preamble hopping for a ranging session
+ *
+ * The hopper follows the ranging notifications of its session. When the
+ * rounds keep failing, e.g. during a burst of narrowband Wi-Fi 6E
+ * interference, it moves the session to the next entry of the hopping
+ * sequence: the session is stopped, only the channel and the preamble code
+ * are sent with UWBSession::reconfigure(), and it is restarted.
+ *
+ * Both ends hop after failThreshold consecutive failed rounds, so a
+ * burst seen by both moves them to the same next entry. If the controlee
+ * still fails on the new entry, e.g. the two ends counted different rounds
+ * or the next entry is jammed as well, it stops following: it waits
+ * failThreshold * (numEntries + 1) failed rounds on each entry while the
+ * controller keeps hopping every failThreshold failed rounds, so the
+ * controller sweeps all the entries and finds it again. A successful
+ * round brings the controlee back to hopping in step.
+ *
+ * Only the ranging results decide a hop, so both ends always take the
+ * same step of the keyed sequence. Wi-Fi coexistence indications
+ * (WIFI_COEX_IND_NTF) are seen by one end only: they are counted in the
+ * entry statistics and never move the session.
+ *
+ * Usage: configure the session, create the hopper with begin() before
+ * UWBSession::init(), then call update() from loop(). Commands are never
+ * sent from the notification handlers.
+ *
+ */
+class UWBChannelHopper {
+public:
+    static const int maxHoppers = UWB_MAX_SESSIONS;
+
+    /**
+     * @brief Construct a new UWBChannelHopper object
+     *
+     * @param session the session to move, e.g. UWBSessionManager.getSessionByID()
+     * @param config
+     */
+    UWBChannelHopper(UWBSession& session, const UWBHoppingConfig& config);
+    ~UWBChannelHopper();
+
+    /**
+     * @brief write the first entry in the session and follow its notifications
+     *
+     * @return true
+     * @return false if the configuration is empty or too many hoppers are running
+     */
+    bool begin();
+
+    /**
+     * @brief stop following the session, it stays on the current entry
+     */
+    void end();
+
+    /**
+     * @brief hop if the session asked for it, call it from loop()
+     *
+     * @return true if the session was moved
+     */
+    bool update();
+
+    /**
+     * @brief move to the next entry of the sequence now
+     *
+     * The peer does not follow: call it on both ends.
+     *
+     * @return uwb::Status
+     */
+    uwb::Status hop();
+
+    /**
+     * @brief index in the configuration of the current entry
+     */
+    uint8_t current();
+
+    /**
+     * @brief number of hops since begin()
+     */
+    uint32_t hops();
+
+    /**
+     * @brief statistics of an entry of the configuration
+     *
+     * @param index
+     * @param stats
+     * @return true
+     * @return false if the index is not valid
+     */
+    bool stats(uint8_t index, UWBHopStats& stats);
+
+    /**
+     * @brief percentage of successful rounds of an entry, 100 if never used
+     */
+    uint8_t successRate(uint8_t index);
+
+    /**
+     * @brief print the per channel statistics
+     */
+    void printStats(Print& out);
+
+private:
+    void apply();
+    void roundResult(bool success);
+    static void rangingHandler(void* data);
+    static void coexHandler(void* data);
+
+    UWBSession& sess;
+    UWBHoppingConfig cfg;
+    uint8_t sequence[UWBHoppingConfig::maxEntries];     // entries in hopping order
+    uint8_t position;                                   // position in sequence[]
+    UWBHopStats entryStats[UWBHoppingConfig::maxEntries];
+    volatile uint16_t failedRounds;                     // consecutive
+    volatile bool hopRequested;
+    volatile bool searching;                            // no round succeeded since the last hop
+    uint32_t numHops;
+    bool running;
+
+    static UWBChannelHopper* hoppers[maxHoppers];
+};
+
+#endif /* UWBCHANNELHOPPER_HPP */
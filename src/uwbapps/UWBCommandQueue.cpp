@@ -0,0 +1,185 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBCommandQueue.hpp"
+
+UWBCommandBatch::UWBCommandBatch()
+{
+    doneSem = NULL;
+    submitted = 0;
+    result = uwb::Status::SUCCESS;
+}
+
+UWBCommandBatch::~UWBCommandBatch()
+{
+    if (submitted)
+        wait();
+    if (doneSem != NULL)
+        vSemaphoreDelete(doneSem);
+}
+
+bool UWBCommandBatch::add()
+{
+    if (doneSem == NULL)
+    {
+        doneSem = xSemaphoreCreateCounting(0xFF, 0);
+        if (doneSem == NULL)
+            return false;
+    }
+    submitted++;
+    return true;
+}
+
+void UWBCommandBatch::complete(uwb::Status status)
+{
+    if (status != uwb::Status::SUCCESS && result == uwb::Status::SUCCESS)
+        result = status;
+    xSemaphoreGive(doneSem);
+}
+
+int UWBCommandBatch::pending()
+{
+    return submitted;
+}
+
+uwb::Status UWBCommandBatch::wait(uint32_t timeout)
+{
+    uint32_t start = millis();
+    TickType_t ticks = portMAX_DELAY;
+    uwb::Status status;
+
+    while (submitted > 0)
+    {
+        if (timeout != portMAX_DELAY)
+        {
+            uint32_t elapsed = millis() - start;
+            ticks = elapsed < timeout ? pdMS_TO_TICKS(timeout - elapsed) : 0;
+        }
+        if (xSemaphoreTake(doneSem, ticks) != pdTRUE)
+            return uwb::Status::TIMEOUT;
+        submitted--;
+    }
+    status = (uwb::Status)result;
+    result = uwb::Status::SUCCESS;
+    return status;
+}
+
+
+UWBCommandQueue_::UWBCommandQueue_()
+{
+    queue = NULL;
+    taskHandle = NULL;
+    numTimeouts = 0;
+}
+
+bool UWBCommandQueue_::begin()
+{
+    if (taskHandle != NULL)
+        return true;
+
+    queue = xQueueCreate(UWB_COMMAND_QUEUE_DEPTH, sizeof(Item));
+    if (queue == NULL ||
+        xTaskCreate(commandTask, "uwbCommands", 1024, this, 2, &taskHandle) != pdPASS)
+    {
+        UWBHAL.Log_E("could not start the command task");
+        taskHandle = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool UWBCommandQueue_::running()
+{
+    return taskHandle != NULL;
+}
+
+bool UWBCommandQueue_::inCommandTask()
+{
+    return taskHandle != NULL && xTaskGetCurrentTaskHandle() == taskHandle;
+}
+
+uint32_t UWBCommandQueue_::timeouts()
+{
+    return numTimeouts;
+}
+
+bool UWBCommandQueue_::submit(UWBSession& session, UWBCommandType command, UWBCommandBatch* batch,
+                              UWBCommandCallbackType callback, void* context, uint32_t timeout)
+{
+    Item item;
+
+    if (taskHandle == NULL)
+        return false;
+
+    item.session = &session;
+    item.command = command;
+    item.deadline = millis() + timeout;
+    item.callback = callback;
+    item.context = context;
+    item.batch = batch;
+
+    if (batch != nullptr && !batch->add())
+        return false;
+
+    if (xQueueSend(queue, &item, 0) != pdTRUE)
+    {
+        UWBHAL.Log_W("command queue full");
+        if (batch != nullptr)
+            batch->submitted--;
+        return false;
+    }
+    return true;
+}
+
+uwb::Status UWBCommandQueue_::execute(Item& item)
+{
+    // deadline passed while waiting in the queue: don't send it at all
+    if ((int32_t)(millis() - item.deadline) > 0)
+    {
+        numTimeouts++;
+        UWBHAL.Log_W("command %d for session 0x%X expired", (int)item.command, item.session->sessionID());
+        return uwb::Status::TIMEOUT;
+    }
+
+    switch (item.command)
+    {
+        case UWBCommandType::INIT:
+            return item.session->init();
+        case UWBCommandType::START:
+            return item.session->start();
+        case UWBCommandType::STOP:
+            return item.session->stop();
+        case UWBCommandType::DEINIT:
+            return item.session->deInit();
+        case UWBCommandType::RECONFIGURE:
+            return item.session->reconfigure();
+    }
+    return uwb::Status::INVALID_PARAM;
+}
+
+void UWBCommandQueue_::commandTask(void* param)
+{
+    UWBCommandQueue_* cq = (UWBCommandQueue_*)param;
+    Item item;
+    uwb::Status status;
+
+    for (;;)
+    {
+        if (xQueueReceive(cq->queue, &item, portMAX_DELAY) != pdTRUE)
+            continue;
+
+        status = cq->execute(item);
+        if (item.callback != nullptr)
+            item.callback(*item.session, item.command, status, item.context);
+        if (item.batch != nullptr)
+            item.batch->complete(status);
+    }
+}
+
+UWBCommandQueue_ &UWBCommandQueue_::getInstance()
+{
+    static UWBCommandQueue_ instance;
+    return instance;
+}
+
+UWBCommandQueue_ &UWBCommandQueue = UWBCommandQueue.getInstance();
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBCOMMANDQUEUE_HPP
+#define UWBCOMMANDQUEUE_HPP
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include "UWBSession.hpp"
+
+// Maximum number of commands waiting in the queue
+#ifndef UWB_COMMAND_QUEUE_DEPTH
+#define UWB_COMMAND_QUEUE_DEPTH 8
+#endif
+
+/**
+ * @brief session commands that can be queued
+ *
+ */
+enum class UWBCommandType : uint8_t {
+    INIT = 0,           // UWBSession::init()
+    START = 1,          // UWBSession::start()
+    STOP = 2,           // UWBSession::stop()
+    DEINIT = 3,         // UWBSession::deInit()
+    RECONFIGURE = 4     // UWBSession::reconfigure()
+};
+
+/**
+ * @brief called by the command task when a queued command completes
+ *
+ * @param session the session the command was issued for
+ * @param command the completed command
+ * @param status result of the command, uwb::Status::TIMEOUT if it was not
+ * dispatched before its deadline
+ * @param context the pointer passed to submit()
+ */
+typedef void (*UWBCommandCallbackType)(UWBSession& session, UWBCommandType command, uwb::Status status, void* context);
+
+/**
+ * @brief group of queued commands that can be waited for together
+ *
+ * Pass the same batch to several submit() calls, then wait() once for all
+ * of them. The batch must outlive its commands: the destructor waits for
+ * the ones still pending.
+ *
+ */
+class UWBCommandBatch {
+public:
+    UWBCommandBatch();
+    ~UWBCommandBatch();
+
+    /**
+     * @brief wait for all the commands of the batch
+     *
+     * @param timeout milliseconds
+     * @return uwb::Status first error reported by the commands,
+     * uwb::Status::TIMEOUT if some of them did not complete in time
+     */
+    uwb::Status wait(uint32_t timeout = portMAX_DELAY);
+
+    /**
+     * @brief number of commands submitted and not collected by wait() yet
+     */
+    int pending();
+
+private:
+    friend class UWBCommandQueue_;
+    bool add();
+    void complete(uwb::Status status);
+
+    SemaphoreHandle_t doneSem;  // given once per completed command
+    int submitted;
+    volatile uint8_t result;
+};
+
+/**
+ * @brief asynchronous session command queue
+ *
+ * Commands are queued without waiting for the UWBS and executed back to
+ * back, in submission order, by a dedicated task. The caller is notified
+ * through a callback and/or a UWBCommandBatch. Every command has a
+ * deadline: a command still queued when its deadline expires is not sent
+ * and completes with uwb::Status::TIMEOUT.
+ *
+ * Sessions must stay valid until their commands complete. Callbacks run in
+ * the command task: they may submit further commands but must not wait
+ * for a batch.
+ *
+ */
+class UWBCommandQueue_ {
+public:
+    /**
+     * @brief create the queue and start the command task (automatically called by UWB.begin())
+     *
+     * @return true
+     * @return false if the queue or the task could not be created
+     */
+    bool begin();
+
+    /**
+     * @brief true if the command task is running
+     */
+    bool running();
+
+    /**
+     * @brief queue a session command
+     *
+     * @param session
+     * @param command
+     * @param batch optional batch to add the command to
+     * @param callback optional completion callback
+     * @param context passed to the callback
+     * @param timeout milliseconds the command may wait in the queue
+     * @return true
+     * @return false if the queue is not running or full, nothing was queued
+     */
+    bool submit(UWBSession& session, UWBCommandType command, UWBCommandBatch* batch = nullptr,
+                UWBCommandCallbackType callback = nullptr, void* context = nullptr,
+                uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
+    /**
+     * @brief true when called from the command task (i.e. from a callback)
+     */
+    bool inCommandTask();
+
+    /**
+     * @brief number of commands dropped because their deadline expired
+     */
+    uint32_t timeouts();
+
+    static UWBCommandQueue_& getInstance();
+
+private:
+    struct Item {
+        UWBSession* session;
+        UWBCommandType command;
+        uint32_t deadline;
+        UWBCommandCallbackType callback;
+        void* context;
+        UWBCommandBatch* batch;
+    };
+
+    UWBCommandQueue_();
+    UWBCommandQueue_(UWBCommandQueue_ const &) = delete;
+    void operator=(UWBCommandQueue_ const &) = delete;
+
+    static void commandTask(void* param);
+    uwb::Status execute(Item& item);
+
+    QueueHandle_t queue;
+    TaskHandle_t taskHandle;
+    volatile uint32_t numTimeouts;
+};
+
+extern UWBCommandQueue_ &UWBCommandQueue;
+
+#endif
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBCONTENTIONANCHOR_HPP
+#define UWBCONTENTIONANCHOR_HPP
+
+#include "UWBSession.hpp"
+#include "UWBRangingPlanner.hpp"
+
+/**
+ * @brief Contention based one-to-many ranging Controller
+ *
+ * The anchor does not need the addresses of the tags: every round it
+ * sends the control and poll messages, and any UWBContentionTag of the
+ * same session answers in a random slot of the Contention Access Period.
+ * Tags can come and go without reconfiguring the anchor, at the price of
+ * the attempts lost to collisions.
+ *
+ * The round is sized by UWBRangingPlanner::planContention() for the number
+ * of tags expected in range: plan the tags with the same inputs.
+ */
+class UWBContentionAnchor : public UWBSession {
+
+public:
+	/**
+	 * @param session_ID
+	 * @param srcAddr anchor address
+	 * @param expectedTags tags expected in range at the same time
+	 * @param updateRate requested ranging rate, Hz
+	 * @param blockStride stride of the tags, see UWBContentionTag
+	 */
+	UWBContentionAnchor(uint32_t session_ID, UWBMacAddress srcAddr, uint16_t expectedTags,
+	                    float updateRate = 10, uint8_t blockStride = 0)
+	{
+		UWBRoundPlan plan;
+
+		sessionID(session_ID);
+		sessionType(uwb::SessionType::RANGING);
+		rangingParams.deviceRole(uwb::DeviceRole::INITIATOR);
+		rangingParams.deviceType(uwb::DeviceType::CONTROLLER);
+		rangingParams.multiNodeMode(uwb::MultiNodeMode::ONE_TO_MANY);
+		rangingParams.rangingRoundUsage(uwb::RangingMethod::DS_TWR_NO_DEFER);
+		rangingParams.scheduledMode(uwb::ScheduledMode::CONTENTION);
+		rangingParams.macAddrMode((uint8_t)uwb::MacAddressMode::SHORT);
+		rangingParams.deviceMacAddr(srcAddr);
+
+		appParams.frameConfig(uwb::RfFrameConfig::SP3);
+		appParams.stsConfig(uwb::StsConfig::StaticSts);
+		appParams.sfdId(2);
+		appParams.preambleCodeIndex(10);
+
+		// the CAP is sized for the striding tags, but the anchor ranges every round
+		if (UWBRangingPlanner::planContention(expectedTags, uwb::RangingMethod::DS_TWR_NO_DEFER,
+		                                      uwb::RfFrameConfig::SP3, updateRate, plan, blockStride))
+		{
+			plan.blockStride = 0;
+			UWBRangingPlanner::apply(plan, appParams);
+		}
+	}
+};
+
+#endif /* UWBCONTENTIONANCHOR_HPP */
@@ -0,0 +1,62 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBCONTENTIONTAG_HPP
+#define UWBCONTENTIONTAG_HPP
+
+#include "UWBSession.hpp"
+#include "UWBMacAddressList.hpp"
+#include "UWBRangingPlanner.hpp"
+
+/**
+ * @brief Contention based ranging Controlee, the counterpart of UWBContentionAnchor
+ *
+ * In dense populations the tags can also stride over ranging blocks: with
+ * blockStride 1 each tag ranges every other round, halving the tags
+ * contending for the same CAP. All the tags of a session should use the
+ * same stride, and the anchor be given the same expectedTags, updateRate
+ * and blockStride to size the CAP the same way.
+ */
+class UWBContentionTag : public UWBSession {
+
+public:
+	/**
+	 * @param session_ID
+	 * @param srcAddr tag address
+	 * @param anchorAddr address of the UWBContentionAnchor
+	 * @param expectedTags tags expected in range at the same time
+	 * @param updateRate requested ranging rate, Hz
+	 * @param blockStride rounds skipped between two ranging attempts
+	 */
+	UWBContentionTag(uint32_t session_ID, UWBMacAddress srcAddr, UWBMacAddress anchorAddr,
+	                 uint16_t expectedTags, float updateRate = 10, uint8_t blockStride = 0)
+	{
+		UWBRoundPlan plan;
+		UWBMacAddressList anchor(UWBMacAddress::Size::SHORT);
+
+		sessionID(session_ID);
+		sessionType(uwb::SessionType::RANGING);
+		rangingParams.deviceRole(uwb::DeviceRole::RESPONDER);
+		rangingParams.deviceType(uwb::DeviceType::CONTROLEE);
+		rangingParams.multiNodeMode(uwb::MultiNodeMode::ONE_TO_MANY);
+		rangingParams.rangingRoundUsage(uwb::RangingMethod::DS_TWR_NO_DEFER);
+		rangingParams.scheduledMode(uwb::ScheduledMode::CONTENTION);
+		rangingParams.macAddrMode((uint8_t)uwb::MacAddressMode::SHORT);
+		rangingParams.deviceMacAddr(srcAddr);
+
+		// owned copy, anchorAddr goes out of scope with the constructor
+		anchor.add(anchorAddr);
+		controlees(anchor);
+		appParams.frameConfig(uwb::RfFrameConfig::SP3);
+		appParams.stsConfig(uwb::StsConfig::StaticSts);
+		appParams.stsSegments(1);
+		appParams.sfdId(2);
+		appParams.preambleCodeIndex(10);
+
+		if (UWBRangingPlanner::planContention(expectedTags, uwb::RangingMethod::DS_TWR_NO_DEFER,
+		                                      uwb::RfFrameConfig::SP3, updateRate, plan, blockStride))
+			UWBRangingPlanner::apply(plan, appParams);
+	}
+};
+
+#endif /* UWBCONTENTIONTAG_HPP */
@@ -0,0 +1,299 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBHusSession.hpp"
+#include "UWBRangingPlanner.hpp"
+
+// in-band data blocks reserved per round, as in the in-band data sessions
+static const uint32_t dataBlocks = 12;
+
+static uwb::MultiNodeMode husMultiNodeMode(uwb::HusConfigMode mode)
+{
+    switch (mode)
+    {
+        case uwb::HusConfigMode::HUS_MULTICAST:
+            return uwb::MultiNodeMode::MULTICAST;
+        case uwb::HusConfigMode::HUS_ONE_TO_MANY:
+            return uwb::MultiNodeMode::ONE_TO_MANY;
+        default:
+            return uwb::MultiNodeMode::UNICAST;
+    }
+}
+
+static uint8_t husStsConfig(uwb::HusSecurityMode security)
+{
+    switch (security)
+    {
+        case uwb::HusSecurityMode::HUS_DYNAMIC_STS:
+            return uwb::StsConfig::DynamicSts;
+        case uwb::HusSecurityMode::HUS_PROVISIONED_STS:
+            return uwb::StsConfig::ProvisionSts;
+        default:
+            return uwb::StsConfig::StaticSts;
+    }
+}
+
+UWBHusSession::UWBHusSession(uint32_t rangingID, UWBSession& dataSession, const uwb::DataTransferPhaseConfig& phase)
+    : data(dataSession)
+{
+    // the data session is not constructed yet, see configureDataPhase()
+    phaseConfig = phase;
+    begun = false;
+    ranging.sessionID(rangingID);
+    ranging.sessionType(uwb::SessionType::RANGING);
+}
+
+void UWBHusSession::configureDataPhase(uint32_t dataID, uint8_t numControlees)
+{
+    uint32_t slotRstu = (uint32_t)phaseConfig.slot_duration_us * 6 / 5;    // 1.2 RSTU per us
+    uint16_t slots = UWBRangingPlanner::slotsNeeded(numControlees, uwb::RangingMethod::DS_TWR_NO_DEFER);
+    uint32_t roundMs = ((uint32_t)slots * phaseConfig.slot_duration_us + 999) / 1000;
+
+    data.sessionID(dataID);
+    data.sessionType(uwb::SessionType::RANGING_WITH_DATA);
+
+    // dense rounds of payload frames, back to back
+    data.rangingParams.rangingRoundUsage(uwb::RangingMethod::DS_TWR_NO_DEFER);
+    data.rangingParams.scheduledMode(uwb::ScheduledMode::TIME_SCHEDULED);
+    data.appParams.frameConfig(uwb::RfFrameConfig::SP1);
+    data.appParams.slotPerRR(slots);
+    data.appParams.slotDuration(slotRstu);
+    data.appParams.rangingDuration(roundMs ? roundMs : 1);
+    data.appParams.mtuSize(phaseConfig.mtu_size);
+    if (phaseConfig.data_repetition_count > 1)
+        data.appParams.dataRepetition(phaseConfig.data_repetition_count - 1);
+    if (phaseConfig.block_striding_len > 1)
+        data.appParams.blockStride(phaseConfig.block_striding_len - 1);
+}
+
+void UWBHusSession::configureRanging(UWBMacAddress& srcAddr, uint8_t channel, uint8_t preambleCode,
+                                     uint16_t slotsPerRR, uint32_t interval, uint16_t slotDurationMs,
+                                     uint8_t rangingRoundUsage, uwb::HusConfigMode mode, uwb::HusSecurityMode security)
+{
+    uwb::RangingMethod method = rangingRoundUsage ? (uwb::RangingMethod)rangingRoundUsage : uwb::RangingMethod::DS_TWR;
+    uint8_t sts = husStsConfig(security);
+
+    ranging.rangingParams.multiNodeMode(husMultiNodeMode(mode));
+    ranging.rangingParams.rangingRoundUsage(method);
+    ranging.rangingParams.scheduledMode(uwb::ScheduledMode::TIME_SCHEDULED);
+    ranging.rangingParams.macAddrMode((uint8_t)uwb::MacAddressMode::SHORT);
+    ranging.rangingParams.deviceMacAddr(srcAddr);
+    ranging.appParams.channel(channel);
+    ranging.appParams.preambleCodeIndex(preambleCode);
+    ranging.appParams.frameConfig(uwb::RfFrameConfig::SP3);
+    ranging.appParams.slotPerRR(slotsPerRR);
+    ranging.appParams.slotDuration((uint32_t)slotDurationMs * 1200);
+    ranging.appParams.rangingDuration(interval);
+    ranging.appParams.stsConfig(sts);
+    ranging.appParams.sfdId(2);
+
+    // the data session shares channel, addresses and security, and yields
+    // to ranging when both are active
+    data.rangingParams.multiNodeMode(husMultiNodeMode(mode));
+    data.rangingParams.macAddrMode((uint8_t)uwb::MacAddressMode::SHORT);
+    data.rangingParams.deviceMacAddr(srcAddr);
+    data.appParams.channel(channel);
+    data.appParams.preambleCodeIndex(preambleCode);
+    data.appParams.stsConfig(sts);
+    data.appParams.sfdId(2);
+    data.appParams.sessionPriority(30);
+}
+
+uwb::Status UWBHusSession::begin()
+{
+    uwb::Status status;
+
+    if (begun)
+        return uwb::Status::SUCCESS;
+    status = ranging.init();
+    if (status == uwb::Status::SUCCESS)
+        status = data.init();
+    if (status == uwb::Status::SUCCESS)
+        status = ranging.start();
+    if (status != uwb::Status::SUCCESS)
+    {
+        UWBHAL.Log_E("HUS session %08X setup failed: %d", ranging.sessionID(), status);
+        end();
+        return status;
+    }
+    begun = true;
+    return status;
+}
+
+void UWBHusSession::end()
+{
+    ranging.stop();
+    data.stop();
+    ranging.deInit();
+    data.deInit();
+    begun = false;
+}
+
+UWBSession& UWBHusSession::rangingSession()
+{
+    return ranging;
+}
+
+UWBSession& UWBHusSession::dataSession()
+{
+    return data;
+}
+
+UWBMacAddress UWBHusController::firstAddress(const uwb::HusControllerConfig& config)
+{
+    if (config.controlee_addresses.empty())
+        return UWBMacAddress(UWBMacAddress::Size::SHORT);
+    return UWBMacAddress(config.controlee_addresses[0].is_short ? UWBMacAddress::Size::SHORT : UWBMacAddress::Size::LONG,
+                         config.controlee_addresses[0].addr.data());
+}
+
+UWBHusController::UWBHusController(uint32_t rangingID, uint32_t dataID, UWBMacAddress srcAddr,
+                                   const uwb::HusControllerConfig& config,
+                                   const uwb::DataTransferPhaseConfig& phase)
+    : UWBHusSession(rangingID, dataTx, phase),
+      dataTx(dataID, srcAddr, firstAddress(config), dataBlocks),
+      firstControlee(firstAddress(config))
+{
+    UWBMacAddress::Size size = firstControlee.getSize() == UWBMacAddress::SHORT ? UWBMacAddress::Size::SHORT : UWBMacAddress::Size::LONG;
+    UWBMacAddressList list(size);
+
+    sending = false;
+    numPhases = 0;
+    numBytes = 0;
+    lastThroughput = 0;
+
+    for (const uwb::MacAddress& addr : config.controlee_addresses)
+    {
+        UWBMacAddress controlee(size, addr.addr.data());
+        list.add(controlee);
+    }
+
+    configureDataPhase(dataID, list.size());
+    configureRanging(srcAddr, config.channel_number, config.preamble_code_index,
+                     config.slots_per_ranging_round, config.ranging_interval_ms, config.slot_duration_ms,
+                     config.ranging_round_usage, config.config_mode, config.security_mode);
+    ranging.rangingParams.deviceRole(uwb::DeviceRole::INITIATOR);
+    ranging.rangingParams.deviceType(uwb::DeviceType::CONTROLLER);
+    ranging.appParams.maxRetries(config.max_ranging_round_retries);
+    ranging.controlees(list);
+    if (config.hopping_mode_enabled)
+        ranging.appParams.hoppingMode(1);
+    if (config.session_priority)
+        ranging.appParams.sessionPriority(config.session_priority);
+
+    data.rangingParams.deviceRole(uwb::DeviceRole::INITIATOR);
+    data.rangingParams.deviceType(uwb::DeviceType::CONTROLLER);
+    data.controlees(list);
+}
+
+uwb::Status UWBHusController::begin()
+{
+    numPhases = 0;
+    numBytes = 0;
+    return UWBHusSession::begin();
+}
+
+uwb::Status UWBHusController::send(const uint8_t* buf, size_t len, UWBMacAddress* dstAddr)
+{
+    uwb::Status status = uwb::Status::SUCCESS;
+    uint16_t mtu = phaseConfig.mtu_size;
+    uint32_t start;
+    uint16_t n;
+    bool pauseRanging = !phaseConfig.enable_ranging;
+    // as long as a frame confirmed after all its retries
+    uint32_t wait = (uint32_t)phaseConfig.phase_timeout_ms * (phaseConfig.max_retry_count + 1);
+
+    if (!begun)
+        return uwb::Status::NOT_INITIALIZED;
+    if (sending)
+        return uwb::Status::REJECTED;
+    if (mtu == 0 || mtu > uwb::MAX_APP_DATA_SIZE)
+        mtu = uwb::MAX_APP_DATA_SIZE;
+    dataTx.destinationAddr(dstAddr != nullptr ? *dstAddr : firstControlee);
+
+    sending = true;
+    start = millis();
+    if (pauseRanging && ranging.stop() == uwb::Status::SUCCESS)
+        ranging.waitForState(UWBSessionState::IDLE);
+    status = data.start();
+    if (status == uwb::Status::SUCCESS)
+        data.waitForState(UWBSessionState::ACTIVE);
+
+    // the window keeps the UWBS fed, frames are confirmed while the next ones are queued
+    for (size_t offset = 0; offset < len && status == uwb::Status::SUCCESS; offset += n)
+    {
+        n = len - offset < mtu ? len - offset : mtu;
+        status = dataTx.queueData(&buf[offset], n, wait);
+    }
+    if (status == uwb::Status::SUCCESS)
+        status = dataTx.flush(wait);
+    if (status == uwb::Status::SUCCESS)
+        numBytes += len;
+
+    if (data.stop() == uwb::Status::SUCCESS)
+        data.waitForState(UWBSessionState::IDLE);
+    if (pauseRanging)
+        ranging.start();
+    sending = false;
+
+    numPhases++;
+    lastThroughput = len * 1000.0f / (millis() - start + 1);
+    if (status != uwb::Status::SUCCESS)
+        UWBHAL.Log_E("HUS data phase failed: %d", status);
+    return status;
+}
+
+uint32_t UWBHusController::phases()
+{
+    return numPhases;
+}
+
+uint32_t UWBHusController::bytesSent()
+{
+    return numBytes;
+}
+
+float UWBHusController::throughput()
+{
+    return lastThroughput;
+}
+
+UWBHusControlee::UWBHusControlee(uint32_t rangingID, uint32_t dataID, UWBMacAddress srcAddr,
+                                 const uwb::HusControleeConfig& config,
+                                 const uwb::DataTransferPhaseConfig& phase,
+                                 uint8_t numControlees)
+    : UWBHusSession(rangingID, rxData, phase)
+{
+    UWBMacAddress::Size size = config.controller_address.is_short ? UWBMacAddress::Size::SHORT : UWBMacAddress::Size::LONG;
+    UWBMacAddress controller(size, config.controller_address.addr.data());
+    UWBMacAddressList list(size);
+
+    list.add(controller);
+    configureDataPhase(dataID, numControlees);
+    configureRanging(srcAddr, config.channel_number, config.preamble_code_index,
+                     config.slots_per_ranging_round, config.ranging_interval_ms, config.slot_duration_ms,
+                     config.ranging_round_usage, config.config_mode, config.security_mode);
+    ranging.rangingParams.deviceRole(uwb::DeviceRole::RESPONDER);
+    ranging.rangingParams.deviceType(uwb::DeviceType::CONTROLEE);
+    ranging.appParams.stsSegments(1);
+    ranging.controlees(list);
+    if (config.hopping_mode_enabled)
+        ranging.appParams.hoppingMode(1);
+
+    data.rangingParams.deviceRole(uwb::DeviceRole::RESPONDER);
+    data.rangingParams.deviceType(uwb::DeviceType::CONTROLEE);
+    data.controlees(list);
+    uwb::AppParamValue blocks;
+    blocks.vu32 = dataBlocks;
+    data.vendorParams.addOrUpdateParam(uwb::VendorAppConfigId::SESSION_INBAND_DATA_RX_BLOCKS, uwb::AppParamType::U32, blocks);
+}
+
+uwb::Status UWBHusControlee::begin()
+{
+    uwb::Status status = UWBHusSession::begin();
+
+    // the controlee listens to the data phases all the time
+    if (status == uwb::Status::SUCCESS)
+        status = data.start();
+    return status;
+}
@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBHUSSESSION_HPP
+#define UWBHUSSESSION_HPP
+
+#include <Arduino.h>
+#include "Arduino_FreeRTOS.h"
+#include "UWBSession.hpp"
+#include "UWBMacAddressList.hpp"
+#include "UWBInbandDataTx.hpp"
+
+/**
+ * @brief Hybrid UWB Scheduling: ranging phases interleaved with data phases
+ *
+ * A HUS session pairs a ranging session with a data session on the same
+ * channel. The ranging session runs light SP3 rounds; the data session
+ * runs dense SP1 rounds with large in-band data blocks, and is only active
+ * while there is something to transfer, so ranging keeps the air time the
+ * rest of the time.
+ *
+ * The configuration is given with the HUS structures of the HAL
+ * (uwb::HusControllerConfig, uwb::HusControleeConfig and
+ * uwb::DataTransferPhaseConfig) and mapped on two standard sessions: the
+ * HUS primary/secondary session commands are not available in the HAL
+ * shipped with the library.
+ *
+ * Both ends must be built with the same session IDs, ranging timing, data
+ * phase configuration and number of controlees.
+ *
+ */
+class UWBHusSession {
+public:
+    /**
+     * @brief init both sessions and start ranging
+     *
+     * @return uwb::Status
+     */
+    virtual uwb::Status begin();
+
+    /**
+     * @brief stop and deinit both sessions
+     */
+    void end();
+
+    /**
+     * @brief the session running the ranging phases
+     */
+    UWBSession& rangingSession();
+
+    /**
+     * @brief the session running the data phases, data notifications carry its handle
+     */
+    UWBSession& dataSession();
+
+protected:
+    /**
+     * @param dataSession storage of the data session, owned by the derived class
+     */
+    UWBHusSession(uint32_t rangingID, UWBSession& dataSession, const uwb::DataTransferPhaseConfig& phase);
+
+    /**
+     * @brief dense data rounds, sized for the controlees like a ranging round
+     */
+    void configureDataPhase(uint32_t dataID, uint8_t numControlees);
+    void configureRanging(UWBMacAddress& srcAddr, uint8_t channel, uint8_t preambleCode,
+                          uint16_t slotsPerRR, uint32_t interval, uint16_t slotDurationMs,
+                          uint8_t rangingRoundUsage, uwb::HusConfigMode mode, uwb::HusSecurityMode security);
+
+    UWBSession ranging;
+    UWBSession& data;
+    uwb::DataTransferPhaseConfig phaseConfig;
+    bool begun;
+};
+
+/**
+ * @brief HUS controller, pushes bulk data to its controlees in data phases
+ *
+ * send() opens a data phase: ranging is paused (unless the phase config
+ * enables ranging during data transfer, then the UWBS interleaves the two
+ * sessions by priority), the data session is started, the buffer is sent
+ * in MTU sized frames and ranging resumes. The data session is a
+ * UWBInBandDataTx: up to UWB_INBAND_TX_WINDOW frames are in the UWBS at
+ * once, so every data round carries a frame, and the window retransmits
+ * the ones that are not confirmed.
+ *
+ */
+class UWBHusController : public UWBHusSession {
+public:
+    /**
+     * @brief Construct a new UWBHusController object
+     *
+     * @param rangingID session ID of the ranging phases
+     * @param dataID session ID of the data phases
+     * @param srcAddr address of the controller
+     * @param config ranging configuration and controlees
+     * @param phase data phase configuration
+     */
+    UWBHusController(uint32_t rangingID, uint32_t dataID, UWBMacAddress srcAddr,
+                     const uwb::HusControllerConfig& config,
+                     const uwb::DataTransferPhaseConfig& phase = uwb::DataTransferPhaseConfig());
+
+    uwb::Status begin() override;
+
+    /**
+     * @brief send a buffer in a data phase, blocking
+     *
+     * Must not be called from a notification handler.
+     *
+     * @param buf
+     * @param len
+     * @param dstAddr destination, the first controlee if nullptr
+     * @return uwb::Status::SUCCESS once every frame was transmitted
+     * @return uwb::Status::TIMEOUT if the window stayed full, or was not
+     *         emptied at the end, for phase_timeout_ms * (max_retry_count + 1)
+     * @return uwb::Status::FAILED if a frame failed UWBInBandDataTx::maxRetries times
+     */
+    uwb::Status send(const uint8_t* buf, size_t len, UWBMacAddress* dstAddr = nullptr);
+
+    /**
+     * @brief data phases run and bytes of the successful ones since begin()
+     */
+    uint32_t phases();
+    uint32_t bytesSent();
+
+    /**
+     * @brief payload throughput of the last data phase, bytes per second
+     */
+    float throughput();
+
+private:
+    static UWBMacAddress firstAddress(const uwb::HusControllerConfig& config);
+
+    UWBInBandDataTx dataTx;
+    UWBMacAddress firstControlee;
+    bool sending;
+    uint32_t numPhases;
+    uint32_t numBytes;
+    float lastThroughput;
+};
+
+/**
+ * @brief HUS controlee, ranges with the controller and listens to its data phases
+ *
+ * Both sessions stay active: the data session only receives when the
+ * controller opens a data phase. Received data is delivered with
+ * UWB.registerDataRxCallback(), filter it with dataSession().sessionHandle().
+ *
+ */
+class UWBHusControlee : public UWBHusSession {
+public:
+    /**
+     * @brief Construct a new UWBHusControlee object
+     *
+     * @param rangingID session ID of the ranging phases
+     * @param dataID session ID of the data phases
+     * @param srcAddr address of the controlee
+     * @param config ranging configuration and controller address
+     * @param phase data phase configuration
+     * @param numControlees controlees of the controller, the data rounds are sized on them
+     */
+    UWBHusControlee(uint32_t rangingID, uint32_t dataID, UWBMacAddress srcAddr,
+                    const uwb::HusControleeConfig& config,
+                    const uwb::DataTransferPhaseConfig& phase = uwb::DataTransferPhaseConfig(),
+                    uint8_t numControlees = 1);
+
+    uwb::Status begin() override;
+
+private:
+    UWBSession rxData;
+};
+
+#endif /* UWBHUSSESSION_HPP */
@@ -0,0 +1,118 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBIDMAP_HPP
+#define UWBIDMAP_HPP
+
+#include <stdint.h>
+
+/**
+ * @brief fixed size hash map from an integer key (session ID, session handle, 
+ * BLE address, ...) to a small index
+ * 
+ * Open addressing with linear probing, the table is twice the number of 
+ * entries rounded up to a power of two, so lookups take a probe or two. 
+ * No heap is used.
+ * 
+ * @tparam N maximum number of entries
+ * @tparam Key unsigned integer type of the keys
+ */
+template <unsigned int N, typename Key = uint32_t> class UWBIdMap {
+public:
+    UWBIdMap() {
+        clear();
+    }
+
+    void clear() {
+        for (unsigned int i = 0; i < SIZE; i++)
+            _used[i] = false;
+        _count = 0;
+    }
+
+    /**
+     * @brief add a key or update its value
+     * 
+     * @return false if the map is full
+     */
+    bool insert(Key key, uint8_t value) {
+        unsigned int i = slot(key);
+        while (_used[i]) {
+            if (_keys[i] == key) {
+                _values[i] = value;
+                return true;
+            }
+            i = (i + 1) & (SIZE - 1);
+        }
+        if (_count >= N)
+            return false;
+        _used[i] = true;
+        _keys[i] = key;
+        _values[i] = value;
+        _count++;
+        return true;
+    }
+
+    bool find(Key key, uint8_t& value) const {
+        unsigned int i = slot(key);
+        while (_used[i]) {
+            if (_keys[i] == key) {
+                value = _values[i];
+                return true;
+            }
+            i = (i + 1) & (SIZE - 1);
+        }
+        return false;
+    }
+
+    bool remove(Key key) {
+        unsigned int i = slot(key);
+        while (_used[i] && _keys[i] != key)
+            i = (i + 1) & (SIZE - 1);
+        if (!_used[i])
+            return false;
+
+        // backward shift the following entries, so no tombstones are needed
+        unsigned int j = i;
+        for (;;) {
+            _used[i] = false;
+            for (;;) {
+                j = (j + 1) & (SIZE - 1);
+                if (!_used[j]) {
+                    _count--;
+                    return true;
+                }
+                unsigned int home = slot(_keys[j]);
+                // move j back to i only if its home slot is not in (i, j]
+                if (i <= j ? (home <= i || home > j) : (home <= i && home > j))
+                    break;
+            }
+            _keys[i] = _keys[j];
+            _values[i] = _values[j];
+            _used[i] = true;
+            i = j;
+        }
+    }
+
+    unsigned int size() const {
+        return _count;
+    }
+
+private:
+    static constexpr unsigned int tableSize(unsigned int n, unsigned int s = 1) {
+        return s >= 2 * n ? s : tableSize(n, s * 2);
+    }
+    static const unsigned int SIZE = tableSize(N);
+
+    static unsigned int slot(Key key) {
+        // fold wider keys, then Fibonacci hashing: IDs and handles are often sequential
+        uint32_t k = (uint32_t)((uint64_t)key ^ ((uint64_t)key >> 32));
+        return (unsigned int)((k * 2654435761u) >> 16) & (SIZE - 1);
+    }
+
+    Key _keys[SIZE];
+    uint8_t _values[SIZE];
+    bool _used[SIZE];
+    unsigned int _count;
+};
+
+#endif /* UWBIDMAP_HPP */
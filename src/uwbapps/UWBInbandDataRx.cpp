@@ -0,0 +1,267 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBInbandDataRx.hpp"
+#include "UWBNotification.hpp"
+
+UWBInBandDataRx* UWBInBandDataRx::receivers[maxReceivers] = {nullptr};
+
+UWBInBandDataRx::UWBInBandDataRx(uint32_t session_ID, UWBMacAddress srcAddr,
+                                 UWBMacAddress dstAddr, uint32_t dataBlocks)
+    : peer(dstAddr)
+{
+    UWBMacAddressList peer(dstAddr.getSize() == UWBMacAddress::SHORT ? UWBMacAddress::Size::SHORT : UWBMacAddress::Size::LONG);
+    uwb::AppParamValue value;
+
+    rxBuf = nullptr;
+    rxSize = 0;
+    assembling = false;
+    rejecting = false;
+    complete = false;
+    numDropped = 0;
+    rxDone = NULL;
+    acking = false;
+    ackPending = false;
+    ackSeq = 0;
+    lastValid = false;
+
+    sessionID(session_ID);
+    sessionType(uwb::SessionType::RANGING_WITH_DATA);
+
+    rangingParams.deviceRole(uwb::DeviceRole::RESPONDER);
+    rangingParams.deviceType(uwb::DeviceType::CONTROLEE);
+    rangingParams.multiNodeMode(uwb::MultiNodeMode::UNICAST);
+    rangingParams.rangingRoundUsage(uwb::RangingMethod::DS_TWR);
+    rangingParams.scheduledMode(uwb::ScheduledMode::TIME_SCHEDULED);
+    rangingParams.deviceMacAddr(srcAddr);
+
+    peer.add(dstAddr);
+    controlees(peer);
+    // link layer bypass, frames with payload
+    appParams.addOrUpdateParam(buildScalar(uwb::AppConfigId::LinkMode, 0));
+    appParams.frameConfig(uwb::RfFrameConfig::SP1);
+    appParams.slotPerRR(25);
+    appParams.rangingDuration(200);
+    appParams.stsConfig(uwb::StsConfig::StaticSts);
+    appParams.stsSegments(1);
+    appParams.sfdId(2);
+    appParams.preambleCodeIndex(10);
+
+    // vendor specific data transfer parameters
+    value.vu32 = 0;
+    vendorParams.addOrUpdateParam(uwb::VendorAppConfigId::SESSION_INBAND_DATA_TX_BLOCKS, uwb::AppParamType::U32, value);
+    value.vu32 = dataBlocks;
+    vendorParams.addOrUpdateParam(uwb::VendorAppConfigId::SESSION_INBAND_DATA_RX_BLOCKS, uwb::AppParamType::U32, value);
+}
+
+UWBInBandDataRx::~UWBInBandDataRx()
+{
+    for (int i = 0; i < maxReceivers; ++i)
+    {
+        if (receivers[i] == this)
+            receivers[i] = nullptr;
+    }
+    // the handlers no longer find the session
+    if (rxDone != NULL)
+        vSemaphoreDelete(rxDone);
+}
+
+void UWBInBandDataRx::enableAcks(uint32_t ackBlocks)
+{
+    uwb::AppParamValue value;
+
+    value.vu32 = ackBlocks;
+    vendorParams.addOrUpdateParam(uwb::VendorAppConfigId::SESSION_INBAND_DATA_TX_BLOCKS, uwb::AppParamType::U32, value);
+    acking = true;
+    attach();
+}
+
+bool UWBInBandDataRx::attach()
+{
+    int free = -1;
+
+    if (rxDone == NULL)
+    {
+        rxDone = xSemaphoreCreateBinary();
+        if (rxDone == NULL)
+            return false;
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::DATA_RCV_NTF, receiveHandler);
+    }
+    for (int i = 0; i < maxReceivers; ++i)
+    {
+        if (receivers[i] == this)
+            return true;
+        if (receivers[i] == nullptr && free < 0)
+            free = i;
+    }
+    if (free < 0)
+        return false;
+    receivers[free] = this;
+    return true;
+}
+
+uwb::Status UWBInBandDataRx::receive(uint8_t* buf, size_t size, size_t& len, uint32_t timeout)
+{
+    uwb::Status status = uwb::Status::TIMEOUT;
+    uint32_t start = millis();
+    uint32_t elapsed;
+
+    len = 0;
+    if (rxBuf != nullptr)
+        return uwb::Status::REJECTED;
+    if (!attach())
+        return uwb::Status::MAX_SESSIONS_EXCEEDED;
+
+    // armed before the handler can see it
+    rxSize = size;
+    assembling = false;
+    rejecting = false;
+    complete = false;
+    xSemaphoreTake(rxDone, 0);
+    rxBuf = buf;
+
+    for (;;)
+    {
+        elapsed = millis() - start;
+        if (elapsed >= timeout)
+            break;
+        xSemaphoreTake(rxDone, pdMS_TO_TICKS(timeout - elapsed));
+        update();
+        if (complete)
+        {
+            len = rxLen;
+            status = uwb::Status::SUCCESS;
+            break;
+        }
+    }
+
+    rxBuf = nullptr;
+    if (status != uwb::Status::SUCCESS && assembling)
+        numDropped++;
+    assembling = false;
+    return status;
+}
+
+uwb::Status UWBInBandDataRx::update()
+{
+    UWBInbandAck ack;
+    uint8_t frame[UWBInbandAck::headerSize + sizeof(ack.received)];
+    uwb::DataPacket packet;
+    uwb::Status status;
+
+    if (!ackPending)
+        return uwb::Status::SUCCESS;
+    ackPending = false;
+
+    ack.msgId = ackMsgId;
+    ack.pollIndex = ackPoll;
+    if (assembling && rxMsgId == ackMsgId)
+    {
+        ack.count = rxCount;
+        memcpy(ack.received, rxMap, sizeof(ack.received));
+    }
+    else if (lastValid && lastMsgId == ackMsgId)
+    {
+        ack.count = lastCount;
+        memset(ack.received, 0, sizeof(ack.received));
+        for (int i = 0; i < lastCount; ++i)
+            ack.received[i >> 3] |= 1 << (i & 7);
+    }
+    else
+    {
+        // nothing known about the message, the sender retries
+        return uwb::Status::SUCCESS;
+    }
+
+    packet.session_handle = sessionHdl;
+    memcpy(packet.mac_address, peer.getData(), peer.getSize());
+    packet.data = frame;
+    packet.data_size = ack.write(frame);
+    packet.sequence_number = ackSeq++;
+    status = UWBHAL.sendData(packet);
+    if (status != uwb::Status::SUCCESS)
+        UWBHAL.Log_E("could not acknowledge message %d: %d", ack.msgId, status);
+    return status;
+}
+uint32_t UWBInBandDataRx::dropped()
+{
+    return numDropped;
+}
+
+void UWBInBandDataRx::fragment(const uint8_t* frame, size_t len)
+{
+    UWBInbandFragment header;
+    uint8_t bit;
+
+    if (!header.read(frame, len))
+        return;
+    if (header.ackRequest && acking)
+    {
+        // sent by update(), the handler must not issue commands
+        ackMsgId = header.msgId;
+        ackPoll = header.index;
+        ackPending = true;
+        xSemaphoreGive(rxDone);
+    }
+    if (rxBuf == nullptr || complete)
+        return;
+
+    if (rejecting && header.msgId == rxMsgId)
+        return;
+    // sent again because its last acknowledgement got lost, already delivered
+    if (!assembling && lastValid && header.msgId == lastMsgId)
+        return;
+    if (!assembling || header.msgId != rxMsgId)
+    {
+        // a new message supersedes the incomplete one
+        if (assembling)
+            numDropped++;
+        assembling = false;
+        rejecting = header.totalLen > rxSize;
+        rxMsgId = header.msgId;
+        if (rejecting)
+        {
+            numDropped++;
+            return;
+        }
+        rxCount = header.count;
+        rxLen = header.totalLen;
+        rxReceived = 0;
+        memset(rxMap, 0, sizeof(rxMap));
+        assembling = true;
+    }
+    if (header.count != rxCount || header.totalLen != rxLen)
+        return;
+
+    bit = 1 << (header.index & 7);
+    if (rxMap[header.index >> 3] & bit)
+        return;
+    rxMap[header.index >> 3] |= bit;
+    memcpy(&rxBuf[(size_t)header.index * UWBInbandFragment::payloadSize],
+           &frame[UWBInbandFragment::headerSize], header.payloadLen());
+
+    if (++rxReceived == rxCount)
+    {
+        lastMsgId = rxMsgId;
+        lastCount = rxCount;
+        lastValid = true;
+        assembling = false;
+        complete = true;
+        xSemaphoreGive(rxDone);
+    }
+}
+
+void UWBInBandDataRx::receiveHandler(void* data)
+{
+    uwb::DataPacket* packet = (uwb::DataPacket*)data;
+
+    for (int i = 0; i < maxReceivers; ++i)
+    {
+        UWBInBandDataRx* rx = receivers[i];
+        if (rx != nullptr && rx->sessionHdl == packet->session_handle)
+        {
+            rx->fragment(packet->data, packet->data_size);
+            return;
+        }
+    }
+}
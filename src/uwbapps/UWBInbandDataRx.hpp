@@ -4,62 +4,108 @@
 #ifndef UWBINBANDDATARX_HPP
 #define UWBINBANDDATARX_HPP
 
-extern "C" {
-    extern void *dataRcvNtfSemTx;
-    extern uint8_t dataReceived[];
-};
-
-
 #include "UWB.hpp"
 #include "UWBSession.hpp"
 #include "UWBMacAddress.hpp"
+#include "UWBInbandFragment.hpp"
+#include "Arduino_FreeRTOS.h"
 
 /*
 * This class will setup a ranging session with in-band data reception capabilities.
-* When the data is received it will be signaled in the userCallback by receiving a
-* notification of type DataReceived.
+* Single frames are signaled in the callback registered with 
+* UWB.registerDataRxCallback(); messages sent with UWBInBandDataTx::sendMessage()
+* are reassembled by receive() into a buffer of the caller. To read the
+* frames as a continuous byte stream use a UWBInBandStream on the session.
+*
+* With enableAcks() the receiver answers the fragments asking for it with
+* a selective acknowledgement (UWBInbandAck), sent back on the same
+* session: UWBInBandDataTx::sendReliable() then retransmits only the
+* fragments missing.
 */
 
 class UWBInBandDataRx : public UWBSession {
 public:   
     UWBInBandDataRx(uint32_t session_ID, UWBMacAddress srcAddr, 
-                    UWBMacAddress dstAddr, uint32_t dataBlocks = 12)
-        : destination(dstAddr) 
-    {
-        sessionID(session_ID);
-        sessionType(uwb::SessionType::RANGING_WITH_DATA_TRANSFER);
-        
-        // Set ranging parameters using HAL types
-        rangingParams.setDeviceRole(uwb::DeviceRole::RESPONDER);
-        rangingParams.setDeviceType(uwb::DeviceType::CONTROLEE);
-        rangingParams.setMultiNodeMode(uwb::MultiNodeMode::UNICAST);
-        rangingParams.setRangingRoundUsage(uwb::RangingRoundUsage::DS_TWR);
-        rangingParams.setScheduleMode(uwb::ScheduleMode::TIME_SCHEDULED);
-        rangingParams.setDeviceMacAddr(srcAddr);
+                    UWBMacAddress dstAddr, uint32_t dataBlocks = 12);
+    ~UWBInBandDataRx();
+
+    /**
+     * @brief acknowledge the messages sent with UWBInBandDataTx::sendReliable()
+     * 
+     * Call it before init(), the session also gets transmit blocks.
+     * 
+     * @param ackBlocks in-band transmit blocks for the acknowledgements
+     */
+    void enableAcks(uint32_t ackBlocks = 2);
+
+    /**
+     * @brief send the acknowledgement requested by the sender, if any
+     * 
+     * receive() calls it while waiting. Between two receive() call it from
+     * loop(), the last message may still be asked for when its final
+     * acknowledgement got lost.
+     * 
+     * @return uwb::Status 
+     */
+    uwb::Status update();
 
-        // Set app parameters
-        appParams.addOrUpdateParam(AppConfigId::NO_OF_CONTROLEES, 
-                                    AppParamType::U32, 1);
-        appParams.setDstMacAddr(dstAddr);
-        setDefaults();
+    /**
+     * @brief wait for a complete message, blocking
+     * 
+     * The fragments are copied straight into buf as they arrive, in any 
+     * order; duplicates are ignored. Fragments received while nobody waits 
+     * in receive() are dropped, as the messages that do not fit the buffer.
+     * Must not be called from a notification handler.
+     * 
+     * @param buf destination of the message
+     * @param size size of buf
+     * @param len length of the message received
+     * @param timeout milliseconds
+     * @return uwb::Status::SUCCESS 
+     * @return uwb::Status::TIMEOUT if no complete message arrived in time
+     * @return uwb::Status::REJECTED if another task is already receiving on the session
+     */
+    uwb::Status receive(uint8_t* buf, size_t size, size_t& len, uint32_t timeout);
 
-        // Link layer and frame config
-        appParams.addOrUpdateParam(AppConfigId::LINK_LAYER_MODE, 
-                                    AppParamType::U32, 
-                                    static_cast<uint32_t>(uwb::LinkLayerMode::BYPASS));
-        appParams.addOrUpdateParam(AppConfigId::RFRAME_CONFIG, 
-                                    AppParamType::U32,
-                                    static_cast<uint32_t>(uwb::RFrameConfig::SP1));
+    /**
+     * @brief messages dropped: incomplete, superseded or too long for the buffer
+     */
+    uint32_t dropped();
 
-        // Vendor specific data transfer parameters
-        vendorParams.addOrUpdateParam(VendorAppConfigId::SESSION_INBAND_DATA_TX_BLOCKS, 
-                                       AppParamType::U32, 0);
-        vendorParams.addOrUpdateParam(VendorAppConfigId::SESSION_INBAND_DATA_RX_BLOCKS, 
-                                       AppParamType::U32, dataBlocks);
-    }
+    static const int maxReceivers = 4;
 
 private:
-    UWBMacAddress destination;
+    bool attach();
+    void fragment(const uint8_t* frame, size_t len);
+    static void receiveHandler(void* data);
+
+    UWBMacAddress peer;
+
+    // reassembly state, written by the notification handler
+    uint8_t* volatile rxBuf;    // not nullptr while receive() waits
+    size_t rxSize;
+    volatile bool assembling;
+    bool rejecting;             // rxMsgId does not fit the buffer
+    uint8_t rxMsgId;
+    uint8_t rxCount;
+    uint8_t rxReceived;
+    uint16_t rxLen;
+    uint8_t rxMap[32];          // one bit per fragment
+    volatile bool complete;
+    uint32_t numDropped;
+
+    // acknowledgements
+    bool acking;
+    volatile bool ackPending;
+    uint8_t ackMsgId;
+    uint8_t ackPoll;            // fragment that asked for the acknowledgement
+    uint16_t ackSeq;
+    bool lastValid;             // lastMsgId was received completely
+    uint8_t lastMsgId;
+    uint8_t lastCount;
+
+    SemaphoreHandle_t rxDone;
+    static UWBInBandDataRx* receivers[maxReceivers];
 };
 
 #endif /* UWBINBANDDATARX */
@@ -0,0 +1,585 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBInbandDataTx.hpp"
+#include "UWBNotification.hpp"
+
+UWBInBandDataTx* UWBInBandDataTx::senders[maxSenders] = {nullptr};
+
+UWBInBandDataTx::UWBInBandDataTx(uint32_t session_ID, UWBMacAddress srcAddr,
+                                 UWBMacAddress dstAddr, uint32_t dataBlocks)
+    : destination(dstAddr), sequence_number(0)
+{
+    UWBMacAddressList peer(dstAddr.getSize() == UWBMacAddress::SHORT ? UWBMacAddress::Size::SHORT : UWBMacAddress::Size::LONG);
+    uwb::AppParamValue value;
+
+    msgId = 0;
+    numRetransmissions = 0;
+    txEvent = NULL;
+    lastConfirm = 0;
+    txCount = 0;
+    acking = false;
+    relActive = false;
+    ackArrived = false;
+    srtt = 0;
+    rttvar = 0;
+    curRto = window + minRto;
+    lastGoodput = 0;
+    for (int i = 0; i < window; ++i)
+        slots[i].state = FREE;
+
+    sessionID(session_ID);
+    sessionType(uwb::SessionType::RANGING_WITH_DATA);
+
+    rangingParams.deviceRole(uwb::DeviceRole::INITIATOR);
+    rangingParams.deviceType(uwb::DeviceType::CONTROLLER);
+    rangingParams.multiNodeMode(uwb::MultiNodeMode::UNICAST);
+    rangingParams.rangingRoundUsage(uwb::RangingMethod::DS_TWR);
+    rangingParams.scheduledMode(uwb::ScheduledMode::TIME_SCHEDULED);
+    rangingParams.deviceMacAddr(srcAddr);
+
+    peer.add(dstAddr);
+    controlees(peer);
+    // link layer bypass, frames with payload
+    appParams.addOrUpdateParam(buildScalar(uwb::AppConfigId::LinkMode, 0));
+    appParams.frameConfig(uwb::RfFrameConfig::SP1);
+    appParams.slotPerRR(25);
+    appParams.rangingDuration(200);
+    appParams.stsConfig(uwb::StsConfig::StaticSts);
+    appParams.sfdId(2);
+    appParams.preambleCodeIndex(10);
+
+    // vendor specific data transfer parameters
+    value.vu32 = dataBlocks;
+    vendorParams.addOrUpdateParam(uwb::VendorAppConfigId::SESSION_INBAND_DATA_TX_BLOCKS, uwb::AppParamType::U32, value);
+    value.vu32 = 0;
+    vendorParams.addOrUpdateParam(uwb::VendorAppConfigId::SESSION_INBAND_DATA_RX_BLOCKS, uwb::AppParamType::U32, value);
+}
+
+UWBInBandDataTx::~UWBInBandDataTx()
+{
+    for (int i = 0; i < maxSenders; ++i)
+    {
+        if (senders[i] == this)
+            senders[i] = nullptr;
+    }
+    // the handlers no longer find the session
+    if (txEvent != NULL)
+        vSemaphoreDelete(txEvent);
+}
+
+uwb::Status UWBInBandDataTx::sendData(uint8_t data[], uint16_t data_size)
+{
+    uwb::Status status = sendFrame(data, data_size, sequence_number);
+
+    if (status == uwb::Status::SUCCESS)
+        sequence_number++;
+    return status;
+}
+
+uwb::Status UWBInBandDataTx::sendFrame(uint8_t* data, uint16_t data_size, uint16_t seq)
+{
+    uwb::DataPacket packet;
+
+    if (data_size > uwb::MAX_APP_DATA_SIZE)
+        return uwb::Status::INVALID_RANGE;
+    packet.session_handle = sessionHdl;
+    memcpy(packet.mac_address, destination.getData(), destination.getSize());
+    packet.data = data;
+    packet.data_size = data_size;
+    packet.sequence_number = seq;
+
+    uwb::Status status = UWBHAL.sendData(packet);
+    if (status != uwb::Status::SUCCESS) {
+        UWBHAL.Log_E("Failed to send data");
+    }
+    return status;
+}
+
+bool UWBInBandDataTx::attach()
+{
+    int free = -1;
+
+    if (txEvent == NULL)
+    {
+        txEvent = xSemaphoreCreateBinary();
+        if (txEvent == NULL)
+            return false;
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::DATA_TRANSMIT_NTF, transmitHandler);
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::DATA_RCV_NTF, ackHandler);
+    }
+    for (int i = 0; i < maxSenders; ++i)
+    {
+        if (senders[i] == this)
+            return true;
+        if (senders[i] == nullptr && free < 0)
+            free = i;
+    }
+    if (free < 0)
+        return false;
+    senders[free] = this;
+    return true;
+}
+
+uint32_t UWBInBandDataTx::roundMs()
+{
+    uwb::AppConfig* interval = appParams.findParam(uwb::AppConfigId::RangingDuration);
+
+    return interval != nullptr && interval->param_value.vu32 != 0 ? interval->param_value.vu32 : 200;
+}
+
+uint32_t UWBInBandDataTx::confirmWait()
+{
+    return 2 * roundMs() + 50;
+}
+
+uwb::Status UWBInBandDataTx::transmit(Slot& slot)
+{
+    uwb::Status status;
+
+    slot.order = txCount++;
+    slot.sentAt = millis();
+    slot.state = SENT;
+    status = sendFrame(slot.data, slot.len, slot.seq);
+    if (status != uwb::Status::SUCCESS)
+        slot.state = FAILED;
+    return status;
+}
+
+uwb::Status UWBInBandDataTx::service()
+{
+    uwb::Status status = uwb::Status::SUCCESS;
+    uint32_t wait = confirmWait();
+
+    for (int i = 0; i < window; ++i)
+    {
+        Slot& slot = slots[i];
+        // a queued frame waits for the ones before it: count from the
+        // last confirmation if it came after the frame was sent
+        uint32_t since = (int32_t)(lastConfirm - slot.sentAt) > 0 ? lastConfirm : slot.sentAt;
+
+        if (slot.state == CONFIRMED)
+        {
+            slot.state = FREE;
+        }
+        else if (slot.state == FAILED || (slot.state == SENT && millis() - since > wait))
+        {
+            if (slot.retries >= maxRetries)
+            {
+                UWBHAL.Log_E("in-band frame %d dropped after %d retries", slot.seq, slot.retries);
+                slot.state = FREE;
+                status = uwb::Status::FAILED;
+                continue;
+            }
+            slot.retries++;
+            numRetransmissions++;
+            transmit(slot);
+        }
+    }
+    return status;
+}
+
+UWBInBandDataTx::Slot* UWBInBandDataTx::claim(uint32_t timeout, uwb::Status& status)
+{
+    uint32_t start = millis();
+    uint32_t elapsed, wait;
+
+    status = uwb::Status::SUCCESS;
+    if (!attach())
+    {
+        status = uwb::Status::FAILED;
+        return nullptr;
+    }
+
+    for (;;)
+    {
+        if (service() != uwb::Status::SUCCESS)
+            status = uwb::Status::FAILED;
+        for (int i = 0; i < window; ++i)
+        {
+            if (slots[i].state == FREE)
+            {
+                slots[i].state = ACQUIRED;
+                slots[i].retries = 0;
+                return &slots[i];
+            }
+        }
+        // back-pressure: wait for a confirmation to free a credit
+        elapsed = millis() - start;
+        if (elapsed >= timeout)
+        {
+            status = uwb::Status::TIMEOUT;
+            return nullptr;
+        }
+        // wake up at least once per confirmation period to retransmit
+        wait = timeout - elapsed < confirmWait() ? timeout - elapsed : confirmWait();
+        xSemaphoreTake(txEvent, pdMS_TO_TICKS(wait));
+    }
+}
+
+UWBInBandDataTx::Slot* UWBInBandDataTx::slotOf(uint8_t* buffer)
+{
+    for (int i = 0; i < window; ++i)
+    {
+        if (slots[i].data == buffer && slots[i].state == ACQUIRED)
+            return &slots[i];
+    }
+    return nullptr;
+}
+
+uint8_t* UWBInBandDataTx::acquire(uint32_t timeout)
+{
+    uwb::Status status;
+    Slot* slot = claim(timeout, status);
+
+    if (slot == nullptr)
+        return nullptr;
+    if (status != uwb::Status::SUCCESS)
+        UWBHAL.Log_W("in-band frames dropped while waiting for a buffer");
+    return slot->data;
+}
+
+uwb::Status UWBInBandDataTx::send(uint8_t* buffer, uint16_t len)
+{
+    Slot* slot = slotOf(buffer);
+
+    if (slot == nullptr)
+        return uwb::Status::INVALID_PARAM;
+    if (len > uwb::MAX_APP_DATA_SIZE)
+        return uwb::Status::INVALID_RANGE;
+    slot->len = len;
+    // retransmissions keep the sequence number, receivers drop the copies
+    slot->seq = sequence_number++;
+    // a frame refused by the UWBS is retried by service() like a failed one
+    transmit(*slot);
+    return uwb::Status::SUCCESS;
+}
+
+void UWBInBandDataTx::release(uint8_t* buffer)
+{
+    Slot* slot = slotOf(buffer);
+
+    if (slot != nullptr)
+        slot->state = FREE;
+}
+
+uwb::Status UWBInBandDataTx::queueData(const uint8_t* data, uint16_t len, uint32_t timeout)
+{
+    uwb::Status status;
+    Slot* slot;
+
+    if (len > uwb::MAX_APP_DATA_SIZE)
+        return uwb::Status::INVALID_RANGE;
+    slot = claim(timeout, status);
+    if (slot == nullptr)
+        return status;
+    memcpy(slot->data, data, len);
+    send(slot->data, len);
+    return status;
+}
+
+uwb::Status UWBInBandDataTx::flush(uint32_t timeout)
+{
+    uint32_t start = millis();
+    uwb::Status status = uwb::Status::SUCCESS;
+    uint32_t elapsed, wait;
+
+    for (;;)
+    {
+        if (service() != uwb::Status::SUCCESS)
+            status = uwb::Status::FAILED;
+        if (inFlight() == 0)
+            return status;
+        elapsed = millis() - start;
+        if (elapsed >= timeout)
+            return uwb::Status::TIMEOUT;
+        // wake up at least once per confirmation period to retransmit
+        wait = timeout - elapsed < confirmWait() ? timeout - elapsed : confirmWait();
+        xSemaphoreTake(txEvent, pdMS_TO_TICKS(wait));
+    }
+}
+
+uint8_t UWBInBandDataTx::inFlight()
+{
+    uint8_t n = 0;
+
+    for (int i = 0; i < window; ++i)
+    {
+        if (slots[i].state == SENT || slots[i].state == FAILED)
+            n++;
+    }
+    return n;
+}
+
+void UWBInBandDataTx::destinationAddr(const UWBMacAddress& addr)
+{
+    destination = addr;
+}
+
+uwb::Status UWBInBandDataTx::sendMessage(const uint8_t* msg, size_t len, uint32_t timeout)
+{
+    uwb::Status status = uwb::Status::SUCCESS;
+    uint32_t start = millis();
+    uint32_t elapsed;
+    UWBInbandFragment header;
+    Slot* slot;
+    size_t n;
+
+    if (len > UWBInbandFragment::maxMessageSize)
+        return uwb::Status::INVALID_RANGE;
+
+    header.msgId = msgId;
+    header.ackRequest = false;
+    msgId = (msgId + 1) & UWBInbandFragment::idMask;
+    header.count = UWBInbandFragment::fragments(len);
+    header.totalLen = len;
+    for (header.index = 0; header.index < header.count && status == uwb::Status::SUCCESS; header.index++)
+    {
+        elapsed = millis() - start;
+        if (elapsed >= timeout)
+        {
+            status = uwb::Status::TIMEOUT;
+            break;
+        }
+        slot = claim(timeout - elapsed, status);
+        if (slot == nullptr)
+            break;
+        // the fragment is built in place in the pool buffer
+        n = header.payloadLen();
+        header.write(slot->data);
+        memcpy(&slot->data[UWBInbandFragment::headerSize], &msg[(size_t)header.index * UWBInbandFragment::payloadSize], n);
+        send(slot->data, UWBInbandFragment::headerSize + n);
+    }
+    if (status == uwb::Status::SUCCESS)
+    {
+        elapsed = millis() - start;
+        status = elapsed < timeout ? flush(timeout - elapsed) : uwb::Status::TIMEOUT;
+    }
+
+    if (status != uwb::Status::SUCCESS)
+        UWBHAL.Log_E("message %d stopped at fragment %d/%d: %d", header.msgId, header.index, header.count, status);
+    return status;
+}
+
+void UWBInBandDataTx::enableAcks(uint32_t ackBlocks)
+{
+    uwb::AppParamValue value;
+
+    value.vu32 = ackBlocks;
+    vendorParams.addOrUpdateParam(uwb::VendorAppConfigId::SESSION_INBAND_DATA_RX_BLOCKS, uwb::AppParamType::U32, value);
+    acking = true;
+}
+
+uwb::Status UWBInBandDataTx::sendReliable(const uint8_t* msg, size_t len, uint32_t timeout)
+{
+    uwb::Status status = uwb::Status::SUCCESS;
+    uint32_t start = millis();
+    uint32_t elapsed, wait, pollAt = 0;
+    uint8_t polled[32];
+    UWBInbandFragment header;
+    Slot* slot = nullptr;
+    bool done = false;
+    bool fresh = false;
+    int last;
+
+    if (!acking)
+        return uwb::Status::REJECTED;
+    if (len > UWBInbandFragment::maxMessageSize)
+        return uwb::Status::INVALID_RANGE;
+    if (!attach())
+        return uwb::Status::FAILED;
+
+    header.msgId = msgId;
+    msgId = (msgId + 1) & UWBInbandFragment::idMask;
+    header.count = UWBInbandFragment::fragments(len);
+    header.totalLen = len;
+    memset(acked, 0, sizeof(acked));
+    memset(polled, 0, sizeof(polled));
+    relCount = header.count;
+    relMsgId = header.msgId;
+    relActive = true;
+
+    while (!done && status == uwb::Status::SUCCESS)
+    {
+        // a burst of the fragments not acknowledged yet, the last one polls
+        last = -1;
+        for (int i = 0; i < header.count; ++i)
+        {
+            if (!(acked[i >> 3] & (1 << (i & 7))))
+                last = i;
+        }
+        for (int i = 0; i <= last && status == uwb::Status::SUCCESS; ++i)
+        {
+            if (acked[i >> 3] & (1 << (i & 7)))
+                continue;
+            elapsed = millis() - start;
+            if (elapsed >= timeout)
+            {
+                status = uwb::Status::TIMEOUT;
+                break;
+            }
+            // frames dropped by the link are recovered by the next burst
+            slot = claim(timeout - elapsed, status);
+            if (slot == nullptr)
+                break;
+            status = uwb::Status::SUCCESS;
+            header.index = i;
+            header.ackRequest = i == last;
+            header.write(slot->data);
+            memcpy(&slot->data[UWBInbandFragment::headerSize], &msg[(size_t)i * UWBInbandFragment::payloadSize],
+                   header.payloadLen());
+            if (header.ackRequest)
+            {
+                // Karn: no RTT sample from a fragment that polled before
+                fresh = !(polled[i >> 3] & (1 << (i & 7)));
+                polled[i >> 3] |= 1 << (i & 7);
+                ackArrived = false;
+                pollAt = millis();
+            }
+            send(slot->data, UWBInbandFragment::headerSize + header.payloadLen());
+        }
+        if (status != uwb::Status::SUCCESS)
+            break;
+
+        // wait for the acknowledgement of the poll
+        for (;;)
+        {
+            done = true;
+            for (int i = 0; i < header.count && done; ++i)
+                done = acked[i >> 3] & (1 << (i & 7));
+            if (ackArrived && ackPoll == last)
+            {
+                if (fresh)
+                    rttSample((float)(ackAt - pollAt) / roundMs());
+                break;
+            }
+            if (done)
+                break;
+            if (millis() - pollAt > (uint32_t)(curRto * roundMs()))
+            {
+                curRto = curRto * 2 > maxRto ? maxRto : curRto * 2;
+                break;
+            }
+            elapsed = millis() - start;
+            if (elapsed >= timeout)
+            {
+                status = uwb::Status::TIMEOUT;
+                break;
+            }
+            service();
+            wait = timeout - elapsed < confirmWait() ? timeout - elapsed : confirmWait();
+            xSemaphoreTake(txEvent, pdMS_TO_TICKS(wait));
+        }
+    }
+    relActive = false;
+
+    if (status == uwb::Status::SUCCESS)
+    {
+        elapsed = millis() - start;
+        lastGoodput = elapsed > 0 ? len * 1000.0f / elapsed : 0;
+    }
+    else
+    {
+        UWBHAL.Log_E("reliable message %d not acknowledged: %d", header.msgId, status);
+    }
+    return status;
+}
+
+void UWBInBandDataTx::rttSample(float rounds)
+{
+    float err;
+
+    // RFC 6298 estimator, in ranging rounds
+    if (srtt == 0)
+    {
+        srtt = rounds;
+        rttvar = rounds / 2;
+    }
+    else
+    {
+        err = srtt > rounds ? srtt - rounds : rounds - srtt;
+        rttvar = 0.75f * rttvar + 0.25f * err;
+        srtt = 0.875f * srtt + 0.125f * rounds;
+    }
+    curRto = srtt + 4 * rttvar;
+    if (curRto < minRto)
+        curRto = minRto;
+    if (curRto > maxRto)
+        curRto = maxRto;
+}
+
+float UWBInBandDataTx::rtt()
+{
+    return srtt;
+}
+
+float UWBInBandDataTx::rto()
+{
+    return curRto;
+}
+
+float UWBInBandDataTx::goodput()
+{
+    return lastGoodput;
+}
+
+uint32_t UWBInBandDataTx::retransmissions()
+{
+    return numRetransmissions;
+}
+
+void UWBInBandDataTx::transmitHandler(void* data)
+{
+    uwb::DataTransmit* ntf = (uwb::DataTransmit*)data;
+
+    for (int i = 0; i < maxSenders; ++i)
+    {
+        UWBInBandDataTx* tx = senders[i];
+        if (tx == nullptr || ntf->transmitNtf_sessionHandle != tx->sessionHdl)
+            continue;
+        Slot* done = nullptr;
+        for (int j = 0; j < window && done == nullptr; ++j)
+        {
+            if (tx->slots[j].state == SENT && tx->slots[j].seq == ntf->transmitNtf_sequence_number)
+                done = &tx->slots[j];
+        }
+        if (done != nullptr)
+        {
+            done->state = ntf->transmitNtf_status == 0 ? CONFIRMED : FAILED;
+            // frames go out in order, one handed over before it and still waiting was lost
+            for (int j = 0; j < window; ++j)
+            {
+                Slot& slot = tx->slots[j];
+                if (slot.state == SENT && (int32_t)(slot.order - done->order) < 0)
+                    slot.state = FAILED;
+            }
+        }
+        tx->lastConfirm = millis();
+        xSemaphoreGive(tx->txEvent);
+        return;
+    }
+}
+
+void UWBInBandDataTx::ackHandler(void* data)
+{
+    uwb::DataPacket* packet = (uwb::DataPacket*)data;
+    UWBInbandAck ack;
+
+    if (!ack.read(packet->data, packet->data_size))
+        return;
+    for (int i = 0; i < maxSenders; ++i)
+    {
+        UWBInBandDataTx* tx = senders[i];
+        if (tx == nullptr || packet->session_handle != tx->sessionHdl)
+            continue;
+        if (!tx->relActive || ack.msgId != tx->relMsgId || ack.count != tx->relCount)
+            return;
+        for (size_t j = 0; j < sizeof(tx->acked); ++j)
+            tx->acked[j] |= ack.received[j];
+        tx->ackPoll = ack.pollIndex;
+        tx->ackAt = millis();
+        tx->ackArrived = true;
+        xSemaphoreGive(tx->txEvent);
+        return;
+    }
+}
@@ -4,71 +4,248 @@
 #ifndef UWBINBANDDATATX_HPP
 #define UWBINBANDDATATX_HPP
 
-extern "C" uint8_t dataToSend[];
-
-
 #include "UWB.hpp"
 #include "UWBSession.hpp"
 #include "UWBMacAddress.hpp"
+#include "UWBInbandFragment.hpp"
+#include "Arduino_FreeRTOS.h"
+
+// Frames handed to the UWBS and not confirmed yet, per session
+#ifndef UWB_INBAND_TX_WINDOW
+#define UWB_INBAND_TX_WINDOW 4
+#endif
+
+/*
+* This class will setup a ranging session with in-band data transmission capabilities.
+* sendData() sends one frame of at most uwb::MAX_APP_DATA_SIZE bytes, 
+* sendMessage() sends messages of any length to a UWBInBandDataRx, split in
+* fragments carried by successive ranging rounds.
+*
+* Frames are pipelined: up to UWB_INBAND_TX_WINDOW frames are handed to the
+* UWBS before the first one is confirmed. Each frame is matched to its 
+* DATA_TRANSMIT_NTF by sequence number; a confirmed frame frees its place
+* in the window, a failed or unconfirmed one is sent again with the same
+* sequence number, so receivers can drop the copies. When the window is
+* full the caller waits.
+*
+* The window is also the transmit buffer pool: acquire() lends one of its
+* buffers, the frame is written there and send() hands it to the UWBS
+* as is. The buffer is kept for retransmissions and returns to the pool
+* with the DATA_TRANSMIT_NTF confirming it.
+*
+* sendReliable() adds an end to end guarantee on top: the last fragment
+* of every burst asks the UWBInBandDataRx for a selective acknowledgement,
+* and the next burst carries only the fragments it is missing. The round
+* trip time of the peer is tracked in ranging rounds to time the bursts.
+*/
 
 class UWBInBandDataTx : public UWBSession {
 public: 
     UWBInBandDataTx(uint32_t session_ID, UWBMacAddress srcAddr, 
-                    UWBMacAddress dstAddr, uint32_t dataBlocks = 12)
-        : destination(dstAddr), sequence_number(0)
-    {
-        setSessionID(session_ID);
-        setSessionType(uwb::SessionType::RANGING_WITH_DATA_TRANSFER);
-        
-        // Set ranging parameters using HAL types
-        rangingParams.deviceRole(uwb::DeviceRole::INITIATOR);
-        rangingParams.deviceType(uwb::DeviceType::CONTROLLER);
-        rangingParams.multiNodeMode(uwb::MultiNodeMode::UNICAST);
-        rangingParams.rangingRoundUsage(uwb::RangingRoundUsage::DS_TWR);
-        rangingParams.scheduleMode(uwb::ScheduleMode::TIME_SCHEDULED);
-        rangingParams.deviceMacAddr(srcAddr);
-
-        // Set app parameters
-        appParams.addOrUpdateParam(AppConfigId::NO_OF_CONTROLEES, 
-                                    AppParamType::U32, 1);
-		appParams.dstMacAddr(dstAddr);
-        setDefaults();
-
-        // Link layer and frame config
-        appParams.addOrUpdateParam(AppConfigId::LINK_LAYER_MODE, 
-                                    AppParamType::U32, 
-                                    static_cast<uint32_t>(uwb::LinkLayerMode::BYPASS));
-									appParams.addOrUpdateParam(AppConfigId::RFRAME_CONFIG, 
-                                    AppParamType::U32,
-                                    static_cast<uint32_t>(uwb::RFrameConfig::SP1));
-
-        // Vendor specific data transfer parameters
-        vendorParams.addOrUpdateParam(VendorAppConfigId::SESSION_INBAND_DATA_TX_BLOCKS, 
-                                       AppParamType::U32, dataBlocks);
-        vendorParams.addOrUpdateParam(VendorAppConfigId::SESSION_INBAND_DATA_RX_BLOCKS, 
-                                       AppParamType::U32, 0);
-    }
-
-    uwb::Status sendData(uint8_t data[], uint16_t data_size) {
-        uwb::DataPacket packet;
-        packet.session_handle = sessionHdl;
-        memcpy(packet.mac_address, destination.getData(), destination.getSize());
-        packet.data = data;
-        packet.data_size = data_size;
-        packet.sequence_number = sequence_number;
-
-        uwb::Status status = UWBHAL.sendData(packet);
-        if (status != uwb::Status::SUCCESS) {
-            UWBHAL.Log_E("Failed to send data");
-        } else {
-            sequence_number++;
-        }
-        return status;
-    }
+                    UWBMacAddress dstAddr, uint32_t dataBlocks = 12);
+    ~UWBInBandDataTx();
+
+    /**
+     * @brief send a single in-band frame
+     * 
+     * @param data 
+     * @param data_size at most uwb::MAX_APP_DATA_SIZE
+     * @return uwb::Status 
+     */
+    uwb::Status sendData(uint8_t data[], uint16_t data_size);
+
+    /**
+     * @brief take a buffer of the transmit pool to build a frame in place
+     * 
+     * The buffer holds uwb::MAX_APP_DATA_SIZE bytes and belongs to the
+     * caller until it is passed to send() or release(). Blocks while every
+     * buffer of the pool is in flight. Must not be called from a
+     * notification handler.
+     * 
+     * @param timeout milliseconds to wait for a free buffer
+     * @return uint8_t* nullptr on timeout
+     */
+    uint8_t* acquire(uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
+    /**
+     * @brief send a buffer returned by acquire(), without copying it
+     * 
+     * The buffer passes to the UWBS and comes back to the pool when its
+     * transmission is confirmed: do not touch it after the call.
+     * 
+     * @param buffer 
+     * @param len at most uwb::MAX_APP_DATA_SIZE
+     * @return uwb::Status::SUCCESS once the frame is in the transmit window
+     * @return uwb::Status::INVALID_PARAM if the buffer was not acquired
+     */
+    uwb::Status send(uint8_t* buffer, uint16_t len);
+
+    /**
+     * @brief give back a buffer returned by acquire() without sending it
+     */
+    void release(uint8_t* buffer);
+
+    /**
+     * @brief copy a frame in the transmit pool and send it
+     * 
+     * The frame is copied, the call returns as soon as it is handed to the 
+     * UWBS. It blocks while the window is full, retransmitting the frames 
+     * that failed. Must not be called from a notification handler, nor by
+     * two tasks at once.
+     * 
+     * @param data 
+     * @param len at most uwb::MAX_APP_DATA_SIZE
+     * @param timeout milliseconds to wait for room in the window
+     * @return uwb::Status::SUCCESS 
+     * @return uwb::Status::TIMEOUT if the window stayed full
+     * @return uwb::Status::FAILED if a frame of the window failed maxRetries times
+     */
+    uwb::Status queueData(const uint8_t* data, uint16_t len, uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
+    /**
+     * @brief wait until every queued frame is confirmed
+     * 
+     * @param timeout milliseconds
+     * @return uwb::Status::SUCCESS 
+     * @return uwb::Status::TIMEOUT 
+     * @return uwb::Status::FAILED if a frame failed maxRetries times, it is dropped
+     */
+    uwb::Status flush(uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
+    /**
+     * @brief frames handed to the UWBS and not confirmed yet
+     */
+    uint8_t inFlight();
+
+    /**
+     * @brief change the peer the next frames are sent to
+     * 
+     * Call it while no frame is in flight, e.g. after flush().
+     */
+    void destinationAddr(const UWBMacAddress& addr);
+
+    /**
+     * @brief send a message of any length, blocking
+     * 
+     * The message is split in fragments of UWBInbandFragment::payloadSize 
+     * bytes, queued in the transmit window. Must not be called from a 
+     * notification handler.
+     * 
+     * @param msg 
+     * @param len at most UWBInbandFragment::maxMessageSize
+     * @param timeout milliseconds for the whole message
+     * @return uwb::Status::SUCCESS once all the fragments were transmitted
+     * @return uwb::Status::TIMEOUT 
+     * @return uwb::Status::INVALID_RANGE if the message is too long
+     */
+    uwb::Status sendMessage(const uint8_t* msg, size_t len, uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
+    /**
+     * @brief receive the acknowledgements of sendReliable()
+     * 
+     * Call it before init(), the session also gets receive blocks. The
+     * receiver must call UWBInBandDataRx::enableAcks().
+     * 
+     * @param ackBlocks in-band receive blocks for the acknowledgements
+     */
+    void enableAcks(uint32_t ackBlocks = 2);
+
+    /**
+     * @brief send a message and wait until the receiver has all of it
+     * 
+     * Fragments are sent in bursts, each one ending with an acknowledgement
+     * request. The missing fragments are sent again when the acknowledgement
+     * arrives, or all the pending ones if it does not arrive within the
+     * retransmission timeout. Must not be called from a notification handler.
+     * 
+     * @param msg 
+     * @param len at most UWBInbandFragment::maxMessageSize
+     * @param timeout milliseconds for the whole message
+     * @return uwb::Status::SUCCESS once every fragment was acknowledged
+     * @return uwb::Status::TIMEOUT 
+     * @return uwb::Status::REJECTED if enableAcks() was not called
+     * @return uwb::Status::INVALID_RANGE if the message is too long
+     */
+    uwb::Status sendReliable(const uint8_t* msg, size_t len, uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
+    /**
+     * @brief smoothed round trip time to the peer, in ranging rounds
+     * 
+     * @return float 0 until the first acknowledgement
+     */
+    float rtt();
+
+    /**
+     * @brief current retransmission timeout of sendReliable(), in ranging rounds
+     */
+    float rto();
+
+    /**
+     * @brief message bytes per second of the last sendReliable()
+     */
+    float goodput();
+
+    /**
+     * @brief fragments sent again because their transmission was not confirmed
+     */
+    uint32_t retransmissions();
+
+    static const uint8_t maxRetries = 3;
+    static const uint8_t window = UWB_INBAND_TX_WINDOW;
+    static const int maxSenders = 4;
+    static constexpr float minRto = 2.0f;       // ranging rounds
+    static constexpr float maxRto = 64.0f;
 
 private:
-    uint16_t sequence_number;
+    enum SlotState : uint8_t { FREE, ACQUIRED, SENT, CONFIRMED, FAILED };
+
+    struct Slot {
+        volatile uint8_t state;
+        uint16_t seq;
+        uint32_t order;         // transmission order, retransmissions included
+        uint8_t len;
+        uint8_t retries;
+        uint32_t sentAt;
+        uint8_t data[uwb::MAX_APP_DATA_SIZE];
+    };
+
+    bool attach();
+    Slot* claim(uint32_t timeout, uwb::Status& status);
+    Slot* slotOf(uint8_t* buffer);
+    uwb::Status sendFrame(uint8_t* data, uint16_t data_size, uint16_t seq);
+    uwb::Status transmit(Slot& slot);
+    uwb::Status service();
+    uint32_t roundMs();
+    uint32_t confirmWait();
+    void rttSample(float rounds);
+    static void transmitHandler(void* data);
+    static void ackHandler(void* data);
+
     UWBMacAddress destination;
+    uint16_t sequence_number;
+    uint8_t msgId;
+    uint32_t numRetransmissions;
+    uint32_t txCount;
+
+    Slot slots[window];
+    SemaphoreHandle_t txEvent;      // given on every transmit notification of the session
+    volatile uint32_t lastConfirm;  // millis() of the last transmit notification
+
+    // reliable mode, the acknowledgement is written by the notification handler
+    bool acking;
+    volatile bool relActive;
+    uint8_t relMsgId;
+    uint8_t relCount;
+    uint8_t acked[32];          // one bit per fragment
+    volatile bool ackArrived;
+    volatile uint8_t ackPoll;
+    volatile uint32_t ackAt;
+    float srtt;                 // ranging rounds
+    float rttvar;
+    float curRto;
+    float lastGoodput;
+
+    static UWBInBandDataTx* senders[maxSenders];
 };
 
 #endif /* UWBINBANDDATATX */
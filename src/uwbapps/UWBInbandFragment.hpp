@@ -0,0 +1,151 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBINBANDFRAGMENT_HPP
+#define UWBINBANDFRAGMENT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include "hal/uwb_types.hpp"
+
+/**
+ * @brief header of the fragments of an in-band data message
+ *
+ * Every in-band frame starts with 5 bytes:
+ *
+ * | offset | size | field                                     |
+ * |--------|------|-------------------------------------------|
+ * | 0      | 1    | bit 7: acknowledgement requested          |
+ * |        |      | bits 0-6: message ID, wraps around        |
+ * | 1      | 1    | fragment index                            |
+ * | 2      | 1    | number of fragments of the message        |
+ * | 3      | 2    | total message length, little endian       |
+ *
+ * followed by up to payloadSize bytes of the message.
+ *
+ */
+struct UWBInbandFragment {
+    static const uint8_t headerSize = 5;
+    static const uint8_t payloadSize = uwb::MAX_APP_DATA_SIZE - headerSize;
+    static const size_t maxMessageSize = (size_t)0xFF * payloadSize;
+    static const uint8_t idMask = 0x7F;
+    static const uint8_t ackRequestFlag = 0x80;
+
+    uint8_t msgId;
+    bool ackRequest;            // the receiver answers with a UWBInbandAck
+    uint8_t index;
+    uint8_t count;
+    uint16_t totalLen;
+
+    /**
+     * @brief number of fragments needed by a message
+     */
+    static uint8_t fragments(size_t len)
+    {
+        return len == 0 ? 1 : (uint8_t)((len + payloadSize - 1) / payloadSize);
+    }
+
+    void write(uint8_t* frame) const
+    {
+        frame[0] = (msgId & idMask) | (ackRequest ? ackRequestFlag : 0);
+        frame[1] = index;
+        frame[2] = count;
+        frame[3] = totalLen & 0xFF;
+        frame[4] = totalLen >> 8;
+    }
+
+    /**
+     * @brief decode and check a received frame
+     *
+     * @return false if the frame is not a valid fragment
+     */
+    bool read(const uint8_t* frame, size_t len)
+    {
+        if (len < headerSize)
+            return false;
+        msgId = frame[0] & idMask;
+        ackRequest = (frame[0] & ackRequestFlag) != 0;
+        index = frame[1];
+        count = frame[2];
+        totalLen = frame[3] | (frame[4] << 8);
+        return count != 0 && index < count && fragments(totalLen) == count &&
+               len - headerSize == payloadLen();
+    }
+
+    /**
+     * @brief payload bytes carried by this fragment
+     */
+    size_t payloadLen() const
+    {
+        if (index + 1 < count)
+            return payloadSize;
+        return totalLen - (size_t)index * payloadSize;
+    }
+};
+
+/**
+ * @brief selective acknowledgement of a message, sent back by the receiver
+ *
+ * | offset | size | field                                     |
+ * |--------|------|-------------------------------------------|
+ * | 0      | 1    | message ID                                |
+ * | 1      | 1    | 0xFF, never a fragment index              |
+ * | 2      | 1    | number of fragments of the message        |
+ * | 3      | 1    | index of the fragment that asked for it   |
+ * | 4      | n    | one bit per fragment received, LSB first  |
+ *
+ */
+struct UWBInbandAck {
+    static const uint8_t marker = 0xFF;
+    static const uint8_t headerSize = 4;
+
+    uint8_t msgId;
+    uint8_t count;
+    uint8_t pollIndex;
+    uint8_t received[32];
+
+    /**
+     * @brief size of the encoded acknowledgement
+     */
+    size_t size() const
+    {
+        return headerSize + (count + 7) / 8;
+    }
+
+    bool has(uint8_t index) const
+    {
+        return (received[index >> 3] >> (index & 7)) & 1;
+    }
+
+    size_t write(uint8_t* frame) const
+    {
+        frame[0] = msgId & UWBInbandFragment::idMask;
+        frame[1] = marker;
+        frame[2] = count;
+        frame[3] = pollIndex;
+        memcpy(&frame[headerSize], received, (count + 7) / 8);
+        return size();
+    }
+
+    /**
+     * @brief decode a received frame
+     *
+     * @return false if the frame is not an acknowledgement
+     */
+    bool read(const uint8_t* frame, size_t len)
+    {
+        if (len < headerSize || frame[1] != marker || frame[2] == 0)
+            return false;
+        msgId = frame[0] & UWBInbandFragment::idMask;
+        count = frame[2];
+        pollIndex = frame[3];
+        if (len != size())
+            return false;
+        memset(received, 0, sizeof(received));
+        memcpy(received, &frame[headerSize], len - headerSize);
+        return true;
+    }
+};
+
+#endif /* UWBINBANDFRAGMENT_HPP */
@@ -0,0 +1,313 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBInbandStream.hpp"
+#include "UWBNotification.hpp"
+
+// a frame this far behind comes from a sender that started over
+static const int16_t resyncDistance = -128;
+
+UWBInBandStream* UWBInBandStream::streams[maxStreams] = {nullptr};
+
+UWBInBandStream::UWBInBandStream(UWBSession& session, uint32_t gapTimeout)
+    : sess(session), timeout(gapTimeout)
+{
+    lock = NULL;
+    head = 0;
+    tail = 0;
+    count = 0;
+    for (int i = 0; i < reorderSlots; ++i)
+        pending[i].used = false;
+    numPending = 0;
+    gapSince = 0;
+    synced = false;
+    nextSeq = 0;
+    numDuplicates = 0;
+    numGaps = 0;
+    numOverruns = 0;
+}
+
+UWBInBandStream::~UWBInBandStream()
+{
+    // the handlers no longer find the stream
+    end();
+    if (lock != NULL)
+        vSemaphoreDelete(lock);
+}
+
+bool UWBInBandStream::begin()
+{
+    int free = -1;
+
+    if (lock == NULL)
+    {
+        lock = xSemaphoreCreateMutex();
+        if (lock == NULL)
+            return false;
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::DATA_RCV_NTF, receiveHandler);
+    }
+    for (int i = 0; i < maxStreams; ++i)
+    {
+        if (streams[i] == this)
+            return true;
+        if (streams[i] == nullptr && free < 0)
+            free = i;
+    }
+    if (free < 0)
+    {
+        UWBHAL.Log_E("too many in-band streams");
+        return false;
+    }
+
+    head = tail = count = 0;
+    for (int i = 0; i < reorderSlots; ++i)
+        pending[i].used = false;
+    numPending = 0;
+    synced = false;
+    streams[free] = this;
+    return true;
+}
+
+void UWBInBandStream::end()
+{
+    for (int i = 0; i < maxStreams; ++i)
+    {
+        if (streams[i] == this)
+            streams[i] = nullptr;
+    }
+}
+
+int UWBInBandStream::available()
+{
+    int n;
+
+    if (lock == NULL)
+        return 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    checkGap();
+    n = count;
+    xSemaphoreGive(lock);
+    return n;
+}
+
+int UWBInBandStream::read()
+{
+    uint8_t c;
+
+    return read(&c, 1) == 1 ? c : -1;
+}
+
+int UWBInBandStream::peek()
+{
+    int c = -1;
+
+    if (lock == NULL)
+        return -1;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    checkGap();
+    if (count > 0)
+        c = ring[tail];
+    xSemaphoreGive(lock);
+    return c;
+}
+
+size_t UWBInBandStream::read(uint8_t* buf, size_t len)
+{
+    size_t n = 0;
+    size_t chunk;
+
+    if (lock == NULL)
+        return 0;
+    xSemaphoreTake(lock, portMAX_DELAY);
+    checkGap();
+    while (n < len && count > 0)
+    {
+        // up to the end of the ring or of the data
+        chunk = ringSize - tail;
+        if (chunk > count)
+            chunk = count;
+        if (chunk > len - n)
+            chunk = len - n;
+        memcpy(&buf[n], &ring[tail], chunk);
+        tail = (tail + chunk) % ringSize;
+        count -= chunk;
+        n += chunk;
+    }
+    xSemaphoreGive(lock);
+    return n;
+}
+
+size_t UWBInBandStream::write(uint8_t c)
+{
+    (void)c;
+    return 0;
+}
+
+uint32_t UWBInBandStream::duplicates()
+{
+    return numDuplicates;
+}
+
+uint32_t UWBInBandStream::gaps()
+{
+    return numGaps;
+}
+
+uint32_t UWBInBandStream::overruns()
+{
+    return numOverruns;
+}
+
+void UWBInBandStream::push(const uint8_t* data, uint16_t len)
+{
+    size_t chunk;
+
+    if (len > ringSize - count)
+    {
+        numOverruns++;
+        return;
+    }
+    count += len;
+    while (len > 0)
+    {
+        chunk = ringSize - head;
+        if (chunk > len)
+            chunk = len;
+        memcpy(&ring[head], data, chunk);
+        head = (head + chunk) % ringSize;
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+void UWBInBandStream::drain()
+{
+    bool found = true;
+
+    while (found && numPending > 0)
+    {
+        found = false;
+        for (int i = 0; i < reorderSlots && !found; ++i)
+        {
+            if (pending[i].used && pending[i].seq == nextSeq)
+            {
+                push(pending[i].data, pending[i].len);
+                pending[i].used = false;
+                numPending--;
+                nextSeq++;
+                found = true;
+            }
+        }
+    }
+    // the wait for the next missing frame starts now
+    gapSince = millis();
+}
+
+void UWBInBandStream::skipGap()
+{
+    int16_t d, first = INT16_MAX;
+
+    for (int i = 0; i < reorderSlots; ++i)
+    {
+        d = pending[i].seq - nextSeq;
+        if (pending[i].used && d < first)
+            first = d;
+    }
+    if (first == INT16_MAX)
+        return;
+    numGaps += first;
+    nextSeq += first;
+    drain();
+}
+
+void UWBInBandStream::checkGap()
+{
+    if (numPending > 0 && millis() - gapSince > timeout)
+        skipGap();
+}
+
+void UWBInBandStream::packet(const uwb::DataPacket& p)
+{
+    int16_t d;
+    int free;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    if (!synced || (int16_t)(p.sequence_number - nextSeq) < resyncDistance)
+    {
+        for (int i = 0; i < reorderSlots; ++i)
+            pending[i].used = false;
+        numPending = 0;
+        nextSeq = p.sequence_number;
+        synced = true;
+    }
+
+    for (;;)
+    {
+        d = p.sequence_number - nextSeq;
+        if (d < 0)
+        {
+            numDuplicates++;
+            break;
+        }
+        if (d == 0)
+        {
+            push(p.data, p.data_size);
+            nextSeq++;
+            drain();
+            break;
+        }
+
+        // ahead of a missing frame, hold it
+        free = -1;
+        for (int i = 0; i < reorderSlots; ++i)
+        {
+            if (pending[i].used && pending[i].seq == p.sequence_number)
+                free = -2;
+            else if (!pending[i].used && free == -1)
+                free = i;
+        }
+        if (free == -2)
+        {
+            numDuplicates++;
+            break;
+        }
+        if (free >= 0 && d <= reorderSlots)
+        {
+            pending[free].used = true;
+            pending[free].seq = p.sequence_number;
+            pending[free].len = p.data_size;
+            memcpy(pending[free].data, p.data, p.data_size);
+            if (numPending++ == 0)
+                gapSince = millis();
+            break;
+        }
+        // no room to wait any longer: give the missing frames up
+        if (numPending > 0)
+        {
+            skipGap();
+        }
+        else
+        {
+            numGaps += d;
+            nextSeq = p.sequence_number;
+        }
+    }
+    xSemaphoreGive(lock);
+}
+
+void UWBInBandStream::receiveHandler(void* data)
+{
+    uwb::DataPacket* p = (uwb::DataPacket*)data;
+
+    if (p->data_size > uwb::MAX_APP_DATA_SIZE)
+        return;
+    for (int i = 0; i < maxStreams; ++i)
+    {
+        UWBInBandStream* s = streams[i];
+        if (s != nullptr && s->sess.sessionHandle() == p->session_handle)
+        {
+            s->packet(*p);
+            return;
+        }
+    }
+}
@@ -0,0 +1,136 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBINBANDSTREAM_HPP
+#define UWBINBANDSTREAM_HPP
+
+#include <Arduino.h>
+#include "Arduino_FreeRTOS.h"
+#include "UWBSession.hpp"
+
+// Bytes buffered per stream
+#ifndef UWB_INBAND_STREAM_SIZE
+#define UWB_INBAND_STREAM_SIZE 1024
+#endif
+
+// Frames received ahead of a missing one, held until it arrives
+#ifndef UWB_INBAND_STREAM_REORDER
+#define UWB_INBAND_STREAM_REORDER 4
+#endif
+
+/**
+ * @brief in-band data of a session read as an Arduino Stream
+ *
+ * The payload of every DATA_RCV_NTF of the session is appended to a byte
+ * ring in sequence number order, read it with available(), read() and
+ * peek() or with the Stream helpers (readBytes(), parseInt(), ...).
+ *
+ * Frames received twice, e.g. retransmitted by UWBInBandDataTx after a
+ * lost confirmation, are dropped. Frames arriving ahead of a missing one
+ * are held until it arrives; the missing frames are skipped and counted
+ * as gaps when the reorder buffer is full or after gapTimeout. A frame
+ * that does not fit in the ring is dropped and counted as an overrun.
+ *
+ * The stream works on any session receiving in-band data, e.g. a
+ * UWBInBandDataRx or the data session of a UWBHusControlee. Do not read
+ * the same session with UWBInBandDataRx::receive(): the stream would see
+ * the fragment headers.
+ *
+ */
+class UWBInBandStream : public Stream {
+public:
+    static const int maxStreams = 4;
+    static const size_t ringSize = UWB_INBAND_STREAM_SIZE;
+    static const uint8_t reorderSlots = UWB_INBAND_STREAM_REORDER;
+
+    /**
+     * @brief Construct a new UWBInBandStream object
+     *
+     * @param session the receiving session, its handle is read on every frame
+     * @param gapTimeout milliseconds to wait for a missing frame
+     */
+    UWBInBandStream(UWBSession& session, uint32_t gapTimeout = 1000);
+    ~UWBInBandStream();
+
+    /**
+     * @brief start buffering the data of the session
+     *
+     * @return true
+     * @return false if too many streams are open
+     */
+    bool begin();
+
+    /**
+     * @brief stop buffering, the data not read yet is discarded
+     */
+    void end();
+
+    int available() override;
+    int read() override;
+    int peek() override;
+
+    /**
+     * @brief read up to len bytes without waiting
+     *
+     * @return size_t bytes read
+     */
+    size_t read(uint8_t* buf, size_t len);
+
+    /**
+     * @brief the stream is receive only, always 0
+     */
+    size_t write(uint8_t c) override;
+
+    /**
+     * @brief frames received more than once
+     */
+    uint32_t duplicates();
+
+    /**
+     * @brief frames never received, skipped in the stream
+     */
+    uint32_t gaps();
+
+    /**
+     * @brief frames dropped because the ring was full
+     */
+    uint32_t overruns();
+
+private:
+    struct Pending {
+        bool used;
+        uint16_t seq;
+        uint8_t len;
+        uint8_t data[uwb::MAX_APP_DATA_SIZE];
+    };
+
+    void packet(const uwb::DataPacket& p);
+    void push(const uint8_t* data, uint16_t len);
+    void drain();
+    void skipGap();
+    void checkGap();
+    static void receiveHandler(void* data);
+
+    UWBSession& sess;
+    uint32_t timeout;
+    SemaphoreHandle_t lock;
+
+    uint8_t ring[ringSize];
+    size_t head;                // next byte written
+    size_t tail;                // next byte read
+    size_t count;
+
+    Pending pending[reorderSlots];
+    uint8_t numPending;
+    uint32_t gapSince;          // millis() when the stream started waiting for nextSeq
+    bool synced;
+    uint16_t nextSeq;
+
+    uint32_t numDuplicates;
+    uint32_t numGaps;
+    uint32_t numOverruns;
+
+    static UWBInBandStream* streams[maxStreams];
+};
+
+#endif /* UWBINBANDSTREAM_HPP */
@@ -8,7 +8,7 @@
 #include "UWBRangingData.hpp"
 #include <Arduino.h>
 
-const int MAX_HANDLERS = 10;
+const int MAX_HANDLERS = 24;
 
 struct HandlerEntry {
     uwb::NotificationType notification_type;
@@ -18,6 +18,10 @@ struct HandlerEntry {
 class NotificationDispatcher {
 public:
     static void RegisterNotification(uwb::NotificationType notification_type, void (*handler)(void*)) {
+        for (int i = 0; i < MAX_HANDLERS; ++i) {
+            if (handlers[i].handler == handler && handlers[i].notification_type == notification_type)
+                return; // already registered
+        }
         for (int i = 0; i < MAX_HANDLERS; ++i) {
             if (handlers[i].handler == nullptr) {
                 handlers[i].notification_type = notification_type;
@@ -28,27 +32,37 @@ public:
         Serial.println("Handler array is full!");
     }
 
+    // every handler registered for the notification type is called, in registration order
     static void DispatchNotification(uwb::NotificationType notification_type, void* data) {
+        bool handled = false;
+        if(notification_type == uwb::NotificationType::RANGING_DATA)
+        {
+            UWBHAL.Log_Array_D("Ranging Data Notification", (uint8_t*)data, sizeof(uwb::RangingResult));
+            uwb::RangingResult result = *(uwb::RangingResult*)data;
+
+            UWBRangingData rangingData(result);
+            handled = dispatch(notification_type, &rangingData);
+        } else {
+            handled = dispatch(notification_type, data);
+        }
+        if (!handled) {
+            Serial.print("No handler for notification type: ");
+            Serial.println(static_cast<int>(notification_type));
+        }
+    }
+
+private:
+    static bool dispatch(uwb::NotificationType notification_type, void* data) {
+        bool handled = false;
         for (int i = 0; i < MAX_HANDLERS; ++i) {
             if (handlers[i].handler != nullptr && handlers[i].notification_type == notification_type) {
-                if(notification_type == uwb::NotificationType::RANGING_DATA)
-                {   
-                    UWBHAL.Log_Array_D("Ranging Data Notification", (uint8_t*)data, sizeof(uwb::RangingResult));
-                    uwb::RangingResult result = *(uwb::RangingResult*)data;
-                    
-                    UWBRangingData rangingData(result);
-                    handlers[i].handler(&rangingData);
-                } else {
-                    handlers[i].handler(data);
-                }
-                return;
+                handlers[i].handler(data);
+                handled = true;
             }
         }
-        Serial.print("No handler for notification type: ");
-        Serial.println(static_cast<int>(notification_type));
+        return handled;
     }
 
-private:
     static HandlerEntry handlers[MAX_HANDLERS];
 };
 
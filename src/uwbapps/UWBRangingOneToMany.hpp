@@ -7,6 +7,7 @@
 
 #include "UWBSession.hpp"
 #include "UWBMacAddressList.hpp"
+#include "UWBRangingPlanner.hpp"
 
 /**
  * @brief One-to-Many ranging Controller helper
@@ -15,12 +16,16 @@
  * performs Two-Way Ranging with multiple controlees in a time-scheduled, secure
  * SP3 profile. It mirrors the style and defaults of `UWBRangingController` but
  * targets multicast/one-to-many.
+ * Controlees can join or leave while ranging with addControlee() and 
+ * removeControlee().
  */
 class  UWBRangingOneToMany:public UWBSession {
 
 public:
-	// Multicast constructor: accept a list of destination MAC addresses
-	UWBRangingOneToMany(uint32_t session_ID, UWBMacAddress srcAddr, UWBMacAddressList dstAddr)
+	// Multicast constructor: accept a list of destination MAC addresses.
+	// With updateRate (Hz) the round timing is computed by UWBRangingPlanner,
+	// otherwise the default 25 slots every 200 ms are used
+	UWBRangingOneToMany(uint32_t session_ID, UWBMacAddress srcAddr, UWBMacAddressList dstAddr, float updateRate = 0)
 	{
 		sessionID(session_ID);
 		sessionType(uwb::SessionType::RANGING);
@@ -31,14 +36,17 @@ public:
 		rangingParams.scheduledMode(uwb::ScheduledMode::TIME_SCHEDULED);
 		rangingParams.deviceMacAddr(srcAddr);
 
-		appParams.noOfControlees(dstAddr.size());
-		appParams.destinationMacAddr(dstAddr);
+		controlees(dstAddr);
 		appParams.frameConfig(uwb::RfFrameConfig::SP3);
 		appParams.slotPerRR(25);
 		appParams.rangingDuration(200);
 		appParams.stsConfig(uwb::StsConfig::StaticSts);
 		appParams.sfdId(2);
 		appParams.preambleCodeIndex(10);
+
+		// tightest round for this number of controlees, they must be planned the same way
+		if (updateRate > 0)
+			UWBRangingPlanner::plan(*this, updateRate);
 	}
 };
 
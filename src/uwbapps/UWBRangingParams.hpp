@@ -385,6 +385,20 @@ public:
         return _ranging_params.scheduled_mode;
     }
 
+    bool operator==(const UWBRangingParams& other) const {
+        return _ranging_params.device_role == other._ranging_params.device_role &&
+               _ranging_params.device_type == other._ranging_params.device_type &&
+               _ranging_params.multi_node_mode == other._ranging_params.multi_node_mode &&
+               _ranging_params.mac_addr_mode == other._ranging_params.mac_addr_mode &&
+               _ranging_params.ranging_method == other._ranging_params.ranging_method &&
+               _ranging_params.scheduled_mode == other._ranging_params.scheduled_mode &&
+               memcmp(_ranging_params.device_mac_addr, other._ranging_params.device_mac_addr, MAC_EXT_ADD_LEN) == 0;
+    }
+
+    bool operator!=(const UWBRangingParams& other) const {
+        return !(*this == other);
+    }
+
 private:
     uwb::RangingConfig _ranging_params;
     
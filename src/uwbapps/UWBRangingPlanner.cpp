@@ -0,0 +1,210 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBRangingPlanner.hpp"
+#include <string.h>
+
+uint16_t UWBRangingPlanner::slotsNeeded(uint8_t numControlees, uwb::RangingMethod method)
+{
+    uint16_t n = numControlees ? numControlees : 1;
+
+    switch (method)
+    {
+        case uwb::RangingMethod::SS_TWR:
+            return 2 + 2 * n;
+        case uwb::RangingMethod::SS_TWR_NO_DEFER:
+            return 2 + n;
+        case uwb::RangingMethod::DS_TWR:
+            return 4 + 2 * n;
+        case uwb::RangingMethod::DS_TWR_NO_DEFER:
+            return 3 + n;
+        default:
+            return 0;
+    }
+}
+
+uint16_t UWBRangingPlanner::minSlotDuration(uint8_t frameConfig)
+{
+    return frameConfig == uwb::RfFrameConfig::SP3 ? slotDurationShort : slotDurationLong;
+}
+
+bool UWBRangingPlanner::plan(uint8_t numControlees, uwb::RangingMethod method, uint8_t frameConfig,
+                             float updateRate, UWBRoundPlan& plan)
+{
+    uint16_t slots = slotsNeeded(numControlees, method);
+    uint32_t roundMs;
+
+    if (slots == 0 || slots > 0xFF || updateRate <= 0)
+        return false;
+
+    plan.slotsPerRR = slots;
+    plan.slotDuration = minSlotDuration(frameConfig);
+    plan.roundDuration = (uint32_t)slots * plan.slotDuration * 1000 / rstuPerMs;
+
+    // the interval cannot be shorter than the round itself
+    roundMs = (plan.roundDuration + 999) / 1000;
+    plan.rangingDuration = (uint32_t)(1000.0f / updateRate);
+    if (plan.rangingDuration < roundMs)
+        plan.rangingDuration = roundMs;
+    plan.updateRate = 1000.0f / plan.rangingDuration;
+    plan.capSize = 0;
+    plan.blockStride = 0;
+    plan.successRate = 1;
+    plan.throughput = plan.updateRate * (numControlees ? numControlees : 1);
+    return true;
+}
+
+float UWBRangingPlanner::contentionSuccess(uint16_t numTags, uint8_t capSize)
+{
+    float p = 1;
+    float miss;
+
+    if (capSize == 0)
+        return 0;
+    miss = 1.0f - 1.0f / capSize;
+    for (uint16_t i = 1; i < numTags; ++i)
+        p *= miss;
+    return p;
+}
+
+bool UWBRangingPlanner::planContention(uint16_t numTags, uwb::RangingMethod method, uint8_t frameConfig,
+                                       float updateRate, UWBRoundPlan& plan, uint8_t blockStride)
+{
+    uint8_t fixedSlots;
+    uint16_t active;
+    uint16_t slotDuration = minSlotDuration(frameConfig);
+    uint32_t interval;
+    float score;
+    float bestScore = 0;
+    uint32_t maxCap;
+
+    // control and poll, plus the final of DS-TWR, around the CAP
+    if (method == uwb::RangingMethod::SS_TWR_NO_DEFER)
+        fixedSlots = 2;
+    else if (method == uwb::RangingMethod::DS_TWR_NO_DEFER)
+        fixedSlots = 3;
+    else
+        return false;
+    if (updateRate <= 0)
+        return false;
+
+    active = (numTags + blockStride) / (blockStride + 1);
+    if (active == 0)
+        active = 1;
+
+    // start from the CAP giving the most results per slot of airtime: a
+    // smaller CAP loses more attempts to collisions than it saves
+    plan.capSize = minCapSize;
+    for (uint16_t cap = minCapSize; cap + fixedSlots <= 0xFF; ++cap)
+    {
+        score = active * contentionSuccess(active, cap) / (cap + fixedSlots);
+        if (score > bestScore)
+        {
+            bestScore = score;
+            plan.capSize = cap;
+        }
+    }
+
+    // then grow it towards the target success rate, as long as the round
+    // still fits the requested interval
+    interval = (uint32_t)(1000.0f / updateRate);
+    maxCap = (uint32_t)interval * rstuPerMs / slotDuration;
+    maxCap = maxCap > fixedSlots ? maxCap - fixedSlots : 0;
+    if (maxCap > (uint32_t)(0xFF - fixedSlots))
+        maxCap = 0xFF - fixedSlots;
+    while (plan.capSize < maxCap && contentionSuccess(active, plan.capSize) < contentionTarget)
+        plan.capSize++;
+
+    plan.slotsPerRR = plan.capSize + fixedSlots;
+    plan.slotDuration = slotDuration;
+    plan.roundDuration = (uint32_t)plan.slotsPerRR * slotDuration * 1000 / rstuPerMs;
+
+    // the interval cannot be shorter than the round itself
+    plan.rangingDuration = (plan.roundDuration + 999) / 1000;
+    if (plan.rangingDuration < interval)
+        plan.rangingDuration = interval;
+    plan.updateRate = 1000.0f / plan.rangingDuration;
+    plan.blockStride = blockStride;
+    plan.successRate = contentionSuccess(active, plan.capSize);
+    plan.throughput = (float)numTags / (blockStride + 1) * plan.successRate * plan.updateRate;
+    return true;
+}
+
+float UWBRangingPlanner::simulate(uint16_t numTags, const UWBRoundPlan& plan, uint32_t rounds, uint32_t seed)
+{
+    uint8_t picks[0x100];
+    uint32_t results = 0;
+    uint32_t x = seed ? seed : 1;
+
+    if (rounds == 0 || plan.rangingDuration == 0)
+        return 0;
+    if (plan.capSize == 0)
+        return (float)numTags * 1000.0f / plan.rangingDuration;
+
+    for (uint32_t r = 0; r < rounds; ++r)
+    {
+        memset(picks, 0, plan.capSize);
+        for (uint16_t t = 0; t < numTags; ++t)
+        {
+            // with striding the tags take turns, one group per round
+            if ((t + r) % (plan.blockStride + 1) != 0)
+                continue;
+            x ^= x << 13;
+            x ^= x >> 17;
+            x ^= x << 5;
+            uint8_t slot = x % plan.capSize;
+            if (picks[slot] < 2)
+                picks[slot]++;
+        }
+        for (uint16_t s = 0; s < plan.capSize; ++s)
+        {
+            if (picks[s] == 1)
+                results++;
+        }
+    }
+    return results * 1000.0f / ((float)rounds * plan.rangingDuration);
+}
+
+bool UWBRangingPlanner::apply(const UWBRoundPlan& plan, UWBAppParamList& params)
+{
+    if (plan.capSize != 0 && !params.capSizeRange(plan.capSize, minCapSize))
+        return false;
+    if (plan.blockStride != 0 && !params.blockStride(plan.blockStride))
+        return false;
+    return params.slotPerRR(plan.slotsPerRR) &&
+           params.slotDuration(plan.slotDuration) &&
+           params.rangingDuration(plan.rangingDuration);
+}
+
+bool UWBRangingPlanner::plan(UWBSession& session, float updateRate, UWBRoundPlan* result)
+{
+    UWBRoundPlan p;
+    uint8_t frameConfig = uwb::RfFrameConfig::SP3;
+    uint8_t numControlees = 1;
+    uwb::AppConfig* param;
+
+    param = session.appParams.findParam(uwb::AppConfigId::RFrameConfig);
+    if (param != nullptr)
+        frameConfig = param->param_value.vu32;
+    param = session.appParams.findParam(uwb::AppConfigId::NumControlees);
+    if (param != nullptr)
+        numControlees = param->param_value.vu32;
+
+    if (!plan(numControlees, session.rangingParams.rangingRoundUsage(), frameConfig, updateRate, p))
+    {
+        UWBHAL.Log_E("cannot plan %d controlees", numControlees);
+        return false;
+    }
+    if (!apply(p, session.appParams))
+        return false;
+
+    session.plannedRate(updateRate);
+    UWBHAL.Log_D("round plan: %d slots of %d RSTU, %d ms", p.slotsPerRR, p.slotDuration, p.rangingDuration);
+    if (result != nullptr)
+        *result = p;
+
+    // an initialized session sends only the three changed values
+    if (session.isConfigured())
+        session.reconfigure();
+    return true;
+}
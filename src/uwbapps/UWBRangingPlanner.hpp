@@ -0,0 +1,169 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBRANGINGPLANNER_HPP
+#define UWBRANGINGPLANNER_HPP
+
+#include <stdint.h>
+#include "UWBSession.hpp"
+
+/**
+ * @brief timing of a ranging round computed by UWBRangingPlanner
+ *
+ */
+struct UWBRoundPlan {
+    uint8_t slotsPerRR;         // slots per ranging round
+    uint16_t slotDuration;      // RSTU, 1200 RSTU == 1 ms
+    uint32_t rangingDuration;   // ms, ranging interval
+    uint32_t roundDuration;     // us, airtime of the slots of one round
+    float updateRate;           // Hz, achieved with this plan
+    uint8_t capSize;            // contention access period slots, 0 if time scheduled
+    uint8_t blockStride;        // tags range every blockStride + 1 rounds
+    float successRate;          // expected fraction of the ranging attempts that succeed
+    float throughput;           // expected ranging results per second, all tags together
+};
+
+/**
+ * @brief computes the smallest ranging round that fits N controlees
+ *
+ * Slots needed by a time scheduled round, one message per slot:
+ *
+ * | method              | slots                                       |
+ * |---------------------|---------------------------------------------|
+ * | SS-TWR deferred     | control, poll, N responses, N reports       |
+ * | SS-TWR non deferred | control, poll, N responses                  |
+ * | DS-TWR deferred     | control, poll, N responses, final,          |
+ * |                     | measurement report, N reports               |
+ * | DS-TWR non deferred | control, poll, N responses, final           |
+ *
+ * The slot duration is the shortest one that fits the frame: 1 ms for SP3
+ * frames (no payload), 2 ms otherwise. The ranging duration is the
+ * interval that gives the requested update rate, stretched if the round
+ * does not fit in it.
+ *
+ * Both ends of a session must use the same slotsPerRR, slot duration and
+ * ranging duration: plan the controller and its controlees with the same
+ * inputs.
+ *
+ * Contention based rounds do not enumerate the responders: after the
+ * control and poll messages each responder answers in a random slot of the
+ * Contention Access Period (CAP), and only the slots picked by exactly one
+ * responder give a result. With N responders and a CAP of K slots each
+ * attempt succeeds with probability (1 - 1/K)^(N-1). planContention()
+ * starts from the CAP that gives the most results per slot of airtime
+ * (about one slot per tag, 40% of the attempts succeed) and grows it
+ * towards contentionTarget as long as the round fits the requested
+ * interval.
+ *
+ */
+class UWBRangingPlanner {
+public:
+    static const uint16_t slotDurationShort = 1200;    // RSTU, SP3 frames
+    static const uint16_t slotDurationLong = 2400;     // RSTU, frames with payload
+    static const uint16_t rstuPerMs = 1200;
+
+    /**
+     * @brief number of slots needed by a round
+     *
+     * @param numControlees
+     * @param method
+     * @return uint16_t 0 if the method is not a two way ranging
+     */
+    static uint16_t slotsNeeded(uint8_t numControlees, uwb::RangingMethod method);
+
+    /**
+     * @brief shortest slot fitting a frame configuration
+     *
+     * @param frameConfig uwb::RfFrameConfig
+     * @return uint16_t RSTU
+     */
+    static uint16_t minSlotDuration(uint8_t frameConfig);
+
+    /**
+     * @brief compute the round timing
+     *
+     * @param numControlees
+     * @param method
+     * @param frameConfig uwb::RfFrameConfig
+     * @param updateRate requested ranging rate, Hz
+     * @param plan the result
+     * @return true
+     * @return false if the round cannot be planned (method, too many slots)
+     */
+    static bool plan(uint8_t numControlees, uwb::RangingMethod method, uint8_t frameConfig,
+                     float updateRate, UWBRoundPlan& plan);
+
+    /**
+     * @brief write the plan into a parameter list
+     *
+     * @param plan
+     * @param params
+     * @return true
+     * @return false if the list is full
+     */
+    static bool apply(const UWBRoundPlan& plan, UWBAppParamList& params);
+
+    /**
+     * @brief plan a session from its own configuration and apply the result
+     *
+     * The ranging method comes from the ranging params, the frame config
+     * and the number of controlees from the app params (SP3 and 1 controlee
+     * if not set). A session already initialized, and not ranging, applies
+     * the new timing with reconfigure(). The session keeps the update rate:
+     * UWBSession::addControlee() plans it again when it runs out of slots.
+     *
+     * @param session
+     * @param updateRate requested ranging rate, Hz
+     * @param plan optional, receives the result
+     * @return true
+     * @return false if the round cannot be planned
+     */
+    static bool plan(UWBSession& session, float updateRate, UWBRoundPlan* plan = nullptr);
+
+    static const uint8_t minCapSize = 5;
+    static constexpr float contentionTarget = 0.9f;     // success rate worth extra CAP slots
+
+    /**
+     * @brief compute the round timing of a contention based session
+     *
+     * Only non deferred methods are supported: a deferred report would need
+     * a second contention period.
+     *
+     * @param numTags responders expected in range
+     * @param method uwb::RangingMethod::SS_TWR_NO_DEFER or DS_TWR_NO_DEFER
+     * @param frameConfig uwb::RfFrameConfig
+     * @param updateRate requested ranging rate, Hz
+     * @param plan the result
+     * @param blockStride tags range every blockStride + 1 rounds
+     * @return true
+     * @return false if the round cannot be planned
+     */
+    static bool planContention(uint16_t numTags, uwb::RangingMethod method, uint8_t frameConfig,
+                               float updateRate, UWBRoundPlan& plan, uint8_t blockStride = 0);
+
+    /**
+     * @brief probability that a responder gets a CAP slot for itself
+     *
+     * @param numTags responders contending in the round
+     * @param capSize
+     * @return float
+     */
+    static float contentionSuccess(uint16_t numTags, uint8_t capSize);
+
+    /**
+     * @brief simulate rounds of a plan, without the radio
+     *
+     * Every active responder picks a random CAP slot, the slots picked by
+     * exactly one responder are counted as results. A time scheduled plan
+     * (capSize 0) gives a result per responder and round.
+     *
+     * @param numTags
+     * @param plan
+     * @param rounds
+     * @param seed of the pseudo random generator, same seed same result
+     * @return float ranging results per second, all tags together
+     */
+    static float simulate(uint16_t numTags, const UWBRoundPlan& plan, uint32_t rounds, uint32_t seed = 1);
+};
+
+#endif /* UWBRANGINGPLANNER_HPP */
@@ -2,6 +2,7 @@
 // Copyright (c) 2025 Truesense Srl
 
 #include "UWBSession.hpp"
+#include "UWBRangingPlanner.hpp"
 
 
 UWBSession::UWBSession()
@@ -10,6 +11,10 @@ UWBSession::UWBSession()
     sessionHdl = 0;
     type = uwb::SessionType::RANGING;
     isActive = false;
+    configApplied = false;
+    controleeCount = 0;
+    controleeAddrSize = UWBMacAddress::SHORT;
+    planRate = 0;
 
     // Initialize the ranging parameters with default antenna config
     static uint8_t antennaeConfigurationRx[] = { 1, 0x01, (1)};
@@ -24,6 +29,42 @@ UWBSession::UWBSession()
 }
 
 
+UWBSession::UWBSession(const UWBSession& other)
+{
+    *this = other;
+}
+
+UWBSession& UWBSession::operator=(const UWBSession& other)
+{
+    uwb::AppConfig* peers;
+
+    if (this == &other)
+        return *this;
+    sessID = other.sessID;
+    sessionHdl = other.sessionHdl;
+    type = other.type;
+    isActive = other.isActive;
+    rangingParams = other.rangingParams;
+    appParams = other.appParams;
+    vendorParams = other.vendorParams;
+    configApplied = other.configApplied;
+    appliedRangingParams = other.appliedRangingParams;
+    appliedAppParams = other.appliedAppParams;
+    appliedVendorParams = other.appliedVendorParams;
+    controleeCount = other.controleeCount;
+    controleeAddrSize = other.controleeAddrSize;
+    planRate = other.planRate;
+    memcpy(controleeAddrs, other.controleeAddrs, sizeof(controleeAddrs));
+
+    // the controlee list must point to our own copy
+    peers = appParams.findParam(uwb::AppConfigId::PeerAddress);
+    if (peers != nullptr && peers->param_value.au8.param_value == other.controleeAddrs)
+        peers->param_value.au8.param_value = controleeAddrs;
+    else
+        adoptControlees();
+    return *this;
+}
+
 void UWBSession::sessionID(uint32_t id)
 {
     sessID = id;
@@ -63,6 +104,7 @@ uwb::Status UWBSession::init()
         UWBHAL.Log_E("could not init session");
         return res;
     }
+    UWBSessionStates.created(sessionHdl);
     // Set ranging (core) params first to ensure device mode/addressing is configured
     res=UWBHAL.setRangingParams(sessionHdl, rangingParams);
     if (res != uwb::Status::SUCCESS)
@@ -96,11 +138,71 @@ uwb::Status UWBSession::init()
     else
         UWBHAL.Log_E("no vendor params");
 
+    captureAppliedConfig();
+    return res;
+}
+
+uwb::Status UWBSession::reconfigure()
+{
+    uwb::Status res = uwb::Status::SUCCESS;
+    if (!configApplied)
+    {
+        UWBHAL.Log_E("session not configured, call init() first");
+        return uwb::Status::SESSION_NOT_CONFIGURED;
+    }
+
+    if (rangingParams != appliedRangingParams)
+    {
+        res = UWBHAL.setRangingParams(sessionHdl, rangingParams);
+        if (res != uwb::Status::SUCCESS)
+        {
+            UWBHAL.Log_E("could not set ranging params");
+            return res;
+        }
+    }
+
+    UWBAppParamList appDelta;
+    if (appParams.diff(appliedAppParams, appDelta))
+    {
+        res = UWBHAL.setAppConfigMultiple(sessionHdl, appDelta);
+        if (res != uwb::Status::SUCCESS)
+        {
+            UWBHAL.Log_E("could not set app params: %d", res);
+            return res;
+        }
+    }
+
+    UWBVendorParamList vendorDelta;
+    if (vendorParams.diff(appliedVendorParams, vendorDelta))
+    {
+        res = UWBHAL.setVendorAppConfig(sessionHdl, vendorDelta);
+        if (res != uwb::Status::SUCCESS)
+        {
+            UWBHAL.Log_E("could not set vendor params - %d", res);
+            return res;
+        }
+    }
+
+    UWBHAL.Log_D("reconfigured %d app, %d vendor params", appDelta.getSize(), vendorDelta.getSize());
+    captureAppliedConfig();
     return res;
 }
 
+void UWBSession::captureAppliedConfig()
+{
+    appliedRangingParams = rangingParams;
+    // if the array values do not fit, an empty snapshot makes the next
+    // reconfigure() send everything again
+    if (!appliedAppParams.capture(appParams))
+        appliedAppParams.clear();
+    if (!appliedVendorParams.capture(vendorParams))
+        appliedVendorParams.clear();
+    configApplied = true;
+}
+
 uwb::Status UWBSession::deInit()
 {
+    configApplied = false;
     return UWBHAL.sessionDeinit(sessionHdl);
 }
 
@@ -146,6 +248,175 @@ uwb::Status UWBSession::sendData(uint8_t *sendData, uint8_t len, uint8_t seq_num
     return UWBHAL.sendData(data);
 }
 
+bool UWBSession::controlees(UWBMacAddressList& list)
+{
+    if (list.size() > uwb::MAX_RESPONDERS)
+        return false;
+    controleeAddrSize = list.macTypeSize();
+    controleeCount = list.size();
+    memcpy(controleeAddrs, list.getAllData(), controleeCount * controleeAddrSize);
+    return appParams.noOfControlees(controleeCount) &&
+           appParams.addOrUpdateParam(buildArray(uwb::AppConfigId::PeerAddress, controleeAddrs, controleeCount * controleeAddrSize));
+}
+
+void UWBSession::adoptControlees()
+{
+    uwb::AppConfig* peers = appParams.findParam(uwb::AppConfigId::PeerAddress);
+    uwb::AppConfig* count = appParams.findParam(uwb::AppConfigId::NumControlees);
+    uint16_t len;
+    uint8_t size;
+
+    if (peers == nullptr)
+    {
+        controleeCount = 0;
+        return;
+    }
+    if (peers->param_value.au8.param_value == controleeAddrs)
+        return;
+    len = peers->param_value.au8.param_len;
+    size = rangingParams.macAddrMode() == 0 ? UWBMacAddress::SHORT : UWBMacAddress::LONG;
+    if (count != nullptr && count->param_value.vu32 > 0 && len % count->param_value.vu32 == 0)
+        size = len / count->param_value.vu32;
+    if ((size != UWBMacAddress::SHORT && size != UWBMacAddress::LONG) || len % size || len / size > uwb::MAX_RESPONDERS)
+    {
+        UWBHAL.Log_W("session %08X: peer address list of %d bytes not adopted", sessID, len);
+        return;
+    }
+
+    controleeAddrSize = size;
+    controleeCount = len / size;
+    memcpy(controleeAddrs, peers->param_value.au8.param_value, len);
+    peers->param_value.au8.param_value = controleeAddrs;
+}
+
+int UWBSession::findControlee(UWBMacAddress& addr)
+{
+    for (int i = 0; i < controleeCount; ++i)
+    {
+        if (memcmp(&controleeAddrs[i * controleeAddrSize], addr.getData(), controleeAddrSize) == 0)
+            return i;
+    }
+    return -1;
+}
+
+uwb::Status UWBSession::addControlee(UWBMacAddress& addr)
+{
+    uwb::Status res;
+
+    adoptControlees();
+    if (controleeCount == 0)
+        controleeAddrSize = addr.getSize();
+    if (addr.getSize() != controleeAddrSize || findControlee(addr) >= 0)
+        return uwb::Status::INVALID_PARAM;
+    if (controleeCount >= uwb::MAX_RESPONDERS)
+        return uwb::Status::MAX_SESSIONS_EXCEEDED;
+    res = fitControlees(controleeCount + 1);
+    if (res != uwb::Status::SUCCESS)
+        return res;
+
+    memcpy(&controleeAddrs[controleeCount * controleeAddrSize], addr.getData(), controleeAddrSize);
+    controleeCount++;
+    return applyControlees();
+}
+
+uwb::Status UWBSession::removeControlee(UWBMacAddress& addr)
+{
+    int i;
+
+    adoptControlees();
+    i = findControlee(addr);
+    if (i < 0)
+        return uwb::Status::INVALID_PARAM;
+
+    // keep the order of the others, the slot of each controlee depends on it
+    memmove(&controleeAddrs[i * controleeAddrSize], &controleeAddrs[(i + 1) * controleeAddrSize],
+            (controleeCount - i - 1) * controleeAddrSize);
+    controleeCount--;
+    return applyControlees();
+}
+
+uint8_t UWBSession::numControlees()
+{
+    adoptControlees();
+    return controleeCount;
+}
+
+uwb::Status UWBSession::applyControlees()
+{
+    uwb::Status res;
+    bool running;
+
+    appParams.noOfControlees(controleeCount);
+    appParams.addOrUpdateParam(buildArray(uwb::AppConfigId::PeerAddress, controleeAddrs, controleeCount * controleeAddrSize));
+    if (!configApplied)
+        return uwb::Status::SUCCESS;
+
+    // the UWBS accepts the new list only while the session is idle
+    running = currentState() == UWBSessionState::ACTIVE;
+    if (running)
+    {
+        res = stop();
+        if (res == uwb::Status::SUCCESS)
+            res = waitForState(UWBSessionState::IDLE);
+        if (res != uwb::Status::SUCCESS && res != uwb::Status::NOT_INITIALIZED)
+        {
+            UWBHAL.Log_E("could not pause session for the controlee update: %d", res);
+            return res;
+        }
+    }
+
+    res = reconfigure();
+    if (running)
+    {
+        uwb::Status startRes = start();
+        if (res == uwb::Status::SUCCESS)
+            res = startRes;
+    }
+    UWBHAL.Log_D("session %08X now has %d controlees: %d", sessID, controleeCount, res);
+    return res;
+}
+
+// make room in the round, the new timing is sent by applyControlees()
+uwb::Status UWBSession::fitControlees(uint8_t count)
+{
+    UWBRoundPlan p;
+    uint8_t frameConfig = uwb::RfFrameConfig::SP3;
+    uwb::RangingMethod method = rangingParams.rangingRoundUsage();
+    uint16_t needed = UWBRangingPlanner::slotsNeeded(count, method);
+    uwb::AppConfig* param = appParams.findParam(uwb::AppConfigId::SlotsPerRound);
+
+    // no slot count set or no two way ranging: nothing to check
+    if (param == nullptr || needed == 0 || needed <= param->param_value.vu32)
+        return uwb::Status::SUCCESS;
+    if (planRate <= 0)
+    {
+        UWBHAL.Log_E("%d controlees need %d slots, the round has %d", count, needed, param->param_value.vu32);
+        return uwb::Status::INVALID_RANGE;
+    }
+
+    param = appParams.findParam(uwb::AppConfigId::RFrameConfig);
+    if (param != nullptr)
+        frameConfig = param->param_value.vu32;
+    if (!UWBRangingPlanner::plan(count, method, frameConfig, planRate, p) ||
+        !UWBRangingPlanner::apply(p, appParams))
+    {
+        UWBHAL.Log_E("cannot plan %d controlees", count);
+        return uwb::Status::INVALID_RANGE;
+    }
+    UWBHAL.Log_D("round planned again: %d slots, %d ms", p.slotsPerRR, p.rangingDuration);
+    return uwb::Status::SUCCESS;
+}
+
+UWBSessionState UWBSession::currentState()
+{
+    return UWBSessionStates.state(sessionHdl);
+}
+
+uwb::Status UWBSession::waitForState(UWBSessionState state, uint32_t timeout)
+{
+    return UWBSessionStates.waitFor(sessionHdl, state, timeout);
+}
+
 uwb::Status UWBSession::start()
 {
     return UWBHAL.startRanging(sessionHdl);
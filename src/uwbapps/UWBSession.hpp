@@ -9,6 +9,8 @@
 #include "UWBRangingParams.hpp"
 #include "UWBAppParamList.hpp"
 #include "UWBVendorParamList.hpp"
+#include "UWBSessionState.hpp"
+#include "UWBMacAddressList.hpp"
 
 /**
  * @brief UWB Session wrapper class
@@ -110,6 +112,12 @@ public:
      *
      */
     UWBSession();
+
+    /**
+     * @brief copies keep their own controlee list (see addControlee())
+     */
+    UWBSession(const UWBSession& other);
+    UWBSession& operator=(const UWBSession& other);
     
     uint32_t sessionID();
     /**
@@ -148,6 +156,19 @@ public:
      * @return uwb::Status::SUCCESS if OK
      */
     uwb::Status init();
+    /**
+     * @brief sends only the parameters that changed since the last successful
+     * init() or reconfigure()
+     *
+     * Changed application and vendor parameters are sent in one batched call
+     * each, so the session does not need to be torn down. Ranging (core)
+     * parameters are sent only if they changed, and the UWBS accepts them only
+     * while the session is idle.
+     *
+     * @return uwb::Status::SUCCESS if OK (also when nothing changed)
+     * @return uwb::Status::SESSION_NOT_CONFIGURED if init() did not succeed yet
+     */
+    uwb::Status reconfigure();
     /**
      * @brief deinit the session
      */
@@ -256,6 +277,100 @@ public:
      */
     uwb::Status state(uint8_t& state);
 
+    /**
+     * @brief set the controlees of a one-to-many session
+     *
+     * The addresses are copied in the session, together with the number of 
+     * controlees. Must be called before init(), use addControlee() and 
+     * removeControlee() on a live session.
+     *
+     * @param list 
+     * @return true 
+     * @return false if the list has more than uwb::MAX_RESPONDERS addresses
+     */
+    bool controlees(UWBMacAddressList& list);
+
+    /**
+     * @brief add a controlee to a live one-to-many session
+     *
+     * The session keeps running: a ranging session is stopped, only the 
+     * controlee list and count are sent to the UWBS, and it is restarted 
+     * as soon as the UWBS notifies it is idle. A session not initialized 
+     * yet just gets the new list.
+     *
+     * The round must have a slot for the new controlee: a round planned 
+     * with UWBRangingPlanner::plan() is planned again for the new number 
+     * of controlees, at the same update rate.
+     *
+     * @param addr same size as the other controlees
+     * @return uwb::Status::SUCCESS 
+     * @return uwb::Status::MAX_SESSIONS_EXCEEDED if the list is full
+     * @return uwb::Status::INVALID_PARAM if the address is already present or of the wrong size
+     * @return uwb::Status::INVALID_RANGE if SlotsPerRound is too small and the round was not planned
+     */
+    uwb::Status addControlee(UWBMacAddress& addr);
+
+    /**
+     * @brief remove a controlee from a live one-to-many session, see addControlee()
+     *
+     * @param addr 
+     * @return uwb::Status::SUCCESS 
+     * @return uwb::Status::INVALID_PARAM if the address is not in the list
+     */
+    uwb::Status removeControlee(UWBMacAddress& addr);
+
+    /**
+     * @brief number of controlees set with controlees() / addControlee()
+     */
+    uint8_t numControlees();
+
+    /**
+     * @brief take a copy of the PeerAddress list set directly in appParams
+     *
+     * e.g. with appParams.destinationMacAddr() or by UWBSessionSnapshot::read(),
+     * the list then points to the session copy and addControlee() extends it.
+     * The address size comes from NumControlees, else from the MAC address mode.
+     * Without a PeerAddress param the list is empty.
+     */
+    void adoptControlees();
+
+    /**
+     * @brief remember the update rate the round was planned for
+     *
+     * Set by UWBRangingPlanner::plan(), addControlee() plans the round 
+     * again at this rate when it runs out of slots.
+     *
+     * @param updateRate Hz, 0 if the round timing was set by hand
+     */
+    void plannedRate(float updateRate) { planRate = updateRate; }
+    float plannedRate() { return planRate; }
+
+    /**
+     * @brief true once init() applied the configuration to the UWBS
+     */
+    bool isConfigured() { return configApplied; }
+
+    /**
+     * @brief last state notified by the UWBS for this session
+     *
+     * Unlike state() no command is sent, the value is kept up to date by the 
+     * session status notifications.
+     *
+     * @return UWBSessionState 
+     */
+    UWBSessionState currentState();
+
+    /**
+     * @brief wait until the UWBS notifies a session state
+     *
+     * e.g. waitForState(UWBSessionState::ACTIVE) after start()
+     *
+     * @param state 
+     * @param timeout milliseconds
+     * @return uwb::Status::SUCCESS when the state is reached, see UWBSessionStates_::waitFor()
+     */
+    uwb::Status waitForState(UWBSessionState state, uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
     /**
      * @brief Start Ranging for a session. Before Invoking Start ranging its
      * mandatory to set all the ranging configurations.
@@ -290,10 +405,33 @@ public:
     UWBVendorParamList vendorParams;
 
 protected:
+    /**
+     * @brief remember the configuration accepted by the UWBS
+     */
+    void captureAppliedConfig();
+    /**
+     * @brief write the controlee list in the app params and apply it to a live session
+     */
+    uwb::Status applyControlees();
+    uwb::Status fitControlees(uint8_t count);
+    int findControlee(UWBMacAddress& addr);
+
     uint32_t sessID;
     uint32_t sessionHdl;
     uwb::SessionType type;
     bool isActive; // Indicates whether the session slot is in use
+
+    // Last configuration accepted by the UWBS, used by reconfigure()
+    bool configApplied;
+    UWBRangingParams appliedRangingParams;
+    UWBAppParamSnapshot appliedAppParams;
+    UWBVendorParamSnapshot appliedVendorParams;
+
+    // controlee addresses owned by the session, the PeerAddress param points here
+    uint8_t controleeAddrs[uwb::MAX_RESPONDERS * UWBMacAddress::LONG];
+    uint8_t controleeCount;
+    uint8_t controleeAddrSize;
+    float planRate;     // Hz, 0 if the round was not planned
 };
 
 #endif // UWBSESSION_HPP
@@ -2,67 +2,165 @@
 // Copyright (c) 2025 Truesense Srl
 
 #include "UWBSessionManager.hpp"
+#include "UWBSessionSnapshot.hpp"
+#include "UWBNotification.hpp"
 
+// delay before each recovery attempt, milliseconds
+static const uint16_t recoveryBackoff[UWBSessionManager_::maxRecoveryAttempts] = {0, 50, 100, 250, 500};
 
-UWBSessionManager_::UWBSessionManager_() {}
+// default radio plan: channel 9, BPRF preamble codes
+static const uint8_t defaultRadioChannels[] = {9};
+static const uint8_t defaultRadioCodes[] = {9, 10, 11, 12};
 
-bool UWBSessionManager_::deleteSession(uint32_t sessionID)
+UWBSessionManager_::UWBSessionManager_(UWBSession storage[])
 {
-    Serial.println("In deleteSession");
-    Serial.println("Numsessions: " );
-    Serial.println(numSessions);
-    for (int i = 0; i < numSessions; ++i)
+    numSessions = 0;
+    numFree = 0;
+    for (int i = maxSessions - 1; i >= 0; --i)
     {
-        if (sessions[i]->sessionID() == sessionID)
-        {
-            delete sessions[i];
-            // Shift elements to fill the gap
-            for (int j = i; j < numSessions - 1; ++j) {
-                sessions[j] = sessions[j + 1];
-            }
-            numSessions--;
-            sessions[numSessions]=nullptr;
-            Serial.println("Session deleted successfully");
-            Serial.println("Numsessions: " );
-            Serial.println(numSessions);
-            return true;
-        }
+        sessions[i] = nullptr;
+        slab[i] = storage ? &storage[i] : nullptr;
+        slotPos[i] = -1;
+        posSlot[i] = -1;
+        handleBound[i] = false;
+        wasRanging[i] = false;
+        radioCombo[i] = -1;
+        if (slab[i])
+            freeSlots[numFree++] = i;
     }
-    return false;
+    recoveryEnabled = false;
+    recoveryHandlersRegistered = false;
+    resetTimestamp = 0;
+    recoverySem = NULL;
+    recoveryTaskHandle = NULL;
+    recoveryCallback = nullptr;
+    memset(&stats, 0, sizeof(stats));
+    radioAuto = false;
+    radioFeedbackRegistered = false;
+    radioCallback = nullptr;
+    radioPlan(defaultRadioChannels, sizeof(defaultRadioChannels), defaultRadioCodes, sizeof(defaultRadioCodes));
 }
-bool UWBSessionManager_::addSession(UWBSession& sess)
+
+void UWBSessionManager_::useSlot(int index, UWBSession* storage)
 {
-    Serial.println("In addSession from UWBSessionManager");
-    UWBSession *newSess= new UWBSession();
-    newSess->sessionID(sess.sessionID());
-    newSess->sessionType(sess.sessionType());
-    
-    if(numSessions >= maxSessions)
+    if (index < 0 || index >= maxSessions || slab[index] != nullptr)
+        return;
+    slab[index] = storage;
+    freeSlots[numFree++] = index;
+}
+
+int UWBSessionManager_::allocSlot()
+{
+    if (numFree == 0)
+        return -1;
+    return freeSlots[--numFree];
+}
+
+bool UWBSessionManager_::commitSlot(int slot)
+{
+    if (isIDInUse(slab[slot]->sessionID()) || !idMap.insert(slab[slot]->sessionID(), slot))
+    {
+        freeSlots[numFree++] = slot;
         return false;
+    }
+    slotPos[slot] = numSessions;
+    posSlot[numSessions] = slot;
+    sessions[numSessions++] = slab[slot];
+    return true;
+}
+
+void UWBSessionManager_::releaseSlot(int slot)
+{
+    int pos = slotPos[slot];
+    int last = numSessions - 1;
+
+    idMap.remove(slab[slot]->sessionID());
+    if (handleBound[slot])
+    {
+        handleMap.remove(boundHandle[slot]);
+        handleBound[slot] = false;
+    }
+
+    // move the last session in the hole, no shifting
+    sessions[pos] = sessions[last];
+    posSlot[pos] = posSlot[last];
+    slotPos[posSlot[pos]] = pos;
+    sessions[last] = nullptr;
+    posSlot[last] = -1;
+    slotPos[slot] = -1;
+    radioCombo[slot] = -1;
+    numSessions--;
+    freeSlots[numFree++] = slot;
+}
+
+void UWBSessionManager_::bindHandle(int slot)
+{
+    if (handleBound[slot])
+        handleMap.remove(boundHandle[slot]);
+    boundHandle[slot] = slab[slot]->sessionHandle();
+    handleBound[slot] = handleMap.insert(boundHandle[slot], slot);
+}
 
-    sessions[numSessions++]= newSess;//&sess;
+bool UWBSessionManager_::slotUsed(int slot)
+{
+    return slot >= 0 && slot < maxSessions && slotPos[slot] >= 0;
+}
+
+bool UWBSessionManager_::deleteSession(uint32_t sessionID)
+{
+    uint8_t slot;
+    if (!idMap.find(sessionID, slot))
+        return false;
+    releaseSlot(slot);
+    UWBHAL.Log_D("session %08X deleted, %d left", sessionID, numSessions);
+    if (radioAuto)
+        repackRadio(false);
     return true;
-    
 }
 
-UWBSession& UWBSessionManager_::getSessionByID(uint32_t id)
+bool UWBSessionManager_::addSession(UWBSession& sess)
 {
-    for (int i = 0; i < numSessions; ++i)
+    if (isIDInUse(sess.sessionID()))
     {
-        if (sessions[i]->sessionID() == id)
-        {
-            return *sessions[i];
-        }
+        UWBHAL.Log_E("session ID %08X already in use", sess.sessionID());
+        return false;
     }
+    int slot = allocSlot();
+    if (slot < 0)
+    {
+        UWBHAL.Log_E("too many sessions");
+        return false;
+    }
+
+    // keep the whole configuration, the recovery needs it to re-init the session
+    *slab[slot] = sess;
+    if (!commitSlot(slot))
+        return false;
+    if (radioAuto)
+        assignRadio(slot, bestRadioCombo(slot));
+    return true;
+}
+
+UWBSession& UWBSessionManager_::getSessionByID(uint32_t id)
+{
+    uint8_t slot;
+    if (idMap.find(id, slot))
+        return *slab[slot];
     return emptySession; // Session ID not found
 }
 
 UWBSession& UWBSessionManager_::getSessionByHandle(uint32_t sessionHandle)
 {
+    uint8_t slot;
+    if (handleMap.find(sessionHandle, slot) && slab[slot]->sessionHandle() == sessionHandle)
+        return *slab[slot];
+
+    // the handle changed since it was bound (e.g. session initialized directly)
     for (int i = 0; i < numSessions; ++i)
     {
-        if ( sessions[i]->sessionHandle() == sessionHandle)
+        if (sessions[i]->sessionHandle() == sessionHandle)
         {
+            bindHandle(posSlot[i]);
             return *sessions[i];
         }
     }
@@ -71,58 +169,459 @@ UWBSession& UWBSessionManager_::getSessionByHandle(uint32_t sessionHandle)
 
 void UWBSessionManager_::deleteAllSessions()
 {
+    while (numSessions > 0)
+        releaseSlot(posSlot[numSessions - 1]);
+}
+
+uwb::Status UWBSessionManager_::runAll(UWBCommandType command)
+{
+    uwb::Status status=uwb::Status::SUCCESS;
+    uwb::Status tmpStatus;
+    UWBCommandBatch batch;
+    bool queued;
+
+    // queue the commands of all the sessions back to back, then wait once;
+    // from the command task itself (a callback) they must run inline
+    bool async = UWBCommandQueue.running() && !UWBCommandQueue.inCommandTask();
+
     for (int i = 0; i < numSessions; ++i)
     {
-        
-        sessions[i]=nullptr;
+        queued = async && UWBCommandQueue.submit(*sessions[i], command, &batch);
+        if (queued)
+            continue;
+
+        switch (command)
+        {
+            case UWBCommandType::INIT:  tmpStatus = sessions[i]->init(); break;
+            case UWBCommandType::START: tmpStatus = sessions[i]->start(); break;
+            case UWBCommandType::STOP:  tmpStatus = sessions[i]->stop(); break;
+            default:                    tmpStatus = uwb::Status::INVALID_PARAM; break;
+        }
+        if (tmpStatus != uwb::Status::SUCCESS)
+            status=tmpStatus;
     }
-    numSessions=0;
+
+    tmpStatus = batch.wait();
+    if (tmpStatus != uwb::Status::SUCCESS)
+        status=tmpStatus;
+    return status;
+}
+
+uwb::Status UWBSessionManager_::initSessions()
+{
+    uwb::Status status = runAll(UWBCommandType::INIT);
+
+    for (int i = 0; i < numSessions; ++i)
+        bindHandle(posSlot[i]);
+    return status;
 }
 
 uwb::Status UWBSessionManager_::startSessions()
+{
+    return runAll(UWBCommandType::START);
+}
+
+uwb::Status UWBSessionManager_::stopSessions()
+{
+    return runAll(UWBCommandType::STOP);
+}
+
+size_t UWBSessionManager_::saveAll(uint8_t* image, size_t maxLen)
+{
+    size_t offset = 0;
+    size_t used;
+
+    for (int i = 0; i < numSessions; ++i)
+    {
+        used = UWBSessionSnapshot::write(*sessions[i], image + offset, maxLen - offset);
+        if (!used)
+            return 0;
+        offset += used;
+    }
+    return offset;
+}
+
+uwb::Status UWBSessionManager_::restoreAll(const uint8_t* image, size_t len, int& restored)
 {
     uwb::Status status=uwb::Status::SUCCESS;
     uwb::Status tmpStatus;
-    
-    for (int i = 0; i < numSessions; ++i)
+    size_t offset = 0;
+    size_t used;
+    int first = numSessions;
+    int slot;
+
+    restored = 0;
+    // decode everything first, straight into the slab, without talking to the UWBS
+    while (offset < len && (slot = allocSlot()) >= 0)
+    {
+        used = UWBSessionSnapshot::read(image + offset, len - offset, *slab[slot]);
+        if (!used)
+        {
+            // end of image (e.g. erased flash) or invalid record
+            freeSlots[numFree++] = slot;
+            break;
+        }
+        offset += used;
+        if (!commitSlot(slot))
+            UWBHAL.Log_W("session ID %08X already in use, skipped", slab[slot]->sessionID());
+    }
+
+    for (int i = first; i < numSessions; ++i)
+    {
+        tmpStatus = sessions[i]->init();
+        if (tmpStatus != uwb::Status::SUCCESS)
+            status=tmpStatus;
+        else
+            bindHandle(posSlot[i]);
+    }
+
+    for (int i = first; i < numSessions; ++i)
     {
-        
         tmpStatus = sessions[i]->start();
         if (tmpStatus != uwb::Status::SUCCESS)
             status=tmpStatus;
+        else
+            restored++;
     }
     return status;
 }
 
-uwb::Status UWBSessionManager_::stopSessions()
+void UWBSessionManager_::autoRecovery(bool enable)
+{
+    if (enable && !recoveryHandlersRegistered)
+    {
+        recoverySem = xSemaphoreCreateBinary();
+        if (recoverySem == NULL ||
+            xTaskCreate(recoveryTask, "uwbRecovery", 1024, this, 2, &recoveryTaskHandle) != pdPASS)
+        {
+            UWBHAL.Log_E("could not start the recovery task");
+            return;
+        }
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::DEVICE_RESET, resetNotificationHandler);
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::RECOVERY_NTF, resetNotificationHandler);
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::ACTION_APP_CLEANUP, resetNotificationHandler);
+        recoveryHandlersRegistered = true;
+    }
+    recoveryEnabled = enable;
+}
+
+void UWBSessionManager_::onRecovery(RecoveryCallbackType callback)
+{
+    recoveryCallback = callback;
+}
+
+const RecoveryStats& UWBSessionManager_::recoveryStats()
+{
+    return stats;
+}
+
+void UWBSessionManager_::resetNotificationHandler(void* data)
+{
+    (void)data;
+    UWBSessionManager_& mgr = getInstance();
+    if (!mgr.recoveryEnabled)
+        return;
+    // runs in the HAL notification context: no UWBS commands here, wake up the task
+    if (mgr.resetTimestamp == 0)
+    {
+        mgr.resetTimestamp = millis();
+        mgr.captureRanging();
+    }
+    xSemaphoreGive(mgr.recoverySem);
+}
+
+void UWBSessionManager_::captureRanging()
+{
+    UWBSessionState state;
+
+    for (int i = 0; i < numSessions; ++i)
+    {
+        // after DEVICE_RESET the states already read DEINIT
+        state = sessions[i]->currentState();
+        if (state == UWBSessionState::DEINIT)
+            state = UWBSessionStates.stateBeforeReset(sessions[i]->sessionHandle());
+        wasRanging[posSlot[i]] = state == UWBSessionState::ACTIVE;
+    }
+}
+
+void UWBSessionManager_::recoveryTask(void* param)
+{
+    UWBSessionManager_* mgr = (UWBSessionManager_*)param;
+    for (;;)
+    {
+        if (xSemaphoreTake(mgr->recoverySem, portMAX_DELAY) == pdTRUE)
+            mgr->recoverSessions();
+    }
+}
+
+uwb::Status UWBSessionManager_::recoverSessions()
 {
     uwb::Status status=uwb::Status::SUCCESS;
-    uwb::Status tmpStatus;
-    
+    uint32_t start = resetTimestamp ? resetTimestamp : millis();
+    bool pending[maxSessions];
+    int numPending = numSessions;
+
+    // called directly, not from a reset notification
+    if (resetTimestamp == 0)
+        captureRanging();
+    UWBHAL.Log_W("recovering %d sessions", numSessions);
     for (int i = 0; i < numSessions; ++i)
+        pending[i] = true;
+
+    for (int attempt = 0; attempt < maxRecoveryAttempts && numPending > 0; ++attempt)
     {
-        tmpStatus = sessions[i]->stop();
-        if (tmpStatus != uwb::Status::SUCCESS)
-            status=tmpStatus;
+        if (recoveryBackoff[attempt])
+            delay(recoveryBackoff[attempt]);
+
+        status = UWBHAL.setDefaultCoreConfigs();
+        if (status != uwb::Status::SUCCESS)
+            continue;
+
+        for (int i = 0; i < numSessions; ++i)
+        {
+            if (!pending[i])
+                continue;
+            // the session may still exist if the UWBS only asked for a cleanup
+            sessions[i]->deInit();
+            status = sessions[i]->init();
+            if (status == uwb::Status::SUCCESS)
+            {
+                bindHandle(posSlot[i]);
+                // sessions only initialized or stopped stay idle
+                if (wasRanging[posSlot[i]])
+                    status = sessions[i]->start();
+            }
+            if (status == uwb::Status::SUCCESS)
+            {
+                pending[i] = false;
+                numPending--;
+            }
+        }
     }
+
+    uint32_t elapsed = millis() - start;
+    resetTimestamp = 0;
+    stats.recoveries++;
+    stats.lastTimeToRecover = elapsed;
+    if (elapsed > stats.maxTimeToRecover)
+        stats.maxTimeToRecover = elapsed;
+    if (numPending > 0)
+    {
+        stats.failures++;
+        UWBHAL.Log_E("recovery failed, %d sessions down", numPending);
+        if (status == uwb::Status::SUCCESS)
+            status = uwb::Status::FAILED;
+    }
+    else
+    {
+        status = uwb::Status::SUCCESS;
+        UWBHAL.Log_I("sessions recovered in %d ms", elapsed);
+    }
+
+    if (recoveryCallback)
+        recoveryCallback(status, elapsed);
     return status;
 }
 
-bool UWBSessionManager_::isIDInUse(uint32_t id)
+void UWBSessionManager_::radioPlan(const uint8_t channels[], uint8_t numChannels, const uint8_t codes[], uint8_t numCodes, uint8_t sfdId)
+{
+    if (numChannels == 0 || numCodes == 0)
+        return;
+    numRadioChannels = numChannels > maxRadioChannels ? maxRadioChannels : numChannels;
+    numRadioCodes = numCodes > maxRadioCodes ? maxRadioCodes : numCodes;
+    memcpy(radioChannels, channels, numRadioChannels);
+    memcpy(radioCodes, codes, numRadioCodes);
+    radioSfdId = sfdId;
+    memset(radioPenalty, 0, sizeof(radioPenalty));
+    // the old assignments refer to the old plan
+    for (int i = 0; i < maxSessions; ++i)
+        radioCombo[i] = -1;
+}
+
+void UWBSessionManager_::autoAllocate(bool enable)
+{
+    radioAuto = enable;
+}
+
+void UWBSessionManager_::onRadioChange(RadioChangeCallbackType callback)
+{
+    radioCallback = callback;
+}
+
+int UWBSessionManager_::radioUsers(int combo, int exceptSlot)
+{
+    int users = 0;
+    for (int i = 0; i < numSessions; ++i)
+    {
+        if (posSlot[i] != exceptSlot && radioCombo[posSlot[i]] == combo)
+            users++;
+    }
+    return users;
+}
+
+int UWBSessionManager_::bestRadioCombo(int slot)
+{
+    int numCombos = numRadioChannels * numRadioCodes;
+    int best = 0;
+    int bestScore = 0x7FFFFFFF;
+    int score;
+
+    // fewest sessions sharing it first, then fewest collisions seen on it
+    for (int k = 0; k < numCombos; ++k)
+    {
+        score = radioUsers(k, slot) * 256 + radioPenalty[k];
+        if (score < bestScore)
+        {
+            bestScore = score;
+            best = k;
+        }
+    }
+    return best;
+}
+
+void UWBSessionManager_::assignRadio(int slot, int combo)
 {
+    UWBSession& sess = *slab[slot];
+
+    radioCombo[slot] = combo;
+    radioSuccess[slot] = 100;
+    radioSamples[slot] = 0;
+    radioCollision[slot] = false;
+
+    // channels alternate first: consecutive combinations are on different channels
+    sess.appParams.channel(radioChannels[combo % numRadioChannels]);
+    sess.appParams.preambleCodeIndex(radioCodes[combo / numRadioChannels]);
+    sess.appParams.sfdId(radioSfdId);
+
+    if (!radioFeedbackRegistered)
+    {
+        NotificationDispatcher::RegisterNotification(uwb::NotificationType::RANGING_DATA, radioFeedbackHandler);
+        radioFeedbackRegistered = true;
+    }
+    UWBHAL.Log_D("session %08X radio: channel %d, preamble %d", sess.sessionID(),
+                 radioChannels[combo % numRadioChannels], radioCodes[combo / numRadioChannels]);
+}
+
+bool UWBSessionManager_::allocateRadio(uint32_t sessionID)
+{
+    uint8_t slot;
+    if (!idMap.find(sessionID, slot))
+        return false;
+    assignRadio(slot, bestRadioCombo(slot));
+    return true;
+}
+
+bool UWBSessionManager_::radioConfig(uint32_t sessionID, UWBRadioConfig& config)
+{
+    uint8_t slot;
+    if (!idMap.find(sessionID, slot) || radioCombo[slot] < 0)
+        return false;
+    config.channel = radioChannels[radioCombo[slot] % numRadioChannels];
+    config.preambleCode = radioCodes[radioCombo[slot] / numRadioChannels];
+    config.sfdId = radioSfdId;
+    return true;
+}
+
+uint8_t UWBSessionManager_::successRate(uint32_t sessionID)
+{
+    uint8_t slot;
+    if (!idMap.find(sessionID, slot) || radioCombo[slot] < 0)
+        return 100;
+    return radioSuccess[slot];
+}
+
+int UWBSessionManager_::repackRadio(bool includeRunning)
+{
+    int moved = 0;
+    int slot, current, best, currentScore;
+    bool running;
+    UWBRadioConfig config;
+
     for (int i = 0; i < numSessions; ++i)
     {
-        if (sessions[i]->sessionID() == id)
+        slot = posSlot[i];
+        current = radioCombo[slot];
+        if (current < 0)
+            continue;
+
+        // a colliding combination is as bad as a shared one
+        currentScore = (radioUsers(current, slot) + (radioCollision[slot] ? 1 : 0)) * 256 + radioPenalty[current];
+        best = bestRadioCombo(slot);
+        if (radioUsers(best, slot) * 256 + radioPenalty[best] >= currentScore)
+            continue;
+
+        UWBSession& sess = *slab[slot];
+        running = sess.currentState() == UWBSessionState::ACTIVE;
+        if (running && !includeRunning)
+            continue;
+        if (running && sess.stop() == uwb::Status::SUCCESS)
+            sess.waitForState(UWBSessionState::IDLE);
+
+        assignRadio(slot, best);
+        // sessions not initialized yet just keep the new values
+        if (sess.reconfigure() == uwb::Status::SESSION_NOT_CONFIGURED)
+            UWBHAL.Log_D("session %08X will use the new radio at init", sess.sessionID());
+
+        radioConfig(sess.sessionID(), config);
+        if (radioCallback)
+            radioCallback(sess, config);
+        if (running)
+            sess.start();
+        moved++;
+    }
+    return moved;
+}
+
+void UWBSessionManager_::radioFeedbackHandler(void* data)
+{
+    UWBRangingData* rangingData = (UWBRangingData*)data;
+    UWBSessionManager_& mgr = getInstance();
+    uint8_t slot;
+    uint8_t total = rangingData->available();
+    uint8_t ok = 0;
+
+    if (!mgr.handleMap.find(rangingData->sessionHandle(), slot) || mgr.radioCombo[slot] < 0)
+        return;
+
+    if (rangingData->measureType() == (uint8_t)uwb::MeasurementType::TWO_WAY)
+    {
+        for (int i = 0; i < total && i < uwb::MAX_RESPONDERS; ++i)
         {
-            return true;
+            if (rangingData->twoWayRangingMeasure()[i].status == 0)
+                ok++;
         }
     }
-    return false;
+    else
+    {
+        ok = total;
+    }
+
+    // one sample per ranging round: failed if no measurement succeeded
+    mgr.radioSuccess[slot] = (mgr.radioSuccess[slot] * 7 + (ok ? 100 : 0)) / 8;
+    if (mgr.radioSamples[slot] < 0xFFFF)
+        mgr.radioSamples[slot]++;
+
+    if (!mgr.radioCollision[slot] && mgr.radioSamples[slot] >= radioMinSamples &&
+        mgr.radioSuccess[slot] < radioCollisionRate)
+    {
+        mgr.radioCollision[slot] = true;
+        if (mgr.radioPenalty[mgr.radioCombo[slot]] < 0xFF)
+            mgr.radioPenalty[mgr.radioCombo[slot]]++;
+        UWBHAL.Log_W("session %08X: possible collision, success rate %d%%",
+                     mgr.slab[slot]->sessionID(), mgr.radioSuccess[slot]);
+    }
+}
+
+bool UWBSessionManager_::isIDInUse(uint32_t id)
+{
+    uint8_t slot;
+    return idMap.find(id, slot);
 }
 
 UWBSessionManager_ &UWBSessionManager_::getInstance()
 {
-    static UWBSessionManager_ instance;
+    static UWBSession storage[maxSessions];
+    static UWBSessionManager_ instance(storage);
 
     return instance;
 }
@@ -6,18 +6,67 @@
 
 #include "UWBSession.hpp"
 #include <ArduinoBLE.h>
+#include <Arduino_FreeRTOS.h>
 #include "NearbySession.hpp"
+#include "UWBIdMap.hpp"
+#include "UWBCommandQueue.hpp"
+
+/**
+ * @brief called at the end of an automatic recovery
+ * 
+ * @param status uwb::Status::SUCCESS if all the sessions were recovered
+ * @param timeToRecover milliseconds from the reset notification to the end of the recovery
+ */
+typedef void (*RecoveryCallbackType)(uwb::Status status, uint32_t timeToRecover);
+
+/**
+ * @brief counters of the automatic session recovery
+ * 
+ */
+struct RecoveryStats {
+    uint32_t recoveries;        // completed recoveries
+    uint32_t failures;          // recoveries that left at least one session down
+    uint32_t lastTimeToRecover; // milliseconds, last recovery
+    uint32_t maxTimeToRecover;  // milliseconds, worst recovery
+};
+/**
+ * @brief radio parameters assigned to a session by the allocator
+ * 
+ */
+struct UWBRadioConfig {
+    uint8_t channel;
+    uint8_t preambleCode;
+    uint8_t sfdId;
+};
+
+/**
+ * @brief called when the allocator moves a session to other radio parameters
+ * 
+ * The peer of the session must be told (e.g. over BLE) to follow, for a 
+ * running session the callback is invoked before it is restarted.
+ * 
+ * @param session the session, already reconfigured
+ * @param config the new radio parameters
+ */
+typedef void (*RadioChangeCallbackType)(UWBSession& session, const UWBRadioConfig& config);
+
 /**
  * @brief Utility class to keep a list of sessions
  * 
+ * The manager owns a copy of every session added to it, stored in a fixed 
+ * slab of maxSessions slots, so no heap is used. Sessions can be looked up 
+ * in constant time by session ID and by session handle.
+ * 
  */
 class UWBSessionManager_ {
 public:
     /**
      * @brief Construct a new UWBSessionManager_ object
      * 
+     * @param storage array of maxSessions sessions used as slab, derived 
+     * managers pass nullptr and provide their own slots with useSlot()
      */
-    UWBSessionManager_();
+    UWBSessionManager_(UWBSession storage[] = nullptr);
     /**
      * @brief deletea session matching a specific session ID
      * 
@@ -28,11 +77,14 @@ public:
     bool deleteSession(uint32_t sessionID);
 
     /**
-     * @brief add a session to the list
+     * @brief add a copy of a session to the list
+     * 
+     * The copy is the session owned by the manager: use getSessionByID() to 
+     * get it, or initSessions() and startSessions() to run all of them.
      * 
      * @param sess 
      * @return true 
-     * @return false 
+     * @return false if the list is full or the session ID is already in use
      */
     bool addSession(UWBSession& sess);
 
@@ -58,9 +110,20 @@ public:
      */
     void deleteAllSessions();
 
+    /**
+     * @brief init all sessions in the list
+     * 
+     * @return uwb::Status 
+     */
+    uwb::Status initSessions();
+
     /**
      * @brief starts all sessions in the list
      * 
+     * When the UWBCommandQueue is running the commands are queued as one 
+     * batch and executed back to back, the same applies to initSessions() 
+     * and stopSessions().
+     * 
      * @return tUWBAPI_STATUS 
      */
     uwb::Status startSessions();
@@ -72,6 +135,149 @@ public:
      */
     uwb::Status stopSessions();
 
+    /**
+     * @brief write a snapshot image of all the sessions in the list
+     * 
+     * @param image destination buffer
+     * @param maxLen size of the buffer
+     * @return size_t bytes written, 0 if the buffer is too small
+     */
+    size_t saveAll(uint8_t* image, size_t maxLen);
+
+    /**
+     * @brief re-create the sessions stored in a snapshot image
+     * 
+     * The image is a sequence of UWBSessionSnapshot records, e.g. read from 
+     * flash. All records are decoded first, then all sessions are initialized
+     * and finally all of them are started, so the UWBS gets the commands
+     * back to back. Array parameters point into the image, that must stay valid.
+     * 
+     * @param image the snapshot image
+     * @param len length of the image
+     * @param restored number of sessions restored
+     * @return uwb::Status 
+     */
+    uwb::Status restoreAll(const uint8_t* image, size_t len, int& restored);
+
+    /**
+     * @brief enable the automatic recovery of the sessions in the list
+     * 
+     * When the UWBS notifies DEVICE_RESET, RECOVERY_NTF or ACTION_APP_CLEANUP 
+     * the sessions are lost. With auto recovery enabled a background task 
+     * restores the core configs and then re-initializes and re-configures 
+     * every session in the list, restarting the ones that were ACTIVE when 
+     * the notification arrived, and retries the failed ones with an 
+     * increasing delay up to maxRecoveryAttempts times.
+     * It is enabled by UWB.begin()
+     * 
+     * @param enable 
+     */
+    void autoRecovery(bool enable);
+
+    /**
+     * @brief register a callback invoked at the end of each automatic recovery
+     * 
+     * @param callback 
+     */
+    void onRecovery(RecoveryCallbackType callback);
+
+    /**
+     * @brief re-initialize and re-configure all the sessions in the list
+     * 
+     * The sessions that were ranging are restarted, the others are left 
+     * idle. This is what the automatic recovery runs, it can also be called 
+     * directly.
+     * 
+     * @return uwb::Status::SUCCESS if all the sessions were recovered
+     */
+    uwb::Status recoverSessions();
+
+    /**
+     * @brief Get the recovery counters
+     * 
+     * @return const RecoveryStats& 
+     */
+    const RecoveryStats& recoveryStats();
+
+    /**
+     * @brief set the radio parameters the allocator can use
+     * 
+     * Every (channel, preamble code) pair is a combination; sessions are 
+     * spread over the combinations alternating the channels first, since a 
+     * different channel isolates better than a different preamble code.
+     * The default plan is channel 9 with the BPRF preamble codes 9 to 12.
+     * 
+     * @param channels list of channels, at most maxRadioChannels
+     * @param numChannels 
+     * @param codes list of preamble code indexes, at most maxRadioCodes
+     * @param numCodes 
+     * @param sfdId SFD ID used by all the sessions
+     */
+    void radioPlan(const uint8_t channels[], uint8_t numChannels, const uint8_t codes[], uint8_t numCodes, uint8_t sfdId = 2);
+
+    /**
+     * @brief let addSession() assign the radio parameters of every new session
+     * 
+     * With the same plan and the same order of addSession() calls, two 
+     * devices compute the same assignment.
+     * 
+     * @param enable 
+     */
+    void autoAllocate(bool enable);
+
+    /**
+     * @brief assign the least used combination to a session in the list
+     * 
+     * Channel, preamble code and SFD ID are written in the session app 
+     * params, a session already initialized applies them with reconfigure().
+     * Combinations where collisions were detected are avoided.
+     * 
+     * @param sessionID 
+     * @return true 
+     * @return false if the session is not in the list
+     */
+    bool allocateRadio(uint32_t sessionID);
+
+    /**
+     * @brief radio parameters assigned to a session
+     * 
+     * @param sessionID 
+     * @param config 
+     * @return true 
+     * @return false if nothing was assigned to the session
+     */
+    bool radioConfig(uint32_t sessionID, UWBRadioConfig& config);
+
+    /**
+     * @brief percentage of successful ranging measurements of a session
+     * 
+     * Exponential average over the last ranging rounds, fed by the ranging 
+     * notifications once the allocator is in use.
+     * 
+     * @param sessionID 
+     * @return uint8_t 100 if nothing was measured yet
+     */
+    uint8_t successRate(uint32_t sessionID);
+
+    /**
+     * @brief move sessions that share a combination, or that collide, to a better one
+     * 
+     * Called automatically when a session is deleted and autoAllocate is 
+     * enabled, with includeRunning false.
+     * 
+     * @param includeRunning also move ranging sessions: they are stopped, 
+     * reconfigured and restarted, see onRadioChange()
+     * @return int number of sessions moved
+     */
+    int repackRadio(bool includeRunning = false);
+
+    /**
+     * @brief register a callback invoked when repackRadio() moves a session
+     * 
+     * @param callback 
+     */
+    void onRadioChange(RadioChangeCallbackType callback);
+
     /**
      * @brief utility method implemented in the NerabySessionManager
      * 
@@ -81,17 +287,96 @@ public:
     virtual NearbySession& find(BLEDevice dev) {(void)dev; };
     static UWBSessionManager_& getInstance();
 
+protected:
+    /**
+     * @brief set the storage of a slot, for managers of derived session types
+     */
+    void useSlot(int index, UWBSession* storage);
+    /**
+     * @brief take a free slot, -1 if none
+     */
+    int allocSlot();
+    /**
+     * @brief add the session stored in an allocated slot to the list
+     * 
+     * @return false if the session ID is already in use, the slot is released
+     */
+    bool commitSlot(int slot);
+    /**
+     * @brief remove the session in the slot from the list and free the slot
+     */
+    void releaseSlot(int slot);
+    /**
+     * @brief update the handle lookup after the session handle changed
+     */
+    void bindHandle(int slot);
+    /**
+     * @brief true if the slot holds a session of the list
+     */
+    bool slotUsed(int slot);
+
 private:
     bool isIDInUse(uint32_t id);
+    uwb::Status runAll(UWBCommandType command);
+    int radioUsers(int combo, int exceptSlot);
+    int bestRadioCombo(int slot);
+    void assignRadio(int slot, int combo);
+    static void radioFeedbackHandler(void* data);
+    static void resetNotificationHandler(void* data);
+    void captureRanging();
+    static void recoveryTask(void* param);
     
     UWBSessionManager_(UWBSessionManager_ const &) = delete;
     void operator=(UWBSessionManager_ const &) = delete;
 
 public:
-    static const int maxSessions = 3;
+    static const int maxSessions = UWB_MAX_SESSIONS;
+    // sessions in the list, packed in the first numSessions elements
     int numSessions;
     UWBSession* sessions[maxSessions];
     UWBSession emptySession;
+
+    static const int maxRecoveryAttempts = 5;
+    static const int maxRadioChannels = 2;
+    static const int maxRadioCodes = 8;
+    static const int maxRadioCombos = maxRadioChannels * maxRadioCodes;
+    // below this success rate, over at least radioMinSamples rounds, a collision is assumed
+    static const uint8_t radioCollisionRate = 50;
+    static const uint16_t radioMinSamples = 16;
+
+private:
+    UWBSession* slab[maxSessions];     // storage of each slot
+    int8_t slotPos[maxSessions];       // position of the slot in sessions[], -1 if free
+    int8_t posSlot[maxSessions];       // slot of each element of sessions[]
+    int8_t freeSlots[maxSessions];
+    int numFree;
+    UWBIdMap<maxSessions> idMap;       // session ID -> slot
+    UWBIdMap<maxSessions> handleMap;   // session handle -> slot
+    uint32_t boundHandle[maxSessions];
+    bool handleBound[maxSessions];
+
+    bool recoveryEnabled;
+    bool recoveryHandlersRegistered;
+    uint32_t resetTimestamp;
+    bool wasRanging[maxSessions];      // slot ACTIVE when the reset was notified
+    SemaphoreHandle_t recoverySem;
+    TaskHandle_t recoveryTaskHandle;
+    RecoveryCallbackType recoveryCallback;
+    RecoveryStats stats;
+
+    uint8_t radioChannels[maxRadioChannels];
+    uint8_t numRadioChannels;
+    uint8_t radioCodes[maxRadioCodes];
+    uint8_t numRadioCodes;
+    uint8_t radioSfdId;
+    bool radioAuto;
+    bool radioFeedbackRegistered;
+    RadioChangeCallbackType radioCallback;
+    int8_t radioCombo[maxSessions];         // combination of each slot, -1 if none
+    uint8_t radioSuccess[maxSessions];      // success rate of each slot, percent
+    uint16_t radioSamples[maxSessions];
+    bool radioCollision[maxSessions];
+    uint8_t radioPenalty[maxRadioCombos];   // collisions detected on each combination
 };
 
 
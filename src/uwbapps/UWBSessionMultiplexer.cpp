@@ -0,0 +1,329 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBSessionMultiplexer.hpp"
+#include "UWBSessionSnapshot.hpp"
+#include "UWBNotification.hpp"
+
+UWBSessionMultiplexer* UWBSessionMultiplexer::active = nullptr;
+
+UWBSessionMultiplexer::UWBSessionMultiplexer(uint8_t hwSlots, uint32_t sliceDuration)
+{
+    numSlots = hwSlots == 0 ? 1 : (hwSlots > maxHwSlots ? maxHwSlots : hwSlots);
+    slice = sliceDuration;
+    poolUsed = 0;
+    numEntries = 0;
+    running = false;
+    beginTime = 0;
+    numFast = 0;
+    numFull = 0;
+    for (int i = 0; i < maxHwSlots; ++i)
+    {
+        slotEntry[i] = -1;
+        slotConfigured[i] = false;
+        slotStart[i] = 0;
+    }
+}
+
+int UWBSessionMultiplexer::addSession(UWBSession& config, uint8_t weight)
+{
+    size_t len;
+
+    if (numEntries >= maxSessions)
+        return -1;
+    len = UWBSessionSnapshot::write(config, &pool[poolUsed], sizeof(pool) - poolUsed);
+    if (!len)
+    {
+        UWBHAL.Log_E("multiplexer pool full");
+        return -1;
+    }
+
+    Entry& e = entries[numEntries];
+    e.offset = poolUsed;
+    e.len = len;
+    e.sessionID = config.sessionID();
+    e.weight = weight ? weight : 1;
+    e.credit = 0;
+    e.results = 0;
+    e.heldTime = 0;
+    poolUsed += len;
+    return numEntries++;
+}
+
+bool UWBSessionMultiplexer::weight(int index, uint8_t weight)
+{
+    if (index < 0 || index >= numEntries)
+        return false;
+    entries[index].weight = weight;
+    return true;
+}
+
+void UWBSessionMultiplexer::clear()
+{
+    if (running)
+        return;
+    numEntries = 0;
+    poolUsed = 0;
+}
+
+int UWBSessionMultiplexer::size()
+{
+    return numEntries;
+}
+
+int UWBSessionMultiplexer::current(int slot)
+{
+    if (slot < 0 || slot >= numSlots)
+        return -1;
+    return slotEntry[slot];
+}
+
+uint32_t UWBSessionMultiplexer::fastSwitches()
+{
+    return numFast;
+}
+
+uint32_t UWBSessionMultiplexer::fullSwitches()
+{
+    return numFull;
+}
+
+int UWBSessionMultiplexer::pickNext(int slot)
+{
+    int total = 0;
+    int best = -1;
+    bool busy;
+
+    // smooth weighted round robin among the sessions that can use this slot:
+    // not running in another slot and not sharing a session ID with one
+    for (int i = 0; i < numEntries; ++i)
+    {
+        if (entries[i].weight == 0)
+            continue;
+        busy = false;
+        for (int s = 0; s < numSlots && !busy; ++s)
+        {
+            if (s != slot && slotEntry[s] >= 0 &&
+                (slotEntry[s] == i || entries[slotEntry[s]].sessionID == entries[i].sessionID))
+                busy = true;
+        }
+        if (busy)
+            continue;
+        entries[i].credit += entries[i].weight;
+        total += entries[i].weight;
+        if (best < 0 || entries[i].credit > entries[best].credit)
+            best = i;
+    }
+    if (best >= 0)
+        entries[best].credit -= total;
+    return best;
+}
+
+void UWBSessionMultiplexer::unload(int slot)
+{
+    UWBSession& hw = slots[slot];
+
+    if (slotEntry[slot] >= 0)
+    {
+        entries[slotEntry[slot]].heldTime += millis() - slotStart[slot];
+        slotEntry[slot] = -1;
+        if (hw.stop() == uwb::Status::SUCCESS)
+            hw.waitForState(UWBSessionState::IDLE);
+    }
+}
+
+uwb::Status UWBSessionMultiplexer::load(int slot, int index)
+{
+    uwb::Status status;
+    UWBSession& hw = slots[slot];
+    UWBSession next;
+
+    unload(slot);
+
+    // the array params of the restored session point into the pool, which
+    // outlives it, except the controlee list: read() copies it into next
+    if (!UWBSessionSnapshot::read(&pool[entries[index].offset], entries[index].len, next))
+        return uwb::Status::INVALID_PARAM;
+
+    if (slotConfigured[slot] && next.sessionID() == hw.sessionID() && next.sessionType() == hw.sessionType())
+    {
+        // same UWBS session: only send what differs from the previous tag
+        hw.rangingParams = next.rangingParams;
+        hw.appParams = next.appParams;
+        hw.vendorParams = next.vendorParams;
+        // the controlee list still points into next, a local
+        hw.adoptControlees();
+        status = hw.reconfigure();
+        numFast++;
+    }
+    else
+    {
+        if (slotConfigured[slot])
+        {
+            if (hw.deInit() == uwb::Status::SUCCESS)
+                hw.waitForState(UWBSessionState::DEINIT);
+            slotConfigured[slot] = false;
+        }
+        hw = next;
+        status = hw.init();
+        slotConfigured[slot] = (status == uwb::Status::SUCCESS);
+        numFull++;
+    }
+
+    if (status == uwb::Status::SUCCESS)
+        status = hw.start();
+    if (status != uwb::Status::SUCCESS)
+    {
+        UWBHAL.Log_E("multiplexer could not switch slot %d to session %d: %d", slot, index, status);
+        return status;
+    }
+    slotEntry[slot] = index;
+    slotStart[slot] = millis();
+    return status;
+}
+
+uwb::Status UWBSessionMultiplexer::begin()
+{
+    uwb::Status status = uwb::Status::SUCCESS;
+    uwb::Status tmpStatus;
+    int next;
+
+    if (running)
+        return uwb::Status::SUCCESS;
+    if (active != nullptr)
+        return uwb::Status::REJECTED;
+
+    for (int i = 0; i < numEntries; ++i)
+    {
+        entries[i].credit = 0;
+        entries[i].results = 0;
+        entries[i].heldTime = 0;
+    }
+    numFast = 0;
+    numFull = 0;
+    active = this;
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::RANGING_DATA, rangingHandler);
+    beginTime = millis();
+    running = true;
+
+    for (int s = 0; s < numSlots; ++s)
+    {
+        next = pickNext(s);
+        if (next < 0)
+            break;
+        tmpStatus = load(s, next);
+        if (tmpStatus != uwb::Status::SUCCESS)
+            status = tmpStatus;
+    }
+    return status;
+}
+
+void UWBSessionMultiplexer::end()
+{
+    if (!running)
+        return;
+    for (int s = 0; s < numSlots; ++s)
+    {
+        unload(s);
+        if (slotConfigured[s])
+        {
+            slots[s].deInit();
+            slotConfigured[s] = false;
+        }
+    }
+    running = false;
+    active = nullptr;
+}
+
+void UWBSessionMultiplexer::update()
+{
+    int next;
+
+    if (!running)
+        return;
+    for (int s = 0; s < numSlots; ++s)
+    {
+        if (slotEntry[s] >= 0 && millis() - slotStart[s] < slice)
+            continue;
+        next = pickNext(s);
+        if (next < 0)
+        {
+            // nothing else to run, but a suspended session must leave the slot
+            if (slotEntry[s] >= 0 && entries[slotEntry[s]].weight == 0)
+                unload(s);
+            continue;
+        }
+        if (next == slotEntry[s])
+        {
+            // picked again: keep it running for another slice
+            entries[next].heldTime += millis() - slotStart[s];
+            slotStart[s] = millis();
+            continue;
+        }
+        load(s, next);
+    }
+}
+
+float UWBSessionMultiplexer::effectiveRate(int index)
+{
+    uint32_t elapsed = millis() - beginTime;
+
+    if (index < 0 || index >= numEntries || elapsed == 0)
+        return 0;
+    return entries[index].results * 1000.0f / elapsed;
+}
+
+float UWBSessionMultiplexer::dutyCycle(int index)
+{
+    uint32_t elapsed = millis() - beginTime;
+    uint32_t held;
+
+    if (index < 0 || index >= numEntries || elapsed == 0)
+        return 0;
+    held = entries[index].heldTime;
+    for (int s = 0; s < numSlots; ++s)
+    {
+        if (slotEntry[s] == index)
+            held += millis() - slotStart[s];
+    }
+    return (float)held / elapsed;
+}
+
+void UWBSessionMultiplexer::printStats(Print& out)
+{
+    out.print("switches fast/full: ");
+    out.print(numFast);
+    out.print("/");
+    out.println(numFull);
+    for (int i = 0; i < numEntries; ++i)
+    {
+        out.print("session ");
+        out.print(i);
+        out.print(" id 0x");
+        out.print(entries[i].sessionID, HEX);
+        out.print(" weight ");
+        out.print(entries[i].weight);
+        out.print(" duty ");
+        out.print(dutyCycle(i));
+        out.print(" rate ");
+        out.print(effectiveRate(i));
+        out.println(" Hz");
+    }
+}
+
+void UWBSessionMultiplexer::rangingHandler(void* data)
+{
+    UWBRangingData* rangingData = (UWBRangingData*)data;
+    UWBSessionMultiplexer* mux = active;
+
+    if (mux == nullptr)
+        return;
+    for (int s = 0; s < mux->numSlots; ++s)
+    {
+        if (mux->slotEntry[s] >= 0 && mux->slots[s].sessionHandle() == rangingData->sessionHandle())
+        {
+            mux->entries[mux->slotEntry[s]].results++;
+            return;
+        }
+    }
+}
@@ -0,0 +1,179 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBSESSIONMULTIPLEXER_HPP
+#define UWBSESSIONMULTIPLEXER_HPP
+
+#include <Arduino.h>
+#include "UWBSession.hpp"
+#include "UWBSessionManager.hpp"
+
+// Maximum number of logical sessions held by a multiplexer
+#ifndef UWB_MUX_MAX_SESSIONS
+#define UWB_MUX_MAX_SESSIONS 64
+#endif
+
+// Bytes reserved for the snapshots of the logical sessions, about 100 bytes
+// are needed for a typical anchor configuration
+#ifndef UWB_MUX_POOL_SIZE
+#define UWB_MUX_POOL_SIZE (UWB_MUX_MAX_SESSIONS * 128)
+#endif
+
+/**
+ * @brief Time-sliced multiplexer of logical sessions over the UWBS sessions
+ *
+ * The UWBS can only run a few sessions at once. The multiplexer keeps a
+ * large pool of logical sessions, stored as compact snapshots, and cycles
+ * them through a small number of hardware session slots. Each slot runs
+ * one logical session for a time slice, then switches to the next one
+ * chosen by a smooth weighted round robin: a logical session with weight 2
+ * gets twice the slices of one with weight 1.
+ *
+ * Switching is cheap when the next logical session has the same session ID
+ * as the one leaving the slot (e.g. one anchor session ranging with many
+ * tags that differ only by MAC address or preamble): the slot is stopped,
+ * only the parameters that differ are sent with UWBSession::reconfigure(),
+ * and the slot is restarted. Otherwise the slot is deinitialized and the
+ * next session initialized from scratch.
+ *
+ * The multiplexer counts the ranging notifications of every logical
+ * session and reports the update rate each one actually gets.
+ *
+ * Usage: add the logical sessions, call begin(), then call update() from
+ * loop(). Only one multiplexer can run at a time. The hardware slots are
+ * owned by the multiplexer, not by UWBSessionManager.
+ *
+ */
+class UWBSessionMultiplexer {
+public:
+    static const int maxSessions = UWB_MUX_MAX_SESSIONS;
+    static const int maxHwSlots = UWB_MAX_SESSIONS;
+
+    /**
+     * @brief Construct a new UWBSessionMultiplexer object
+     *
+     * @param hwSlots number of UWBS sessions to use, at most maxHwSlots
+     * @param sliceDuration milliseconds a logical session keeps a slot
+     */
+    UWBSessionMultiplexer(uint8_t hwSlots = 1, uint32_t sliceDuration = 1000);
+
+    /**
+     * @brief add a logical session
+     *
+     * The configuration is copied, the session can be discarded afterwards.
+     *
+     * @param config the session configuration
+     * @param weight relative share of slices, at least 1
+     * @return int index of the logical session, -1 if the pool is full
+     */
+    int addSession(UWBSession& config, uint8_t weight = 1);
+
+    /**
+     * @brief change the weight of a logical session
+     *
+     * @param index
+     * @param weight 0 suspends the session
+     * @return true
+     * @return false if the index is not valid
+     */
+    bool weight(int index, uint8_t weight);
+
+    /**
+     * @brief remove all the logical sessions, only while not running
+     */
+    void clear();
+
+    /**
+     * @brief number of logical sessions
+     */
+    int size();
+
+    /**
+     * @brief fill the hardware slots and start ranging
+     *
+     * @return uwb::Status
+     */
+    uwb::Status begin();
+
+    /**
+     * @brief stop and deinit the hardware slots
+     */
+    void end();
+
+    /**
+     * @brief switch the slots whose time slice expired, call it from loop()
+     */
+    void update();
+
+    /**
+     * @brief ranging results per second received for a logical session since begin()
+     *
+     * @param index
+     * @return float
+     */
+    float effectiveRate(int index);
+
+    /**
+     * @brief fraction of time a logical session held a slot since begin()
+     *
+     * @param index
+     * @return float between 0 and 1
+     */
+    float dutyCycle(int index);
+
+    /**
+     * @brief logical session running in a hardware slot
+     *
+     * @param slot
+     * @return int index of the logical session, -1 if the slot is empty
+     */
+    int current(int slot);
+
+    /**
+     * @brief number of switches done with reconfigure() and with a full init
+     */
+    uint32_t fastSwitches();
+    uint32_t fullSwitches();
+
+    /**
+     * @brief print the schedule statistics
+     */
+    void printStats(Print& out);
+
+private:
+    struct Entry {
+        uint32_t offset;        // snapshot position in the pool
+        uint16_t len;
+        uint32_t sessionID;
+        uint8_t weight;
+        int32_t credit;         // smooth weighted round robin state
+        uint32_t results;       // ranging notifications received
+        uint32_t heldTime;      // milliseconds spent in a slot
+    };
+
+    int pickNext(int slot);
+    uwb::Status load(int slot, int index);
+    void unload(int slot);
+    static void rangingHandler(void* data);
+
+    Entry entries[maxSessions];
+    uint8_t pool[UWB_MUX_POOL_SIZE];
+    size_t poolUsed;
+    int numEntries;
+
+    UWBSession slots[maxHwSlots];
+    int slotEntry[maxHwSlots];      // logical session in each slot, -1 if none
+    bool slotConfigured[maxHwSlots];
+    uint32_t slotStart[maxHwSlots];
+    uint8_t numSlots;
+    uint32_t slice;
+
+    bool running;
+    uint32_t beginTime;
+    uint32_t numFast;
+    uint32_t numFull;
+
+    static UWBSessionMultiplexer* active;
+};
+
+#endif /* UWBSESSIONMULTIPLEXER_HPP */
@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBSessionSnapshot.hpp"
+
+static void putU16(uint8_t* p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+}
+
+static void putU32(uint8_t* p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+}
+
+static uint16_t getU16(const uint8_t* p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t getU32(const uint8_t* p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+template <typename T> static size_t writeParams(T* params, unsigned int count, uint8_t* out, size_t maxLen)
+{
+    size_t pos = 0;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (params[i].param_type == uwb::AppParamType::ARRAY_U8)
+        {
+            uint16_t len = params[i].param_value.au8.param_len;
+            if (len > 0xFF || pos + 3 + len > maxLen)
+                return 0;
+            out[pos++] = (uint8_t)params[i].param_id;
+            out[pos++] = (uint8_t)params[i].param_type;
+            out[pos++] = (uint8_t)len;
+            memcpy(&out[pos], params[i].param_value.au8.param_value, len);
+            pos += len;
+        }
+        else
+        {
+            if (pos + 6 > maxLen)
+                return 0;
+            out[pos++] = (uint8_t)params[i].param_id;
+            out[pos++] = (uint8_t)params[i].param_type;
+            putU32(&out[pos], params[i].param_value.vu32);
+            pos += 4;
+        }
+    }
+    return pos;
+}
+
+template <typename T, typename P1, typename L> static size_t readParams(const uint8_t* in, size_t len, uint8_t count, L& list)
+{
+    size_t pos = 0;
+    list.clear();
+    for (uint8_t i = 0; i < count; i++)
+    {
+        T param;
+        if (pos + 2 > len)
+            return 0;
+        param.param_id = (P1)in[pos++];
+        param.param_type = (uwb::AppParamType)in[pos++];
+        if (param.param_type == uwb::AppParamType::ARRAY_U8)
+        {
+            if (pos + 1 > len || pos + 1 + in[pos] > len)
+                return 0;
+            param.param_value.au8.param_len = in[pos++];
+            // zero-copy: the HAL only reads array values
+            param.param_value.au8.param_value = const_cast<uint8_t*>(&in[pos]);
+            pos += param.param_value.au8.param_len;
+        }
+        else
+        {
+            if (pos + 4 > len)
+                return 0;
+            param.param_value.vu32 = getU32(&in[pos]);
+            pos += 4;
+        }
+        if (!list.addOrUpdateParam(param))
+            return 0;
+    }
+    return pos;
+}
+
+size_t UWBSessionSnapshot::write(UWBSession& sess, uint8_t* out, size_t maxLen)
+{
+    if (maxLen < HEADER_SIZE + CRC_SIZE)
+        return 0;
+
+    out[0] = MAGIC_0;
+    out[1] = MAGIC_1;
+    out[2] = VERSION;
+    putU32(&out[5], sess.sessionID());
+    out[9] = (uint8_t)sess.sessionType();
+    out[10] = (uint8_t)sess.rangingParams.deviceRole();
+    out[11] = (uint8_t)sess.rangingParams.deviceType();
+    out[12] = (uint8_t)sess.rangingParams.multiNodeMode();
+    out[13] = sess.rangingParams.macAddrMode();
+    out[14] = (uint8_t)sess.rangingParams.rangingRoundUsage();
+    out[15] = (uint8_t)sess.rangingParams.scheduledMode();
+    memcpy(&out[16], sess.rangingParams.deviceMacAddr(), MAC_EXT_ADD_LEN);
+    out[24] = (uint8_t)sess.appParams.getSize();
+    out[25] = (uint8_t)sess.vendorParams.getSize();
+
+    size_t pos = HEADER_SIZE;
+    size_t avail = maxLen - CRC_SIZE;
+    size_t used;
+
+    if (sess.appParams.getSize())
+    {
+        used = writeParams(sess.appParams.getParamsList(), sess.appParams.getSize(), &out[pos], avail - pos);
+        if (!used)
+            return 0;
+        pos += used;
+    }
+    if (sess.vendorParams.getSize())
+    {
+        used = writeParams(sess.vendorParams.getParamsList(), sess.vendorParams.getSize(), &out[pos], avail - pos);
+        if (!used)
+            return 0;
+        pos += used;
+    }
+
+    putU16(&out[3], (uint16_t)(pos + CRC_SIZE));
+    putU16(&out[pos], crc16(out, pos));
+    return pos + CRC_SIZE;
+}
+
+size_t UWBSessionSnapshot::read(const uint8_t* in, size_t len, UWBSession& sess)
+{
+    if (len < HEADER_SIZE + CRC_SIZE || in[0] != MAGIC_0 || in[1] != MAGIC_1)
+        return 0;
+    if (in[2] != VERSION)
+    {
+        UWBHAL.Log_W("unsupported snapshot version %d", in[2]);
+        return 0;
+    }
+    size_t recordLen = getU16(&in[3]);
+    if (recordLen < HEADER_SIZE + CRC_SIZE || recordLen > len)
+        return 0;
+    size_t end = recordLen - CRC_SIZE;
+    if (crc16(in, end) != getU16(&in[end]))
+    {
+        UWBHAL.Log_E("snapshot CRC mismatch");
+        return 0;
+    }
+
+    uwb::RangingConfig config;
+    config.device_role = (uwb::DeviceRole)in[10];
+    config.device_type = (uwb::DeviceType)in[11];
+    config.multi_node_mode = (uwb::MultiNodeMode)in[12];
+    config.mac_addr_mode = in[13];
+    config.ranging_method = (uwb::RangingMethod)in[14];
+    config.scheduled_mode = (uwb::ScheduledMode)in[15];
+    memcpy(config.device_mac_addr, &in[16], MAC_EXT_ADD_LEN);
+
+    // decoded apart, a corrupt record must leave the session untouched
+    UWBAppParamList appParams;
+    UWBVendorParamList vendorParams;
+    size_t pos = HEADER_SIZE;
+    size_t used = readParams<uwb::AppConfig, uwb::AppConfigId>(&in[pos], end - pos, in[24], appParams);
+    if (in[24] && !used)
+        return 0;
+    pos += used;
+    used = readParams<uwb::VendorAppConfig, uwb::VendorAppConfigId>(&in[pos], end - pos, in[25], vendorParams);
+    if (in[25] && !used)
+        return 0;
+    pos += used;
+    if (pos != end)
+        return 0;
+
+    sess.sessionID(getU32(&in[5]));
+    sess.sessionType((uwb::SessionType)in[9]);
+    sess.rangingParams = UWBRangingParams(config);
+    sess.appParams = appParams;
+    sess.vendorParams = vendorParams;
+    sess.adoptControlees();
+    return recordLen;
+}
+
+uint16_t UWBSessionSnapshot::crc16(const uint8_t* data, size_t len)
+{
+    uint16_t crc = 0xFFFF;
+    for (size_t i = 0; i < len; i++)
+    {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t b = 0; b < 8; b++)
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+    return crc;
+}
@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBSESSIONSNAPSHOT_HPP
+#define UWBSESSIONSNAPSHOT_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "UWBSession.hpp"
+
+/**
+ * @brief Binary serialization of a complete UWBSession
+ *
+ * A snapshot record holds the session ID and type, the ranging (core)
+ * parameters, the application parameters and the vendor parameters. Records
+ * can be concatenated to build an image of several sessions, which can be
+ * stored in flash (or in a file on Linux) and restored at boot or after a
+ * device reset with UWBSessionManager.restoreAll().
+ *
+ * Record layout, all fields little endian:
+ *
+ * | offset | size | field                                              |
+ * |--------|------|----------------------------------------------------|
+ * | 0      | 2    | magic 'U' 'S'                                      |
+ * | 2      | 1    | format version                                     |
+ * | 3      | 2    | record length, including header and CRC            |
+ * | 5      | 4    | session ID                                         |
+ * | 9      | 1    | session type                                       |
+ * | 10     | 6    | role, type, multi node, mac mode, method, schedule |
+ * | 16     | 8    | device MAC address                                 |
+ * | 24     | 1    | number of app params                               |
+ * | 25     | 1    | number of vendor params                            |
+ * | 26     | ...  | params: id, type, then u32 value or length + bytes |
+ * | len-2  | 2    | CRC-16/CCITT of all previous bytes                 |
+ *
+ * Reading is zero-copy: array parameters of the restored session point
+ * directly into the record, so the buffer must stay valid for as long as the
+ * session uses it (which is always the case for flash or a mapped file).
+ */
+class UWBSessionSnapshot {
+public:
+    static const uint8_t VERSION = 1;
+    static const uint8_t MAGIC_0 = 'U';
+    static const uint8_t MAGIC_1 = 'S';
+    static const size_t HEADER_SIZE = 26;
+    static const size_t CRC_SIZE = 2;
+
+    /**
+     * @brief serialize a session
+     *
+     * @param sess the session to serialize
+     * @param out destination buffer
+     * @param maxLen size of the destination buffer
+     * @return size_t number of bytes written, 0 if the buffer is too small
+     */
+    static size_t write(UWBSession& sess, uint8_t* out, size_t maxLen);
+
+    /**
+     * @brief restore a session from a record
+     *
+     * @param in the record
+     * @param len bytes available from in
+     * @param sess the session to fill in
+     * @return size_t number of bytes consumed, 0 if no valid record was found
+     */
+    static size_t read(const uint8_t* in, size_t len, UWBSession& sess);
+
+private:
+    static uint16_t crc16(const uint8_t* data, size_t len);
+};
+
+#endif /* UWBSESSIONSNAPSHOT_HPP */
@@ -0,0 +1,227 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include "UWBSessionState.hpp"
+#include "UWBNotification.hpp"
+
+UWBSessionStates_::UWBSessionStates_()
+{
+    for (int i = 0; i < maxEntries; ++i)
+        entries[i].used = false;
+    for (int i = 0; i < maxWaiters; ++i)
+    {
+        waiters[i].sem = NULL;
+        waiters[i].waiting = false;
+    }
+    lock = NULL;
+}
+
+bool UWBSessionStates_::begin()
+{
+    if (lock != NULL)
+        return true;
+
+    for (int i = 0; i < maxWaiters; ++i)
+    {
+        waiters[i].sem = xSemaphoreCreateBinary();
+        if (waiters[i].sem == NULL)
+        {
+            UWBHAL.Log_E("could not create the session state semaphores");
+            return false;
+        }
+    }
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL)
+    {
+        UWBHAL.Log_E("could not create the session state semaphores");
+        return false;
+    }
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::SESSION_DATA, sessionInfoHandler);
+    NotificationDispatcher::RegisterNotification(uwb::NotificationType::DEVICE_RESET, resetHandler);
+    return true;
+}
+
+UWBSessionStates_::Entry* UWBSessionStates_::findEntry(uint32_t sessionHandle)
+{
+    for (int i = 0; i < maxEntries; ++i)
+    {
+        if (entries[i].used && entries[i].handle == sessionHandle)
+            return &entries[i];
+    }
+    return nullptr;
+}
+
+// an entry never holds a live session, only free or deinitialized ones are reused
+UWBSessionStates_::Entry* UWBSessionStates_::freeEntry()
+{
+    Entry* deinit = nullptr;
+
+    for (int i = 0; i < maxEntries; ++i)
+    {
+        if (!entries[i].used)
+            return &entries[i];
+        if (entries[i].state != (uint8_t)UWBSessionState::DEINIT)
+            continue;
+        // keep the state before a reset as long as possible, a recovery may still need it
+        if (deinit == nullptr || (deinit->beforeReset != (uint8_t)UWBSessionState::UNKNOWN &&
+                                  entries[i].beforeReset == (uint8_t)UWBSessionState::UNKNOWN))
+            deinit = &entries[i];
+    }
+    return deinit;
+}
+
+// called with the lock held
+void UWBSessionStates_::wake(uint32_t sessionHandle)
+{
+    for (int i = 0; i < maxWaiters; ++i)
+    {
+        if (waiters[i].waiting && waiters[i].handle == sessionHandle)
+            xSemaphoreGive(waiters[i].sem);
+    }
+}
+
+UWBSessionState UWBSessionStates_::state(uint32_t sessionHandle)
+{
+    Entry* e = findEntry(sessionHandle);
+    return e ? (UWBSessionState)e->state : UWBSessionState::UNKNOWN;
+}
+
+uint8_t UWBSessionStates_::reason(uint32_t sessionHandle)
+{
+    Entry* e = findEntry(sessionHandle);
+    return e ? e->reason : 0;
+}
+
+UWBSessionState UWBSessionStates_::stateBeforeReset(uint32_t sessionHandle)
+{
+    Entry* e = findEntry(sessionHandle);
+    return e ? (UWBSessionState)e->beforeReset : UWBSessionState::UNKNOWN;
+}
+
+void UWBSessionStates_::update(uwb::SessionInfo& info)
+{
+    Entry* e;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    e = findEntry(info.sessionHandle);
+    if (e == nullptr)
+    {
+        e = freeEntry();
+        if (e == nullptr)
+        {
+            xSemaphoreGive(lock);
+            UWBHAL.Log_E("no room for the state of session %08X", info.sessionHandle);
+            return;
+        }
+        e->used = true;
+        e->handle = info.sessionHandle;
+    }
+    e->state = info.state;
+    e->beforeReset = (uint8_t)UWBSessionState::UNKNOWN;
+    e->reason = info.reason_code;
+    wake(info.sessionHandle);
+    xSemaphoreGive(lock);
+
+    UWBHAL.Log_D("session %08X state %d reason %d", info.sessionHandle, info.state, info.reason_code);
+}
+
+void UWBSessionStates_::created(uint32_t sessionHandle)
+{
+    uwb::SessionInfo info;
+
+    if (lock == NULL)
+        return;
+    info.sessionHandle = sessionHandle;
+    info.state = (uint8_t)UWBSessionState::INIT;
+    info.reason_code = 0;
+    update(info);
+}
+
+uwb::Status UWBSessionStates_::waitFor(uint32_t sessionHandle, UWBSessionState state, uint32_t timeout)
+{
+    uwb::Status status = uwb::Status::TIMEOUT;
+    uint32_t start = millis();
+    uint32_t elapsed;
+    UWBSessionState current;
+    Waiter* w = nullptr;
+
+    if (lock == NULL)
+        return uwb::Status::NOT_INITIALIZED;
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    for (int i = 0; i < maxWaiters && w == nullptr; ++i)
+    {
+        if (!waiters[i].waiting)
+            w = &waiters[i];
+    }
+    if (w == nullptr)
+    {
+        xSemaphoreGive(lock);
+        return uwb::Status::MAX_SESSIONS_EXCEEDED;
+    }
+    // registered under the lock: a notification arriving now is not lost
+    xSemaphoreTake(w->sem, 0);
+    w->handle = sessionHandle;
+    w->waiting = true;
+    xSemaphoreGive(lock);
+
+    for (;;)
+    {
+        current = this->state(sessionHandle);
+        if (current == state)
+        {
+            status = uwb::Status::SUCCESS;
+            break;
+        }
+        if (current == UWBSessionState::DEINIT)
+        {
+            status = uwb::Status::SESSION_NOT_EXIST;
+            break;
+        }
+        elapsed = millis() - start;
+        if (elapsed >= timeout ||
+            xSemaphoreTake(w->sem, pdMS_TO_TICKS(timeout - elapsed)) != pdTRUE)
+            break;
+    }
+
+    xSemaphoreTake(lock, portMAX_DELAY);
+    w->waiting = false;
+    xSemaphoreGive(lock);
+    return status;
+}
+
+void UWBSessionStates_::sessionInfoHandler(void* data)
+{
+    getInstance().update(*(uwb::SessionInfo*)data);
+}
+
+void UWBSessionStates_::resetHandler(void* data)
+{
+    (void)data;
+    UWBSessionStates_& st = getInstance();
+    Entry* e;
+
+    // the UWBS dropped all its sessions: release the tasks waiting on them
+    xSemaphoreTake(st.lock, portMAX_DELAY);
+    for (int i = 0; i < maxEntries; ++i)
+    {
+        e = &st.entries[i];
+        // a session already down keeps the state it had at the previous reset
+        if (e->used && e->state != (uint8_t)UWBSessionState::DEINIT)
+        {
+            e->beforeReset = e->state;
+            e->state = (uint8_t)UWBSessionState::DEINIT;
+            e->reason = 0;
+            st.wake(e->handle);
+        }
+    }
+    xSemaphoreGive(st.lock);
+}
+
+UWBSessionStates_ &UWBSessionStates_::getInstance()
+{
+    static UWBSessionStates_ instance;
+    return instance;
+}
+
+UWBSessionStates_ &UWBSessionStates = UWBSessionStates.getInstance();
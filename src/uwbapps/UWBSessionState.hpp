@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBSESSIONSTATE_HPP
+#define UWBSESSIONSTATE_HPP
+
+#include <Arduino.h>
+#include <Arduino_FreeRTOS.h>
+#include "hal/uwb_hal.hpp"
+
+// Maximum number of sessions kept by a session manager, fixed at compile time.
+// The storage for all of them is allocated statically.
+#ifndef UWB_MAX_SESSIONS
+#define UWB_MAX_SESSIONS 3
+#endif
+
+/**
+ * @brief session states reported by the UWBS in the session status notification
+ *
+ */
+enum class UWBSessionState : uint8_t {
+    INIT = 0x00,        // session created, not configured yet
+    DEINIT = 0x01,      // session removed
+    ACTIVE = 0x02,      // ranging
+    IDLE = 0x03,        // configured, not ranging
+    UNKNOWN = 0xFF      // no notification received for the session
+};
+
+/**
+ * @brief tracks the state of every session from the SESSION_DATA notifications
+ *
+ * The state machine is driven by the UWBS only: no polling is done. Tasks
+ * can wait for a transition with waitFor(), they are woken up by the
+ * notification that reaches the requested state.
+ *
+ * A new session takes a free entry or the one of a deinitialized session:
+ * the entries of live sessions are never reused. When the table is full
+ * the new session is not tracked and its state stays UNKNOWN.
+ *
+ */
+class UWBSessionStates_ {
+public:
+    /**
+     * @brief register the notification handlers (automatically called by UWB.begin())
+     *
+     * @return true
+     * @return false if the synchronization objects could not be created
+     */
+    bool begin();
+
+    /**
+     * @brief last state notified for a session
+     *
+     * @param sessionHandle
+     * @return UWBSessionState UNKNOWN if nothing was notified yet
+     */
+    UWBSessionState state(uint32_t sessionHandle);
+
+    /**
+     * @brief reason code of the last notification for a session
+     *
+     * @param sessionHandle
+     * @return uint8_t 0 if the transition was requested by the host
+     */
+    uint8_t reason(uint32_t sessionHandle);
+
+    /**
+     * @brief state of a session when the UWBS notified its last reset
+     *
+     * The reset moves every session to DEINIT, this is the state it was
+     * in before, e.g. to restart only the sessions that were ranging.
+     *
+     * @param sessionHandle
+     * @return UWBSessionState UNKNOWN if no reset was notified for the session
+     */
+    UWBSessionState stateBeforeReset(uint32_t sessionHandle);
+
+    /**
+     * @brief mark a session handle as just created
+     *
+     * Handles can be reused by the UWBS: this drops the state left by a
+     * previous session with the same handle.
+     *
+     * @param sessionHandle
+     */
+    void created(uint32_t sessionHandle);
+
+    /**
+     * @brief wait until the session reaches a state
+     *
+     * @param sessionHandle
+     * @param state
+     * @param timeout milliseconds
+     * @return uwb::Status::SUCCESS when the state is reached
+     * @return uwb::Status::TIMEOUT if it is not reached in time
+     * @return uwb::Status::SESSION_NOT_EXIST if the session is deinitialized meanwhile
+     * @return uwb::Status::NOT_INITIALIZED if begin() was not called
+     * @return uwb::Status::MAX_SESSIONS_EXCEEDED if too many tasks are waiting
+     */
+    uwb::Status waitFor(uint32_t sessionHandle, UWBSessionState state, uint32_t timeout = uwb::UWB_CMD_TIMEOUT);
+
+    static UWBSessionStates_& getInstance();
+
+    // the live sessions, and as many deinitialized ones for stateBeforeReset()
+    static const int maxEntries = 2 * UWB_MAX_SESSIONS;
+    static const int maxWaiters = 4;
+
+private:
+    struct Entry {
+        uint32_t handle;
+        uint8_t state;
+        uint8_t reason;
+        uint8_t beforeReset;
+        bool used;
+    };
+    struct Waiter {
+        uint32_t handle;
+        SemaphoreHandle_t sem;
+        bool waiting;
+    };
+
+    UWBSessionStates_();
+    UWBSessionStates_(UWBSessionStates_ const &) = delete;
+    void operator=(UWBSessionStates_ const &) = delete;
+
+    Entry* findEntry(uint32_t sessionHandle);
+    Entry* freeEntry();
+    void wake(uint32_t sessionHandle);
+    void update(uwb::SessionInfo& info);
+    static void sessionInfoHandler(void* data);
+    static void resetHandler(void* data);
+
+    Entry entries[maxEntries];
+    Waiter waiters[maxWaiters];
+    SemaphoreHandle_t lock;
+};
+
+extern UWBSessionStates_ &UWBSessionStates;
+
+#endif
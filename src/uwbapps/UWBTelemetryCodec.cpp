@@ -0,0 +1,373 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#include <string.h>
+#include "UWBTelemetryCodec.hpp"
+
+static const uint8_t keyFlag = 0x80;
+static const uint8_t extendedFlag = 0x40;
+static const uint8_t frameMask = 0x3F;
+
+static const uint8_t peerMask = 0x0F;
+static const uint8_t newPeerFlag = 0x10;
+static const uint8_t errorFlag = 0x20;
+static const uint8_t aoaFlag = 0x40;
+static const uint8_t nlosFlag = 0x80;
+
+static_assert(UWB_TELEMETRY_PEERS <= peerMask + 1, "the peer index of a measurement has 4 bits");
+
+// sequence, count, then flags, long address, distance and AoA per measurement
+static const size_t maxRoundSize = 5 + 1 + uwb::MAX_RESPONDERS * (1 + 8 + 5 + 3);
+
+static void putVarint(uint8_t* out, size_t& pos, uint32_t v)
+{
+    while (v >= 0x80)
+    {
+        out[pos++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    out[pos++] = v;
+}
+
+static bool getVarint(const uint8_t* in, size_t len, size_t& pos, uint32_t& v)
+{
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7)
+    {
+        if (pos >= len)
+            return false;
+        v |= (uint32_t)(in[pos] & 0x7F) << shift;
+        if (!(in[pos++] & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+static int16_t clamp(int32_t v, int16_t lo, int16_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+UWBTelemetryEncoder::UWBTelemetryEncoder(uint8_t resyncEvery, uint8_t distanceStep)
+    : resync(resyncEvery ? resyncEvery : 1), step(distanceStep ? distanceStep : 1)
+{
+    counter = 0;
+    frameNumber = 0;
+    forceKey = true;
+    state.seq = 0;
+    state.numPeers = 0;
+    buf = nullptr;
+    bufSize = 0;
+    used = 0;
+    numRounds = 0;
+    key = false;
+    extended = false;
+}
+
+void UWBTelemetryEncoder::begin(uint8_t* frame, size_t size)
+{
+    // the previous frame is done, if it was worth sending
+    if (numRounds > 0)
+    {
+        frameNumber = (frameNumber + 1) & frameMask;
+        if (++counter >= resync)
+            counter = 0;
+    }
+    key = forceKey || counter == 0;
+    if (key)
+    {
+        forceKey = false;
+        counter = 0;
+        state.numPeers = 0;
+    }
+
+    buf = frame;
+    bufSize = size;
+    numRounds = 0;
+    extended = false;
+    used = 0;
+    if (buf != nullptr && bufSize > 0)
+    {
+        buf[0] = (key ? keyFlag : 0) | frameNumber;
+        used = 1;
+    }
+}
+
+bool UWBTelemetryEncoder::add(const UWBRangingData& data)
+{
+    uint8_t out[maxRoundSize];
+    size_t len = 0;
+    bool ext = data.macMode() != 0;
+    State next;
+
+    if (used == 0)
+        return false;
+    if (data.measureType() != (uint8_t)uwb::MeasurementType::TWO_WAY)
+        return true;
+    if (numRounds > 0 && ext != extended)
+        return false;
+
+    next = state;
+    if (!encode(data, next, out, len) || used + len > bufSize)
+        return false;
+
+    if (numRounds == 0 && ext)
+    {
+        extended = true;
+        buf[0] |= extendedFlag;
+    }
+    memcpy(&buf[used], out, len);
+    used += len;
+    numRounds++;
+    state = next;
+    return true;
+}
+
+bool UWBTelemetryEncoder::encode(const UWBRangingData& data, State& st, uint8_t* out, size_t& pos)
+{
+    const uwb::twr_mesr* m = data.twoWayRangingMeasure();
+    uint8_t count = data.available() < uwb::MAX_RESPONDERS ? data.available() : uwb::MAX_RESPONDERS;
+    uint8_t addrLen = data.macMode() != 0 ? 8 : 2;
+    uint8_t flags, fom;
+    uint32_t q, aoa;
+    int idx;
+
+    if (key && numRounds == 0)
+        putVarint(out, pos, data.seqCtr());
+    else
+        putVarint(out, pos, data.seqCtr() - st.seq);
+    st.seq = data.seqCtr();
+    out[pos++] = count;
+
+    for (int i = 0; i < count; ++i)
+    {
+        flags = 0;
+        idx = -1;
+        for (int p = 0; p < st.numPeers && idx < 0; ++p)
+        {
+            if (memcmp(st.peers[p].addr, m[i].peer_addr, addrLen) == 0)
+                idx = p;
+        }
+        if (idx < 0)
+        {
+            if (st.numPeers == maxPeers)
+            {
+                // the table is reset by key frames only
+                forceKey = true;
+                return false;
+            }
+            idx = st.numPeers++;
+            memcpy(st.peers[idx].addr, m[i].peer_addr, addrLen);
+            st.peers[idx].last = 0;
+            flags |= newPeerFlag;
+        }
+        flags |= idx;
+        if (m[i].status != 0)
+            flags |= errorFlag;
+        if (m[i].nlos)
+            flags |= nlosFlag;
+        if (m[i].status == 0 && (m[i].aoa_azimuth_fom || m[i].aoa_elevation_fom))
+            flags |= aoaFlag;
+
+        out[pos++] = flags;
+        if (flags & newPeerFlag)
+        {
+            memcpy(&out[pos], m[i].peer_addr, addrLen);
+            pos += addrLen;
+        }
+        if (flags & errorFlag)
+        {
+            out[pos++] = m[i].status;
+            continue;
+        }
+
+        q = (m[i].distance + step / 2) / step;
+        if (flags & newPeerFlag)
+            putVarint(out, pos, q);
+        else
+            putVarint(out, pos, zigzag((int32_t)(q - st.peers[idx].last)));
+        st.peers[idx].last = q;
+
+        if (flags & aoaFlag)
+        {
+            // Q9.7 degrees rounded to whole degrees
+            fom = m[i].aoa_azimuth_fom > m[i].aoa_elevation_fom ? m[i].aoa_azimuth_fom : m[i].aoa_elevation_fom;
+            aoa = (clamp((m[i].aoa_azimuth + 64) >> 7, -256, 255) & 0x1FF) |
+                  ((uint32_t)(clamp((m[i].aoa_elevation + 64) >> 7, -128, 127) & 0xFF) << 9) |
+                  ((uint32_t)(fom > 127 ? 127 : fom) << 17);
+            out[pos++] = aoa & 0xFF;
+            out[pos++] = (aoa >> 8) & 0xFF;
+            out[pos++] = aoa >> 16;
+        }
+    }
+    return true;
+}
+
+size_t UWBTelemetryEncoder::length()
+{
+    return numRounds > 0 ? used : 0;
+}
+
+uint8_t UWBTelemetryEncoder::rounds()
+{
+    return numRounds;
+}
+
+void UWBTelemetryEncoder::reset()
+{
+    forceKey = true;
+}
+
+UWBTelemetryDecoder::UWBTelemetryDecoder(uint8_t distanceStep)
+    : step(distanceStep ? distanceStep : 1)
+{
+    synced = false;
+    frameNumber = 0;
+    seq = 0;
+    numPeers = 0;
+    numLost = 0;
+    buf = nullptr;
+    bufLen = 0;
+    pos = 0;
+    first = false;
+    addrLen = 2;
+}
+
+bool UWBTelemetryDecoder::begin(const uint8_t* frame, size_t len)
+{
+    uint8_t number;
+    uint8_t gap;
+
+    buf = nullptr;
+    if (len < 1)
+        return false;
+    number = frame[0] & frameMask;
+    // a retransmitted copy of the last frame, its rounds were read already
+    if (synced && number == frameNumber)
+        return false;
+    gap = (number - frameNumber - 1) & frameMask;
+    if (synced && gap != 0)
+    {
+        numLost += gap;
+        synced = false;
+    }
+    frameNumber = number;
+
+    if (frame[0] & keyFlag)
+    {
+        synced = true;
+        numPeers = 0;
+    }
+    else if (!synced)
+    {
+        numLost++;
+        return false;
+    }
+
+    buf = frame;
+    bufLen = len;
+    pos = 1;
+    first = (frame[0] & keyFlag) != 0;
+    addrLen = (frame[0] & extendedFlag) ? 8 : 2;
+    return true;
+}
+
+bool UWBTelemetryDecoder::next(UWBTelemetryRound& round)
+{
+    if (buf == nullptr || pos >= bufLen)
+        return false;
+    if (decode(round))
+        return true;
+    // the peer table can not be trusted anymore
+    buf = nullptr;
+    synced = false;
+    return false;
+}
+
+bool UWBTelemetryDecoder::decode(UWBTelemetryRound& round)
+{
+    uint32_t v, aoa;
+    uint8_t flags, idx;
+
+    if (!getVarint(buf, bufLen, pos, v) || pos >= bufLen)
+        return false;
+    seq = first ? v : seq + v;
+    first = false;
+    round.seq = seq;
+    round.count = buf[pos++];
+    if (round.count > uwb::MAX_RESPONDERS)
+        return false;
+
+    for (int i = 0; i < round.count; ++i)
+    {
+        UWBTelemetryMeasure& m = round.measures[i];
+
+        if (pos >= bufLen)
+            return false;
+        flags = buf[pos++];
+        idx = flags & peerMask;
+        if (flags & newPeerFlag)
+        {
+            if (idx != numPeers || idx >= maxPeers || pos + addrLen > bufLen)
+                return false;
+            memcpy(peers[idx].addr, &buf[pos], addrLen);
+            peers[idx].last = 0;
+            numPeers++;
+            pos += addrLen;
+        }
+        else if (idx >= numPeers)
+        {
+            return false;
+        }
+
+        memcpy(m.peer, peers[idx].addr, addrLen);
+        m.peerLen = addrLen;
+        m.nlos = (flags & nlosFlag) != 0;
+        m.hasAoa = false;
+        m.azimuth = 0;
+        m.elevation = 0;
+        m.fom = 0;
+        m.distance = 0;
+        m.status = 0;
+        if (flags & errorFlag)
+        {
+            if (pos >= bufLen)
+                return false;
+            m.status = buf[pos++];
+            continue;
+        }
+
+        if (!getVarint(buf, bufLen, pos, v))
+            return false;
+        peers[idx].last = (flags & newPeerFlag) ? v : peers[idx].last + unzigzag(v);
+        m.distance = peers[idx].last * step;
+
+        if (flags & aoaFlag)
+        {
+            if (pos + 3 > bufLen)
+                return false;
+            aoa = buf[pos] | (buf[pos + 1] << 8) | ((uint32_t)buf[pos + 2] << 16);
+            pos += 3;
+            m.hasAoa = true;
+            m.azimuth = (int16_t)((aoa & 0x1FF) << 7) >> 7;
+            m.elevation = (int8_t)((aoa >> 9) & 0xFF);
+            m.fom = aoa >> 17;
+        }
+    }
+    return true;
+}
+
+uint32_t UWBTelemetryDecoder::lost()
+{
+    return numLost;
+}
@@ -0,0 +1,203 @@
+// SPDX-License-Identifier: MIT
+// Copyright (c) 2025 Truesense Srl
+
+#ifndef UWBTELEMETRYCODEC_HPP
+#define UWBTELEMETRYCODEC_HPP
+
+#include <stdint.h>
+#include <stddef.h>
+#include "UWBRangingData.hpp"
+
+// Peers tracked between key frames, at most 16
+#ifndef UWB_TELEMETRY_PEERS
+#define UWB_TELEMETRY_PEERS 16
+#endif
+
+/**
+ * @brief a two way ranging measurement decoded by UWBTelemetryDecoder
+ *
+ */
+struct UWBTelemetryMeasure {
+    uint8_t peer[8];
+    uint8_t peerLen;            // 2 or 8
+    uint8_t status;             // 0 if the measurement is valid
+    bool nlos;
+    uint16_t distance;          // cm, multiple of the quantization step
+    bool hasAoa;
+    int16_t azimuth;            // degrees
+    int8_t elevation;           // degrees
+    uint8_t fom;                // AoA figure of merit, 0-100
+};
+
+/**
+ * @brief a ranging round decoded by UWBTelemetryDecoder
+ *
+ */
+struct UWBTelemetryRound {
+    uint32_t seq;               // UWBRangingData::seqCtr()
+    uint8_t count;
+    UWBTelemetryMeasure measures[uwb::MAX_RESPONDERS];
+};
+
+/**
+ * @brief compact encoding of two way ranging results, for in-band relaying
+ *
+ * A frame packs as many ranging rounds as fit in uwb::MAX_APP_DATA_SIZE
+ * bytes. It starts with one byte: bit 7 marks a key frame, bit 6 extended
+ * MAC addresses, bits 0-5 count the frames. Every round is encoded as:
+ *
+ * | field           | encoding                                            |
+ * |-----------------|-----------------------------------------------------|
+ * | sequence        | varint, absolute for the first round of a key       |
+ * |                 | frame, else the delta from the previous round       |
+ * | count           | 1 byte                                              |
+ * | per measurement | flags: peer index (bits 0-3), new peer (4),         |
+ * |                 | error (5), AoA (6), NLOS (7)                        |
+ * |                 | peer address if new peer                            |
+ * |                 | status byte if error, nothing else follows          |
+ * |                 | distance / step: varint if new peer, else zigzag    |
+ * |                 | varint delta from the last distance of the peer     |
+ * |                 | AoA if set: 3 bytes, azimuth (9 bits, degrees),     |
+ * |                 | elevation (8 bits, degrees), FOM (7 bits)           |
+ *
+ * Delta frames depend on the frames before them. A key frame every
+ * resyncEvery frames depends on nothing: a decoder that lost a frame
+ * skips the delta frames up to the next key frame.
+ *
+ * Neither class allocates memory, both can be used in the ranging
+ * callback. Only two way ranging results are encoded.
+ *
+ */
+class UWBTelemetryEncoder {
+public:
+    static const uint8_t maxPeers = UWB_TELEMETRY_PEERS;
+
+    /**
+     * @brief Construct a new UWBTelemetryEncoder object
+     *
+     * @param resyncEvery a key frame every resyncEvery frames, 1 for key frames only
+     * @param distanceStep quantization step of the distances, cm
+     */
+    UWBTelemetryEncoder(uint8_t resyncEvery = 16, uint8_t distanceStep = 1);
+
+    /**
+     * @brief start a new frame
+     *
+     * @param frame destination, stays in use until the frame is complete
+     * @param size of the frame, at most uwb::MAX_APP_DATA_SIZE is useful
+     */
+    void begin(uint8_t* frame, size_t size = uwb::MAX_APP_DATA_SIZE);
+
+    /**
+     * @brief append a ranging round to the frame
+     *
+     * @param data
+     * @return true
+     * @return false if the round does not fit, send the frame and add it to the next one
+     */
+    bool add(const UWBRangingData& data);
+
+    /**
+     * @brief bytes of the frame, 0 if it holds no round
+     */
+    size_t length();
+
+    /**
+     * @brief rounds in the frame
+     */
+    uint8_t rounds();
+
+    /**
+     * @brief start again with a key frame, e.g. when the gateway reconnects
+     */
+    void reset();
+
+private:
+    struct Peer {
+        uint8_t addr[8];
+        uint32_t last;          // quantized distance
+    };
+
+    struct State {
+        uint32_t seq;
+        uint8_t numPeers;
+        Peer peers[maxPeers];
+    };
+
+    bool encode(const UWBRangingData& data, State& st, uint8_t* out, size_t& pos);
+
+    uint8_t resync;
+    uint8_t step;
+    uint8_t counter;            // frames since the last key frame
+    uint8_t frameNumber;
+    bool forceKey;
+    State state;
+
+    uint8_t* buf;
+    size_t bufSize;
+    size_t used;
+    uint8_t numRounds;
+    bool key;
+    bool extended;
+};
+
+class UWBTelemetryDecoder {
+public:
+    static const uint8_t maxPeers = UWB_TELEMETRY_PEERS;
+
+    /**
+     * @brief Construct a new UWBTelemetryDecoder object
+     *
+     * @param distanceStep same quantization step as the encoder, cm
+     */
+    UWBTelemetryDecoder(uint8_t distanceStep = 1);
+
+    /**
+     * @brief start decoding a received frame
+     *
+     * @param frame stays in use until the last round is read
+     * @param len
+     * @return true
+     * @return false if it is a delta frame following a lost one, or a
+     *         copy of the previous frame, skip it
+     */
+    bool begin(const uint8_t* frame, size_t len);
+
+    /**
+     * @brief decode the next round of the frame
+     *
+     * @param round
+     * @return true
+     * @return false at the end of the frame, or if it is corrupted
+     */
+    bool next(UWBTelemetryRound& round);
+
+    /**
+     * @brief frames lost or skipped waiting for a key frame
+     */
+    uint32_t lost();
+
+private:
+    struct Peer {
+        uint8_t addr[8];
+        uint32_t last;
+    };
+
+    bool decode(UWBTelemetryRound& round);
+
+    uint8_t step;
+    bool synced;
+    uint8_t frameNumber;
+    uint32_t seq;
+    uint8_t numPeers;
+    Peer peers[maxPeers];
+    uint32_t numLost;
+
+    const uint8_t* buf;
+    size_t bufLen;
+    size_t pos;
+    bool first;
+    uint8_t addrLen;
+};
+
+#endif /* UWBTELEMETRYCODEC_HPP */
@@ -26,4 +26,9 @@ public:
     
 };
 
+typedef UWBAppParamsSnapshot<uwb::VendorAppConfig, 
+                             uwb::VendorAppConfigId,
+                             uwb::AppParamType,
+                             uwb::AppParamValue> UWBVendorParamSnapshot;
+
 #endif /* UWBVENDORPARAMLIST */